@@ -209,6 +209,23 @@ namespace AbstractGame {
         return AbstractTypes::INVALID_HANDLE;
     }
 
+    std::vector<AHandle> GetNearbyPeds(AHandle ped, int maxCount) {
+        std::vector<AHandle> out;
+#ifdef TARGET_GAME_GTAV
+        int id = ToGtaID(ped);
+        if (maxCount <= 0 || !ENTITY::DOES_ENTITY_EXIST(id)) return out;
+        // Native layout: [0] = capacity, then one ped every second int (8 byte slots)
+        std::vector<int> buf((size_t)maxCount * 2 + 2, 0);
+        buf[0] = maxCount;
+        int found = PED::GET_PED_NEARBY_PEDS(id, buf.data(), -1);
+        for (int i = 0; i < found && i < maxCount; ++i) {
+            int p = buf[(size_t)i * 2 + 2];
+            if (p != 0 && ENTITY::DOES_ENTITY_EXIST(p)) out.push_back((AHandle)p);
+        }
+#endif
+        return out;
+    }
+
     void ClearTasks(AHandle entity) {
 #ifdef TARGET_GAME_GTAV
         int id = ToGtaID(entity);
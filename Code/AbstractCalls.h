@@ -56,6 +56,7 @@ namespace AbstractGame {
 
     // World
     AHandle GetClosestPed(AVec3 center, float radius, AHandle ignoreEntity);
+    std::vector<AHandle> GetNearbyPeds(AHandle ped, int maxCount);
     AbstractTypes::ModelID GetEntityModel(AHandle entity);
     bool IsPedHuman(AHandle entity);
     bool IsPedMale(AHandle entity);
@@ -0,0 +1,103 @@
+#include "AudioBuffer.h"
+#include "main.h"
+#include <fstream>
+#include <filesystem>
+
+std::thread WavRecorder::s_worker;
+std::mutex WavRecorder::s_mutex;
+std::condition_variable WavRecorder::s_cv;
+std::deque<WavRecorder::Job> WavRecorder::s_jobs;
+std::atomic<bool> WavRecorder::s_running(false);
+std::string WavRecorder::s_folder;
+int WavRecorder::s_counter = 0;
+
+static const size_t MAX_PENDING = 8;     // dumps are dropped rather than piling up
+static const int ROTATE_FILES = 5;
+
+struct WAV_HEADER {
+    char riff[4] = { 'R', 'I', 'F', 'F' };
+    uint32_t overall_size;
+    char wave[4] = { 'W', 'A', 'V', 'E' };
+    char fmt_chunk_marker[4] = { 'f', 'm', 't', ' ' };
+    uint32_t length_of_fmt = 16;
+    uint16_t format_type = 1; // PCM
+    uint16_t channels = 1;    // Mono 
+    uint32_t sample_rate;
+    uint32_t byterate;
+    uint16_t block_align;
+    uint16_t bits_per_sample = 16;
+    char data_chunk_header[4] = { 'd', 'a', 't', 'a' };
+    uint32_t data_size;
+};
+
+void WavRecorder::WriteWav(const std::string& filename, const std::vector<int16_t>& data, int sampleRate) {
+    if (data.empty()) return;
+
+    std::ofstream f(filename, std::ios::binary);
+    if (!f.is_open()) return;
+
+    WAV_HEADER header;
+    header.sample_rate = sampleRate;
+    header.bits_per_sample = 16;
+    header.channels = 1;
+    header.data_size = (uint32_t)(data.size() * sizeof(int16_t));
+    header.overall_size = header.data_size + 36;
+    header.block_align = header.channels * header.bits_per_sample / 8;
+    header.byterate = header.sample_rate * header.block_align;
+
+    f.write((char*)&header, sizeof(WAV_HEADER));
+    f.write((char*)data.data(), header.data_size);
+    f.close();
+
+    Log("AudioSystem: [DEBUG] Saved " + filename + " (" + std::to_string(data.size()) + " samples)");
+}
+
+// ------------------------------------------------------------
+// RECORDER
+// ------------------------------------------------------------
+void WavRecorder::Start(const std::string& folder) {
+    if (s_running) return;
+    s_folder = folder;
+    s_running = true;
+    s_worker = std::thread(WorkerLoop);
+    Log("WavRecorder: debug dumps enabled (" + (folder.empty() ? std::string("game folder") : folder) + ")");
+}
+
+void WavRecorder::Stop() {
+    if (!s_running.exchange(false)) return;
+    { std::lock_guard<std::mutex> lock(s_mutex); }
+    s_cv.notify_all();
+    if (s_worker.joinable()) s_worker.join();
+    s_jobs.clear();
+}
+
+void WavRecorder::Record(const PcmRef& pcm, int sampleRate) {
+    if (!s_running || PcmEmpty(pcm)) return;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (s_jobs.size() >= MAX_PENDING) return;
+        Job job;
+        std::string name = "debug_tts_" + std::to_string(s_counter++ % ROTATE_FILES) + ".wav";
+        job.path = s_folder.empty() ? name : (std::filesystem::path(s_folder) / name).string();
+        job.pcm = pcm;
+        job.sampleRate = sampleRate;
+        s_jobs.push_back(std::move(job));
+    }
+    s_cv.notify_one();
+}
+
+void WavRecorder::WorkerLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(s_mutex);
+            s_cv.wait(lock, [] { return !s_jobs.empty() || !s_running; });
+            if (s_jobs.empty()) break;
+            job = std::move(s_jobs.front());
+            s_jobs.pop_front();
+        }
+        WriteWav(job.path, *job.pcm, job.sampleRate);
+    }
+}
+
+//EOF
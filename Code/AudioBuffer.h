@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+// AudioBuffer.h
+// PcmRef is the one handle a synthesized line travels with: TTS -> PcmCache ->
+// SubtitleManager -> AudioMixer. The samples are immutable once wrapped, every stage
+// only copies the reference. WavRecorder writes debug dumps on its own thread and
+// only when TTS_DEBUG_WAV is set.
+
+using PcmRef = std::shared_ptr<const std::vector<int16_t>>;
+
+// Takes ownership of the samples, no copy
+inline PcmRef MakePcm(std::vector<int16_t>&& samples) {
+    return std::make_shared<const std::vector<int16_t>>(std::move(samples));
+}
+
+inline bool PcmEmpty(const PcmRef& pcm) { return !pcm || pcm->empty(); }
+
+class WavRecorder {
+public:
+    static void Start(const std::string& folder);
+    static void Stop();
+    static bool IsEnabled() { return s_running.load(); }
+
+    // Queues the buffer, file name gets a rotating counter (debug_tts_0..4.wav)
+    static void Record(const PcmRef& pcm, int sampleRate);
+
+    static void WriteWav(const std::string& path, const std::vector<int16_t>& data, int sampleRate);
+
+private:
+    struct Job {
+        std::string path;
+        PcmRef pcm;
+        int sampleRate = 22050;
+    };
+    static void WorkerLoop();
+
+    static std::thread s_worker;
+    static std::mutex s_mutex;
+    static std::condition_variable s_cv;
+    static std::deque<Job> s_jobs;
+    static std::atomic<bool> s_running;
+    static std::string s_folder;
+    static int s_counter;
+};
+
+//EOF
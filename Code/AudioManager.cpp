@@ -1,159 +1,55 @@
 #include "AudioManager.h"
 #include "ConfigReader.h"
 #include "main.h"
+#include "TtsPipeline.h"
+#include "VoiceCatalog.h"
 #include <filesystem>
 #include <fstream>
 #include <cctype>
 #include <algorithm>
+#include <chrono>
 #include "memory"
 #include "babylon/babylon.h" 
 
 namespace fs = std::filesystem;
 
-std::vector<AudioManager::VoiceEntry> AudioManager::s_voiceDatabase;
-std::unordered_map<std::string, std::string> AudioManager::s_modelPaths;
 std::unordered_map<std::string, std::unique_ptr<Vits::Session>> AudioManager::s_activeSessions;
 std::shared_mutex AudioManager::s_sessionMutex;
 std::string AudioManager::s_rootPath;
+std::unordered_map<std::string, AudioManager::Residency> AudioManager::s_residency;
+std::set<std::string> AudioManager::s_pinned;
+uint64_t AudioManager::s_pinnedGeneration = 0;
+std::unordered_map<PersistID, std::string> AudioManager::s_entityPins;
+std::unordered_map<std::string, int> AudioManager::s_entityPinCount;
+std::set<std::string> AudioManager::s_loading;
+std::condition_variable_any AudioManager::s_loadCv;
+size_t AudioManager::s_residentBytes = 0;
+size_t AudioManager::s_budgetBytes = 0;
+uint64_t AudioManager::s_useClock = 0;
+std::atomic<uint64_t> AudioManager::s_hits(0);
+std::atomic<uint64_t> AudioManager::s_misses(0);
+std::atomic<uint64_t> AudioManager::s_evictions(0);
+std::unordered_map<std::string, float> AudioManager::s_realTimeFactor;
+std::mutex AudioManager::s_rtfMutex;
+
+// Voice assignment weights. A model that is not loaded costs a load plus its size, an
+// unmeasured model is assumed to run at this real time factor.
+static const float LOAD_COST = 1.0f;
+static const float BYTES_PER_COST = 256.0f * 1024.0f * 1024.0f;
+static const float DEFAULT_RTF = 0.3f;
+static const float SHARED_VOICE_COST = 4.0f;   // * TTS_VOICE_VARIETY / 100 per NPC already using the voice
 
 void AudioManager::Initialize(const std::string& gameRoot) {
+    // Voice lists are parsed and indexed once by the catalog
+    VoiceCatalog::Build(gameRoot);
+
     std::unique_lock lock(s_sessionMutex);
     s_rootPath = gameRoot;
-    s_voiceDatabase.clear();
-    s_modelPaths.clear();
-
-    std::string configFolder = gameRoot + "/ECmod/AudioDataFiles";
-
-    if (!fs::exists(configFolder)) {
-        Log("AudioManager: Config folder missing: " + configFolder);
-        return;
-    }
+    Log("AudioManager: Loaded " + std::to_string(VoiceCatalog::Size()) + " voices.");
 
-    for (const auto& entry : fs::directory_iterator(configFolder)) {
-        if (entry.path().extension() == ".ini" &&
-            entry.path().filename().string().find("EC_Voices_list_") == 0) {
-
-            std::ifstream file(entry.path());
-            std::string line;
-            std::string currentBasePath;
-
-            // Temporre Speicher fr den aktuellen Parsing-Block
-            VoiceEntry currentEntry;
-            bool entryOpen = false;
-
-            while (std::getline(file, line)) {
-                if (!line.empty() && line.back() == '\r') line.pop_back();
-                line.erase(0, line.find_first_not_of(" \t"));
-                if (line.empty() || line[0] == ';') continue;
-
-                // --- 1. GLOBAL SETTINGS (model_path) ---
-                if (line.find("model_path") == 0) {
-                    size_t sep = line.find('=');
-                    if (sep != std::string::npos) {
-                        std::string val = line.substr(sep + 1);
-                        val.erase(0, val.find_first_not_of(" \t"));
-
-                        if (val.find("root/") == 0) val = s_rootPath + "/" + val.substr(5);
-
-                        std::replace(val.begin(), val.end(), '\\', '/');
-                        if (!val.empty() && val.back() != '/') val += '/';
-                        currentBasePath = val;
-                    }
-                }
-
-                // --- 2. START NEUER BLOCK [ID] ---
-                else if (line[0] == '[' && line.find(']') != std::string::npos) {
-                    // Vorherigen Eintrag abschlieen
-                    if (entryOpen) {
-                        s_voiceDatabase.push_back(currentEntry);
-                    }
-
-                    // Reset
-                    currentEntry = VoiceEntry();
-                    entryOpen = true;
-
-                    // ID aus Klammer [1]
-                    std::string content = line.substr(1, line.find(']') - 1);
-                    // Filter nur Ziffern (falls "[ID 1]" statt "[1]")
-                    std::string digits;
-                    for (char c : content) if (isdigit(c)) digits += c;
-
-                    try { currentEntry.id = std::stoi(digits); }
-                    catch (...) { currentEntry.id = 0; }
-
-                    // Defaults
-                    currentEntry.internal_id = 0;
-                    currentEntry.isReserved = false;
-                }
-
-                // --- 3. ATTRIBUTE LESEN ---
-                else if (entryOpen) {
-                    size_t sep = line.find_first_of("=:"); // Untersttzt = und :
-                    if (sep == std::string::npos) continue;
-
-                    std::string key = line.substr(0, sep);
-                    std::string val = line.substr(sep + 1);
-
-                    // Trim Key & Val
-                    key.erase(key.find_last_not_of(" \t") + 1);
-                    val.erase(0, val.find_first_not_of(" \t"));
-
-                    // Mapping
-                    if (key == "rep_internal_id" || key == "int_id") {
-                        try { currentEntry.internal_id = std::stoi(val); }
-                        catch (...) { currentEntry.internal_id = 0; }
-                    }
-                    else if (key == "name")   currentEntry.modelName = val;
-                    else if (key == "path")   currentEntry.path_raw = val;
-                    else if (key == "gender") currentEntry.gender = val;
-                    else if (key == "age")    currentEntry.age = val;
-                    else if (key == "voice")  currentEntry.voicetype = val;
-                    else if (key == "enable" && val == "0") entryOpen = false; // Disable -> nicht speichern
-                }
-            }
-            // Letzten Eintrag speichern
-            if (entryOpen) {
-                s_voiceDatabase.push_back(currentEntry);
-            }
-
-            // --- 4. PFADE AUFLSEN (Nach dem Parsen) ---
-            for (auto& ve : s_voiceDatabase) {
-                // UID festlegen: Wenn Name leer, nimm die Listen-ID als String ("1")
-                std::string uid = ve.modelName;
-                if (uid.empty()) uid = std::to_string(ve.id);
-                ve.modelName = uid; // Speichern fr spter
-
-                // Pfad bauen
-                std::string finalPath = "";
-
-                // Fall A: Eintrag hat einen eigenen Pfad (Single File)
-                if (!ve.path_raw.empty()) {
-                    finalPath = currentBasePath + ve.path_raw;
-                }
-                // Fall B: Kein eigener Pfad -> Nutze Basis-Pfad (Multi-Speaker ONNX)
-                // (Hier msste man eigentlich wissen, wie die Hauptdatei heit. 
-                //  Oft ist currentBasePath dann der Pfad zur Datei, nicht zum Ordner.
-                //  Aber lassen wir es erstmal bei Fall A, das deckt deine Piper-Liste ab.)
-
-                if (!finalPath.empty()) {
-                    // .onnx Logik
-                    if (finalPath.find(".onnx") == std::string::npos) finalPath += ".onnx";
-
-                    // Windows Fix
-                    std::replace(finalPath.begin(), finalPath.end(), '/', '\\');
-
-                    // Check
-                    if (fs::exists(finalPath)) {
-                        s_modelPaths[uid] = finalPath;
-                    }
-                    else {
-                        Log("AudioManager: WARNING - File missing for Voice " + uid + ": " + finalPath);
-                    }
-                }
-            }
-        }
-    }
-    Log("AudioManager: Loaded " + std::to_string(s_voiceDatabase.size()) + " voices.");
+    // Named characters with a fixed voice keep it resident
+    RefreshPinsLocked(true);
+    s_budgetBytes = (size_t)std::max(0, ConfigReader::g_Settings.TTS_VOICE_RAM_MB) * 1024 * 1024;
 }
 
 VoiceSettings AudioManager::GetVoiceForNPC(const NpcPersona& persona) {
@@ -163,58 +59,57 @@ VoiceSettings AudioManager::GetVoiceForNPC(const NpcPersona& persona) {
         return { persona.p_audio_model, persona.p_audio_ID, 1.0f };
     }
 
-    // 2. Matching
-    std::vector<const VoiceEntry*> candidates;
-    for (const auto& entry : s_voiceDatabase) {
-        if (entry.isReserved) continue;
+    // 2. Matching: one bucket per (gender, age, voicetype). Loaded models (other speakers of a
+    //    multi speaker onnx especially) are cheap, slow and big ones expensive, and a voice another
+    //    NPC already uses costs more the more variety TTS_VOICE_VARIETY asks for.
+    std::vector<std::string> resident;
+    {
+        std::shared_lock lock(s_sessionMutex);
+        for (const auto& kv : s_activeSessions) resident.push_back(kv.first);
+    }
+    std::unordered_map<std::string, float> rtf;
+    {
+        std::lock_guard<std::mutex> lock(s_rtfMutex);
+        rtf = s_realTimeFactor;
+    }
+    float variety = std::clamp(ConfigReader::g_Settings.TTS_VOICE_VARIETY, 0, 100) / 100.0f;
 
-        if (MatchesGender(persona.n_gender, entry.gender) &&
-            MatchesAge(persona.n_age, entry.age) &&
-            MatchesVoiceType(persona.n_voicetype, entry.voicetype)) {
-            candidates.push_back(&entry);
+    auto cost = [&](const CatalogVoice& v, int users) {
+        float c = 0.0f;
+        if (std::find(resident.begin(), resident.end(), v.modelKey) == resident.end()) {
+            c += LOAD_COST + (float)v.fileBytes / BYTES_PER_COST;
         }
-    }
+        auto it = rtf.find(v.modelKey);
+        c += (it != rtf.end()) ? it->second : DEFAULT_RTF;
+        c += users * variety * SHARED_VOICE_COST;
+        return c;
+    };
 
-    if (!candidates.empty()) {
-        const auto* picked = candidates[rand() % candidates.size()];
-        // Wir geben zurck:
-        // model = UID (Key fr Pfad-Map)
-        // id = Interne Speaker ID (0 fr Single, >0 fr Multi)
-        return { picked->modelName, picked->internal_id, 1.0f };
-    }
+    // model = UID (Key fr Pfad-Map)
+    // id = Interne Speaker ID (0 fr Single, >0 fr Multi)
+    VoiceSettings picked;
+    if (VoiceCatalog::Pick(persona, picked, resident, cost)) return picked;
 
     // Fallback
     return { "DEFAULT", 0, 1.0f };
 }
 
 std::string AudioManager::ResolveModelPath(const std::string& modelName) {
-    auto it = s_modelPaths.find(modelName);
-    return (it != s_modelPaths.end()) ? it->second : "";
-}
-
-// Helpers
-static std::string ToLower(std::string s) {
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
-    return s;
-}
-bool AudioManager::MatchesGender(const std::string& npc, const std::string& voice) {
-    if (voice == "n" || voice.empty() || npc.empty()) return true;
-    return ToLower(npc).substr(0, 1) == ToLower(voice).substr(0, 1);
-}
-bool AudioManager::MatchesAge(const std::string& npc, const std::string& voice) {
-    if (voice.empty() || npc.empty()) return true;
-    return ToLower(npc) == ToLower(voice);
-}
-bool AudioManager::MatchesVoiceType(const std::string& npc, const std::string& voice) {
-    if (voice.empty() || npc.empty()) return true;
-    return ToLower(npc) == ToLower(voice);
+    return VoiceCatalog::ResolvePath(modelName);
 }
 
 
 bool AudioManager::LoadAudioModel(const std::string& modelName) {
     std::unique_lock lock(s_sessionMutex);
 
-    if (s_activeSessions.count(modelName)) return true;
+    // Someone else is loading the same model: wait for it instead of loading twice
+    s_loadCv.wait(lock, [&] { return s_loading.count(modelName) == 0; });
+
+    if (s_activeSessions.count(modelName)) {
+        s_hits++;
+        s_residency[modelName].lastUse = ++s_useClock;
+        return true;
+    }
 
     std::string path = ResolveModelPath(modelName);
 
@@ -227,35 +122,216 @@ bool AudioManager::LoadAudioModel(const std::string& modelName) {
         return false;
     }
 
+    // ONNX laden ohne Lock, GetSession bleibt fuer andere Stimmen frei
+    s_loading.insert(modelName);
+    lock.unlock();
+
+    std::unique_ptr<Vits::Session> session;
+    uint64_t ramBefore = AOS::GetProcessRAMUsage();
     try {
         // HIER passiert das Laden mit dem gefixten Konstruktor aus Schritt 1
-        s_activeSessions[modelName] = std::make_unique<Vits::Session>(path);
-
-        // WICHTIG: Wenn wir hier ankommen, war Schritt 1 erfolgreich!
-        Log("AudioManager: [SUCCESS] Vits::Session loaded successfully for: " + modelName);
-        return true;
+        session = std::make_unique<Vits::Session>(path);
     }
     catch (const std::exception& e) {
         Log("AudioManager: [CRITICAL FAILURE] " + std::string(e.what()));
-        return false;
     }
     catch (...) {
         Log("AudioManager: [CRITICAL FAILURE] Unknown crash loading VITS.");
-        return false;
     }
+    uint64_t ramAfter = AOS::GetProcessRAMUsage();
+
+    // Size: RAM growth during the load, at least the file size (other threads make the delta noisy)
+    std::error_code ec;
+    size_t bytes = (size_t)fs::file_size(path, ec);
+    if (ramAfter > ramBefore) bytes = std::max(bytes, (size_t)(ramAfter - ramBefore));
+
+    lock.lock();
+    s_loading.erase(modelName);
+    s_loadCv.notify_all();
+    if (!session) return false;
+
+    s_misses++;
+    s_activeSessions[modelName] = std::move(session);
+    Residency& r = s_residency[modelName];
+    r.bytes = bytes;
+    r.lastUse = ++s_useClock;
+    r.users = 0;
+    s_residentBytes += bytes;
+
+    // WICHTIG: Wenn wir hier ankommen, war Schritt 1 erfolgreich!
+    Log("AudioManager: [SUCCESS] Vits::Session loaded successfully for: " + modelName + " (" + std::to_string(bytes / (1024 * 1024)) + " MB)");
+
+    EvictLocked(modelName);
+    return true;
 }
 
 void AudioManager::UnloadAudioModel(const std::string& modelName) {
     std::unique_lock lock(s_sessionMutex);
-    s_activeSessions.erase(modelName);
+    auto it = s_activeSessions.find(modelName);
+    if (it == s_activeSessions.end()) return;
+    if (s_residency[modelName].users > 0) {
+        Log("AudioManager: [UNLOAD] " + modelName + " is still speaking, kept");
+        return;
+    }
+    TtsPipeline::ForgetSession(it->second.get());
+    s_residentBytes -= std::min(s_residentBytes, s_residency[modelName].bytes);
+    s_residency.erase(modelName);
+    s_activeSessions.erase(it);
 }
-void AudioManager::LoadVoiceConfigs(const std::string& folderPath) { Initialize(folderPath); }
 void AudioManager::UnloadAllAudioModels() {
     std::unique_lock lock(s_sessionMutex);
+    // Replies still speaking (or loading) hold a session pointer, it must outlive them
+    auto idle = [] {
+        if (!s_loading.empty()) return false;
+        for (const auto& kv : s_residency) if (kv.second.users > 0) return false;
+        return true;
+    };
+    if (!s_loadCv.wait_for(lock, std::chrono::seconds(10), idle)) {
+        Log("AudioManager: [UNLOAD] Waiting for voices that are still speaking...");
+        s_loadCv.wait(lock, idle);
+    }
+    Log("AudioManager: Voice residency - " + std::to_string(s_hits.load()) + " hits, " + std::to_string(s_misses.load()) +
+        " loads, " + std::to_string(s_evictions.load()) + " evictions");
+    for (auto& kv : s_activeSessions) TtsPipeline::ForgetSession(kv.second.get());
     s_activeSessions.clear();
+    s_residency.clear();
+    s_residentBytes = 0;
 }
 Vits::Session* AudioManager::GetSession(const std::string& modelName) {
     std::shared_lock lock(s_sessionMutex);
     auto it = s_activeSessions.find(modelName);
     return (it != s_activeSessions.end()) ? it->second.get() : nullptr;
+}
+
+// ------------------------------------------------------------
+// RESIDENCY
+// ------------------------------------------------------------
+void AudioManager::ReportSynthesis(const std::string& modelKey, double inferenceSeconds, double audioSeconds) {
+    if (audioSeconds <= 0.0 || inferenceSeconds <= 0.0) return;
+    float sample = (float)(inferenceSeconds / audioSeconds);
+    std::lock_guard<std::mutex> lock(s_rtfMutex);
+    auto it = s_realTimeFactor.find(modelKey);
+    if (it == s_realTimeFactor.end()) s_realTimeFactor.emplace(modelKey, sample);
+    else it->second = it->second * 0.8f + sample * 0.2f;
+}
+
+AudioManager::SessionLease& AudioManager::SessionLease::operator=(SessionLease&& o) noexcept {
+    if (this != &o) {
+        if (m_session) ReleaseSession(m_key);
+        m_key = std::move(o.m_key);
+        m_session = o.m_session;
+        o.m_session = nullptr;
+    }
+    return *this;
+}
+
+AudioManager::SessionLease::~SessionLease() {
+    if (m_session) ReleaseSession(m_key);
+}
+
+AudioManager::SessionLease AudioManager::AcquireSession(const std::string& modelKey, bool loadIfMissing) {
+    // two tries: the model may be evicted between load and lease by a parallel load
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        {
+            std::unique_lock lock(s_sessionMutex);
+            auto it = s_activeSessions.find(modelKey);
+            if (it != s_activeSessions.end()) {
+                Residency& r = s_residency[modelKey];
+                r.users++;
+                r.lastUse = ++s_useClock;
+                return SessionLease(modelKey, it->second.get());
+            }
+        }
+        if (!loadIfMissing || !LoadAudioModel(modelKey)) break;
+    }
+    return SessionLease();
+}
+
+void AudioManager::ReleaseSession(const std::string& modelKey) {
+    std::unique_lock lock(s_sessionMutex);
+    auto it = s_residency.find(modelKey);
+    if (it == s_residency.end()) return;
+    if (it->second.users > 0) it->second.users--;
+    EvictLocked("");   // an over-budget load may have waited for this one
+    s_loadCv.notify_all();   // UnloadAllAudioModels waits for the last lease
+}
+
+void AudioManager::PinForEntity(PersistID id, const std::string& modelKey) {
+    UnpinEntity(id);
+    if (modelKey.empty() || modelKey == "NONE") return;
+    std::unique_lock lock(s_sessionMutex);
+    s_entityPins[id] = modelKey;
+    s_entityPinCount[modelKey]++;
+}
+
+void AudioManager::UnpinEntity(PersistID id) {
+    std::unique_lock lock(s_sessionMutex);
+    auto it = s_entityPins.find(id);
+    if (it == s_entityPins.end()) return;
+    auto count = s_entityPinCount.find(it->second);
+    if (count != s_entityPinCount.end() && --count->second <= 0) s_entityPinCount.erase(count);
+    s_entityPins.erase(it);
+    EvictLocked("");
+}
+
+// Persona voices follow the config: rebuilt once per published generation (hot reload)
+void AudioManager::RefreshPinsLocked(bool force) {
+    uint64_t generation = ConfigReader::Current()->generation;
+    if (!force && generation == s_pinnedGeneration) return;
+    s_pinnedGeneration = generation;
+    s_pinned.clear();
+    ConfigReader::ForEachPersona([](const NpcPersona& p) {
+        if (!p.p_audio_model.empty()) s_pinned.insert(p.p_audio_model);
+    });
+}
+
+bool AudioManager::IsPinnedLocked(const std::string& modelKey) {
+    return s_pinned.count(modelKey) > 0 || s_entityPinCount.count(modelKey) > 0;
+}
+
+void AudioManager::SetVoiceBudget(size_t bytes) {
+    std::unique_lock lock(s_sessionMutex);
+    s_budgetBytes = bytes;
+    EvictLocked("");
+}
+
+AudioManager::ResidencyStats AudioManager::GetResidencyStats() {
+    std::shared_lock lock(s_sessionMutex);
+    ResidencyStats st;
+    st.hits = s_hits.load();
+    st.misses = s_misses.load();
+    st.evictions = s_evictions.load();
+    st.residentBytes = s_residentBytes;
+    st.budgetBytes = s_budgetBytes;
+    st.resident = (int)s_activeSessions.size();
+    for (const auto& kv : s_activeSessions) if (IsPinnedLocked(kv.first)) st.pinned++;
+    return st;
+}
+
+// Least recently used first, never a voice that is speaking, pinned or just loaded
+void AudioManager::EvictLocked(const std::string& keep) {
+    if (s_budgetBytes == 0) return;
+    RefreshPinsLocked(false);
+
+    while (s_residentBytes > s_budgetBytes) {
+        const std::string* victim = nullptr;
+        uint64_t oldest = UINT64_MAX;
+        for (const auto& kv : s_residency) {
+            if (kv.second.users > 0 || kv.first == keep || IsPinnedLocked(kv.first)) continue;
+            if (kv.second.lastUse < oldest) { oldest = kv.second.lastUse; victim = &kv.first; }
+        }
+        if (!victim) break;
+
+        std::string key = *victim;
+        auto it = s_activeSessions.find(key);
+        if (it != s_activeSessions.end()) {
+            TtsPipeline::ForgetSession(it->second.get());
+            s_activeSessions.erase(it);
+        }
+        s_residentBytes -= std::min(s_residentBytes, s_residency[key].bytes);
+        s_residency.erase(key);
+        s_evictions++;
+        Log("AudioManager: [EVICT] " + key + " (" + std::to_string(s_residentBytes / (1024 * 1024)) + " / " +
+            std::to_string(s_budgetBytes / (1024 * 1024)) + " MB resident)");
+    }
 }
\ No newline at end of file
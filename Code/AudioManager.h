@@ -6,8 +6,12 @@
 #include <vector>
 #include <unordered_map>
 #include <shared_mutex>
+#include <mutex>
 #include <memory>
 #include <filesystem>
+#include <set>
+#include <atomic>
+#include <condition_variable>
 
 namespace Vits {
     class Session;
@@ -16,6 +20,7 @@ namespace Vits {
 class AudioManager {
 public:
     static void Initialize(const std::string& rootPath);
+    // Voice lookup goes through VoiceCatalog (one parse, bucketed index)
     static VoiceSettings GetVoiceForNPC(const NpcPersona& persona);
     static std::string ResolveModelPath(const std::string& modelKey);
 
@@ -25,37 +30,76 @@ public:
 
     static Vits::Session* GetSession(const std::string& modelKey);
 
-   
-    struct VoiceEntry {
-        int id;                
-        std::string modelName; 
-
-        // --- HIER WAREN DIE FEHLENDEN VARIABLEN ---
-        std::string path_raw;   
-        int internal_id;        
-        // ------------------------------------------
-
-        std::string gender;
-        std::string voicetype;
-        std::string age;
-        std::string quality;
-        bool isReserved = false;
+    // --- Residency (TTS_VOICE_RAM_MB) ---
+    // Holding a lease keeps the session from being evicted while it synthesizes.
+    class SessionLease {
+    public:
+        SessionLease() = default;
+        SessionLease(const std::string& key, Vits::Session* session) : m_key(key), m_session(session) {}
+        SessionLease(SessionLease&& o) noexcept : m_key(std::move(o.m_key)), m_session(o.m_session) { o.m_session = nullptr; }
+        SessionLease& operator=(SessionLease&& o) noexcept;
+        SessionLease(const SessionLease&) = delete;
+        SessionLease& operator=(const SessionLease&) = delete;
+        ~SessionLease();
+
+        Vits::Session* get() const { return m_session; }
+        explicit operator bool() const { return m_session != nullptr; }
+
+    private:
+        std::string m_key;
+        Vits::Session* m_session = nullptr;
+    };
+
+    struct ResidencyStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t residentBytes = 0;
+        size_t budgetBytes = 0;
+        int resident = 0;
+        int pinned = 0;
     };
 
+    // Loads the model if needed (loadIfMissing) and leases it
+    static SessionLease AcquireSession(const std::string& modelKey, bool loadIfMissing = true);
+    // Measured inference time per second of audio, feeds the voice assignment (TTS_VOICE_VARIETY)
+    static void ReportSynthesis(const std::string& modelKey, double inferenceSeconds, double audioSeconds);
+    // Pinned voices are never evicted: persona voices (rebuilt when the personas reload) and
+    // script-assigned voices, until their entity is forgotten or gets another voice
+    static void PinForEntity(PersistID id, const std::string& modelKey);
+    static void UnpinEntity(PersistID id);
+    static void SetVoiceBudget(size_t bytes);
+    static ResidencyStats GetResidencyStats();
+
 private:
-    static std::vector<VoiceEntry> s_voiceDatabase;
-    static std::unordered_map<std::string, std::string> s_modelPaths;
     static std::unordered_map<std::string, std::unique_ptr<Vits::Session>> s_activeSessions;
 
     static std::shared_mutex s_sessionMutex;
     static std::string s_rootPath;
 
-    
-    static bool MatchesGender(const std::string& npcGender, const std::string& voiceGender);
-    static bool MatchesVoiceType(const std::string& npcType, const std::string& voiceType);
-    static bool MatchesAge(const std::string& npcAge, const std::string& voiceAge);
-    static bool MatchesSomeSpecial();
+    struct Residency {
+        size_t bytes = 0;
+        uint64_t lastUse = 0;
+        int users = 0;
+    };
+    static std::unordered_map<std::string, Residency> s_residency;   // guarded by s_sessionMutex
+    static std::set<std::string> s_pinned;                           // persona voices
+    static uint64_t s_pinnedGeneration;                              // config generation s_pinned was built from
+    static std::unordered_map<PersistID, std::string> s_entityPins;
+    static std::unordered_map<std::string, int> s_entityPinCount;
+    static std::set<std::string> s_loading;                          // loads in flight, outside the lock
+    static std::condition_variable_any s_loadCv;
+    static size_t s_residentBytes;
+    static size_t s_budgetBytes;
+    static uint64_t s_useClock;
+    static std::atomic<uint64_t> s_hits;
+    static std::atomic<uint64_t> s_misses;
+    static std::atomic<uint64_t> s_evictions;
+    static std::unordered_map<std::string, float> s_realTimeFactor;   // EMA per model
+    static std::mutex s_rtfMutex;
 
-    
-    static void LoadVoiceConfigs(const std::string& folderPath);
+    static void ReleaseSession(const std::string& modelKey);
+    static void EvictLocked(const std::string& keep);
+    static void RefreshPinsLocked(bool force);
+    static bool IsPinnedLocked(const std::string& modelKey);
 };
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "AudioMixer.h"
+#include "main.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+AudioQueue<AudioMixer::Command, AudioMixer::QUEUE_SIZE> AudioMixer::s_commands;
+AudioQueue<PcmRef, AudioMixer::QUEUE_SIZE * 2> AudioMixer::s_retired;
+AudioQueue<StreamHandle, AudioMixer::QUEUE_SIZE * 2> AudioMixer::s_retiredStreams;
+AudioMixer::Voice AudioMixer::s_voices[AudioMixer::MAX_VOICES];
+float AudioMixer::s_mix[AudioMixer::MIX_BLOCK];
+uint64_t AudioMixer::s_playCounter = 0;
+int AudioMixer::s_deviceRate = 22050;
+std::atomic<int> AudioMixer::s_activeVoices(0);
+std::atomic<uint64_t> AudioMixer::s_underruns(0);
+
+static const uint64_t FP_ONE = 1ULL << 32;
+static const int FADE_FRAMES = 256;     // short ramp on stop/replace, avoids clicks
+
+// ------------------------------------------------------------
+// 0. VOICE STREAM (producer side)
+// ------------------------------------------------------------
+VoiceStream::VoiceStream(int sampleRate, size_t capacitySamples, size_t jitterSamples)
+    : m_jitter(jitterSamples), m_rate(sampleRate > 0 ? sampleRate : 22050) {
+    m_ring.Allocate(std::max(capacitySamples, jitterSamples * 2));
+}
+
+size_t VoiceStream::Write(const int16_t* pcm, size_t count) {
+    size_t written = 0;
+    auto lastProgress = std::chrono::steady_clock::now();
+    size_t lastRead = m_ring.ReadPos();
+
+    while (written < count && !IsCancelled()) {
+        // only write what fits, AudioRingBuffer::Write would drop the rest
+        const size_t space = m_ring.Capacity() - (m_ring.WritePos() - m_ring.ReadPos());
+        const size_t n = std::min(space, count - written);
+        if (n > 0) {
+            written += m_ring.Write(pcm + written, n);
+            continue;
+        }
+
+        const size_t r = m_ring.ReadPos();
+        auto now = std::chrono::steady_clock::now();
+        if (r != lastRead) { lastRead = r; lastProgress = now; }
+        else if (now - lastProgress > std::chrono::milliseconds(STALL_TIMEOUT_MS)) {
+            Cancel();
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return written;
+}
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE (device stopped)
+// ------------------------------------------------------------
+void AudioMixer::Init(int deviceRate) {
+    s_deviceRate = deviceRate > 0 ? deviceRate : 22050;
+    Shutdown();
+}
+
+void AudioMixer::Shutdown() {
+    Command cmd;
+    while (s_commands.Pop(cmd)) {
+        if (cmd.stream) cmd.stream->Cancel();
+        cmd.pcm.reset();
+        cmd.stream.reset();
+    }
+    for (auto& v : s_voices) {
+        if (v.stream) v.stream->Cancel();
+        v = Voice();
+    }
+    Collect();
+    s_activeVoices = 0;
+}
+
+// ------------------------------------------------------------
+// 2. CONTROL (any thread)
+// ------------------------------------------------------------
+bool AudioMixer::Play(PcmRef pcm, int sampleRate, uint32_t voiceKey, float gain) {
+    Collect();
+    if (!pcm || pcm->empty() || sampleRate <= 0) return false;
+
+    Command cmd;
+    cmd.type = CommandType::PLAY;
+    cmd.pcm = std::move(pcm);
+    cmd.step = ((uint64_t)sampleRate << 32) / (uint64_t)s_deviceRate;
+    cmd.key = voiceKey;
+    cmd.gain = gain;
+    if (!s_commands.Push(cmd)) {
+        Log("AudioMixer: [WARN] command queue full, line dropped");
+        return false;
+    }
+    return true;
+}
+
+bool AudioMixer::PlayStream(StreamHandle stream, uint32_t voiceKey, float gain) {
+    Collect();
+    if (!stream) return false;
+
+    Command cmd;
+    cmd.type = CommandType::PLAY;
+    cmd.step = ((uint64_t)stream->SampleRate() << 32) / (uint64_t)s_deviceRate;
+    cmd.stream = std::move(stream);
+    cmd.key = voiceKey;
+    cmd.gain = gain;
+    if (!s_commands.Push(cmd)) {
+        Log("AudioMixer: [WARN] command queue full, stream dropped");
+        cmd.stream->Cancel();
+        return false;
+    }
+    return true;
+}
+
+void AudioMixer::Stop(uint32_t voiceKey) {
+    Collect();
+    Command cmd;
+    cmd.type = CommandType::STOP;
+    cmd.key = voiceKey;
+    s_commands.Push(cmd);
+}
+
+void AudioMixer::StopAll() {
+    Collect();
+    Command cmd;
+    cmd.type = CommandType::STOP_ALL;
+    s_commands.Push(cmd);
+}
+
+void AudioMixer::Collect() {
+    PcmRef done;
+    while (s_retired.Pop(done)) done.reset();
+    StreamHandle doneStream;
+    while (s_retiredStreams.Pop(doneStream)) doneStream.reset();
+}
+
+// ------------------------------------------------------------
+// 3. CALLBACK (no locks, no allocations, no frees)
+// ------------------------------------------------------------
+void AudioMixer::Retire(Voice& v) {
+    if (v.pcm && !s_retired.Push(v.pcm)) v.pcm.reset();   // unreachable with the sizes above
+    if (v.stream) {
+        v.stream->Cancel();                                 // unblocks a producer still writing
+        if (!s_retiredStreams.Push(v.stream)) v.stream.reset();
+    }
+    v.pcm = nullptr;
+    v.stream = nullptr;
+    v.fade = 0;
+}
+
+void AudioMixer::Apply(Command& cmd) {
+    if (cmd.type != CommandType::PLAY) {
+        for (auto& v : s_voices) {
+            if (InUse(v) && v.fade == 0 && (cmd.type == CommandType::STOP_ALL || v.key == cmd.key)) v.fade = FADE_FRAMES;
+        }
+        return;
+    }
+
+    // same speaker: old line fades out, new one takes a fresh slot
+    for (auto& v : s_voices) {
+        if (InUse(v) && v.fade == 0 && v.key == cmd.key) v.fade = FADE_FRAMES;
+    }
+
+    Voice* slot = nullptr;
+    for (auto& v : s_voices) {
+        if (!InUse(v)) { slot = &v; break; }
+    }
+    if (!slot) {
+        slot = &s_voices[0];
+        for (auto& v : s_voices) if (v.started < slot->started) slot = &v;
+        Retire(*slot);
+    }
+
+    slot->pcm = std::move(cmd.pcm);
+    slot->stream = std::move(cmd.stream);
+    slot->pos = 0;
+    slot->step = cmd.step;
+    slot->key = cmd.key;
+    slot->gain = cmd.gain;
+    slot->fade = 0;
+    slot->started = ++s_playCounter;
+}
+
+size_t AudioMixer::MixVoice(Voice& v, float* mix, size_t frames) {
+    const int16_t* d = v.pcm->data();
+    const uint64_t len = v.pcm->size();
+    const float scale = v.gain / 32768.0f;
+    const bool fading = v.fade > 0;
+    const size_t n = fading ? std::min(frames, (size_t)v.fade) : frames;
+    size_t i = 0;
+
+    if (!fading && v.step == FP_ONE) {
+        // model rate == device rate, plain copy loop
+        const uint64_t idx = v.pos >> 32;
+        const size_t m = (size_t)std::min<uint64_t>(n, idx < len ? len - idx : 0);
+        const int16_t* src = d + idx;
+        for (; i < m; ++i) mix[i] += src[i] * scale;
+        v.pos += (uint64_t)m << 32;
+    }
+    else {
+        // linear interpolation between neighbouring samples
+        for (; i < n; ++i) {
+            const uint64_t idx = v.pos >> 32;
+            if (idx >= len) break;
+            const float a = d[idx];
+            const float b = (idx + 1 < len) ? d[idx + 1] : a;
+            const float frac = (float)(uint32_t)v.pos * (1.0f / 4294967296.0f);
+            const float g = fading ? scale * (float)(v.fade - (int)i) / (float)FADE_FRAMES : scale;
+            mix[i] += (a + (b - a) * frac) * g;
+            v.pos += v.step;
+        }
+    }
+
+    if (fading) v.fade -= (int)i;
+    if ((v.pos >> 32) >= len || (fading && v.fade <= 0)) Retire(v);
+    return i;
+}
+
+size_t AudioMixer::MixStream(Voice& v, float* mix, size_t frames) {
+    VoiceStream& s = *v.stream;
+    if (s.IsCancelled()) { Retire(v); return 0; }
+
+    // 'finished' first: once it is set, WritePos() already covers every sample
+    const bool finished = s.m_finished.load(std::memory_order_acquire);
+    const uint64_t len = s.m_ring.WritePos();
+
+    if (!s.m_started) {
+        if (len < s.m_jitter && !finished) return 0;   // jitter buffer still filling
+        s.m_started = true;
+    }
+
+    const float scale = v.gain / 32768.0f;
+    const bool fading = v.fade > 0;
+    const size_t n = fading ? std::min(frames, (size_t)v.fade) : frames;
+    size_t i = 0;
+    for (; i < n; ++i) {
+        const uint64_t idx = v.pos >> 32;
+        if (idx + 1 >= len && !(finished && idx < len)) {
+            // the synthesizer is behind: count it once, play silence until data arrives
+            if (!finished && !s.m_starving) {
+                s.m_starving = true;
+                s.m_underruns.fetch_add(1, std::memory_order_relaxed);
+                s_underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        }
+        s.m_starving = false;
+        const float a = s.m_ring.At((size_t)idx);
+        const float b = (idx + 1 < len) ? s.m_ring.At((size_t)idx + 1) : a;
+        const float frac = (float)(uint32_t)v.pos * (1.0f / 4294967296.0f);
+        const float g = fading ? scale * (float)(v.fade - (int)i) / (float)FADE_FRAMES : scale;
+        mix[i] += (a + (b - a) * frac) * g;
+        v.pos += v.step;
+    }
+
+    s.m_ring.Release((size_t)(v.pos >> 32));
+    if (fading) v.fade -= (int)i;
+    // a fading stream that starves is simply cut
+    if ((finished && (v.pos >> 32) >= len) || (fading && (v.fade <= 0 || i < n))) Retire(v);
+    return i;
+}
+
+void AudioMixer::Render(float* out, size_t frameCount, int channels) {
+    Command cmd;
+    while (s_commands.Pop(cmd)) Apply(cmd);
+
+    size_t done = 0;
+    while (done < frameCount) {
+        const size_t n = std::min(MIX_BLOCK, frameCount - done);
+        std::memset(s_mix, 0, n * sizeof(float));
+
+        for (auto& v : s_voices) {
+            if (v.pcm) MixVoice(v, s_mix, n);
+            else if (v.stream) MixStream(v, s_mix, n);
+        }
+
+        float* o = out + done * channels;
+        for (size_t i = 0; i < n; ++i) {
+            const float s = std::clamp(s_mix[i], -1.0f, 1.0f);
+            for (int c = 0; c < channels; ++c) o[i * channels + c] = s;
+        }
+        done += n;
+    }
+
+    int active = 0;
+    for (auto& v : s_voices) if (InUse(v)) active++;
+    s_activeVoices.store(active, std::memory_order_relaxed);
+}
+
+//EOF
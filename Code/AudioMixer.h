@@ -0,0 +1,113 @@
+#pragma once
+#include "AudioRingBuffer.h"
+#include "AudioBuffer.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+// AudioMixer.h
+// Real-time mixer behind the miniaudio playback callback. Finished PCM buffers are
+// immutable and handed over through a lock-free command queue; the callback mixes up
+// to MAX_VOICES of them, resampling each one linearly from its model rate to the device
+// rate. Buffers that finished playing are passed back through a second queue and freed
+// on the caller's thread (Collect), so the callback never locks, allocates or frees.
+// A VoiceStream is the streaming variant: the synthesizer writes PCM chunks while the
+// line already plays, playback starts once the jitter buffer is filled.
+
+class VoiceStream {
+public:
+    VoiceStream(int sampleRate, size_t capacitySamples, size_t jitterSamples);
+
+    // Producer side. Waits while the ring is full; gives up (and cancels) if playback
+    // does not consume anything for STALL_TIMEOUT_MS, e.g. the line was never started.
+    size_t Write(const int16_t* pcm, size_t count);
+    void Finish() { m_finished.store(true, std::memory_order_release); }
+    void Cancel() { m_cancelled.store(true, std::memory_order_release); }
+
+    bool IsCancelled() const { return m_cancelled.load(std::memory_order_acquire); }
+    uint32_t Underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+    int SampleRate() const { return m_rate; }
+
+    static constexpr int STALL_TIMEOUT_MS = 3000;
+
+private:
+    friend class AudioMixer;
+    AudioRingBuffer<int16_t> m_ring;
+    size_t m_jitter;
+    int m_rate;
+    std::atomic<bool> m_finished{ false };
+    std::atomic<bool> m_cancelled{ false };
+    std::atomic<uint32_t> m_underruns{ 0 };
+    bool m_started = false;      // callback only
+    bool m_starving = false;     // callback only
+};
+using StreamHandle = std::shared_ptr<VoiceStream>;
+
+class AudioMixer {
+public:
+    static constexpr int MAX_VOICES = 8;
+
+    // Not thread-safe, call before the device starts / after it stopped
+    static void Init(int deviceRate);
+    static void Shutdown();
+
+    // voiceKey: a new buffer with the same key replaces the old one (one line per speaker),
+    // different keys play at the same time. Returns false if the command queue is full.
+    static bool Play(PcmRef pcm, int sampleRate, uint32_t voiceKey = 0, float gain = 1.0f);
+    static void Stop(uint32_t voiceKey);
+    static void StopAll();
+    // Streams use their own sample rate, see VoiceStream
+    static bool PlayStream(StreamHandle stream, uint32_t voiceKey = 0, float gain = 1.0f);
+
+    // Frees buffers the callback is done with. Called from Play/Stop, safe from any thread.
+    static void Collect();
+
+    static int ActiveVoices() { return s_activeVoices.load(std::memory_order_relaxed); }
+    static uint64_t TotalUnderruns() { return s_underruns.load(std::memory_order_relaxed); }
+
+    // miniaudio callback
+    static void Render(float* out, size_t frameCount, int channels);
+
+private:
+    enum class CommandType : uint8_t { PLAY, STOP, STOP_ALL };
+    struct Command {
+        CommandType type = CommandType::PLAY;
+        PcmRef pcm;
+        StreamHandle stream;
+        uint64_t step = 0;          // 32.32 fixed point, source samples per output frame
+        uint32_t key = 0;
+        float gain = 1.0f;
+    };
+    struct Voice {
+        PcmRef pcm;
+        StreamHandle stream;
+        uint64_t pos = 0;           // 32.32 fixed point source position
+        uint64_t step = 0;
+        uint32_t key = 0;
+        float gain = 1.0f;
+        int fade = 0;               // > 0: fading out, frames left
+        uint64_t started = 0;
+    };
+
+    static void Apply(Command& cmd);
+    static void Retire(Voice& v);
+    static size_t MixVoice(Voice& v, float* mix, size_t frames);
+    static size_t MixStream(Voice& v, float* mix, size_t frames);
+    static bool InUse(const Voice& v) { return v.pcm || v.stream; }
+
+    static constexpr size_t QUEUE_SIZE = 64;
+    static constexpr size_t MIX_BLOCK = 512;
+
+    static AudioQueue<Command, QUEUE_SIZE> s_commands;
+    static AudioQueue<PcmRef, QUEUE_SIZE * 2> s_retired;   // > commands in flight + voices, never full
+    static AudioQueue<StreamHandle, QUEUE_SIZE * 2> s_retiredStreams;
+    static Voice s_voices[MAX_VOICES];       // owned by the callback thread
+    static float s_mix[MIX_BLOCK];
+    static uint64_t s_playCounter;
+    static int s_deviceRate;
+    static std::atomic<int> s_activeVoices;
+    static std::atomic<uint64_t> s_underruns;
+};
+
+//EOF
@@ -0,0 +1,157 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// AudioRingBuffer.h
+// Preallocated single-producer / single-consumer ring buffer for microphone capture.
+// The producer (miniaudio callback) never allocates, locks or waits: if the consumer
+// has not released enough space, the samples are dropped and counted.
+// Positions are absolute sample indices since Reset(), so a reader can keep a
+// "committed up to" index across wrap-arounds. Span() returns a pointer straight into
+// the storage and only copies when the requested range wraps.
+//
+// AudioQueue is a fixed-size multi-producer / multi-consumer queue of small messages
+// (bounded, per-slot sequence numbers). Push and Pop never lock or allocate, so the
+// playback callback can use it to receive voices and hand finished buffers back.
+
+template <class T>
+class AudioRingBuffer {
+public:
+    // Not thread-safe, call while the capture device is stopped
+    void Allocate(size_t minCapacity) {
+        size_t cap = 1;
+        while (cap < minCapacity) cap <<= 1;
+        m_data.assign(cap, T());
+        m_mask = cap - 1;
+        Reset();
+    }
+
+    // Not thread-safe, call while nobody reads or writes (readers hold a CaptureReadLease)
+    void Reset() {
+        m_write.store(0, std::memory_order_relaxed);
+        m_read.store(0, std::memory_order_relaxed);
+        m_overflow.store(0, std::memory_order_relaxed);
+    }
+
+    size_t Capacity() const { return m_data.size(); }
+
+    // --- Producer ---
+    size_t Write(const T* src, size_t count) {
+        if (m_data.empty()) return 0;
+        const size_t w = m_write.load(std::memory_order_relaxed);
+        const size_t r = m_read.load(std::memory_order_acquire);
+        const size_t space = m_data.size() - (w - r);
+        size_t n = count < space ? count : space;
+        if (n < count) m_overflow.fetch_add(count - n, std::memory_order_relaxed);
+        if (n == 0) return 0;
+
+        const size_t pos = w & m_mask;
+        const size_t first = (pos + n <= m_data.size()) ? n : m_data.size() - pos;
+        std::memcpy(&m_data[pos], src, first * sizeof(T));
+        if (n > first) std::memcpy(&m_data[0], src + first, (n - first) * sizeof(T));
+
+        m_write.store(w + n, std::memory_order_release);
+        return n;
+    }
+
+    // --- Consumer ---
+    size_t WritePos() const { return m_write.load(std::memory_order_acquire); }
+    size_t ReadPos() const { return m_read.load(std::memory_order_relaxed); }
+    uint64_t Overflows() const { return m_overflow.load(std::memory_order_relaxed); }
+
+    // Single element by absolute index, caller keeps ReadPos() <= index < WritePos()
+    const T& At(size_t index) const { return m_data[index & m_mask]; }
+
+    // Frees everything before the absolute index 'upTo' for the producer
+    void Release(size_t upTo) {
+        const size_t w = m_write.load(std::memory_order_acquire);
+        if (upTo > w) upTo = w;
+        if (upTo > m_read.load(std::memory_order_relaxed)) m_read.store(upTo, std::memory_order_release);
+    }
+
+    // Contiguous view of [from, WritePos()). 'from' below ReadPos() is clamped.
+    // Points into the ring unless the range wraps, then into 'scratch'.
+    const T* Span(size_t from, size_t& count, std::vector<T>& scratch) const {
+        const size_t w = m_write.load(std::memory_order_acquire);
+        const size_t r = m_read.load(std::memory_order_relaxed);
+        if (from < r) from = r;
+        count = (from < w) ? w - from : 0;
+        if (count == 0) return nullptr;
+
+        const size_t pos = from & m_mask;
+        if (pos + count <= m_data.size()) return &m_data[pos];
+
+        const size_t first = m_data.size() - pos;
+        scratch.resize(count);
+        std::memcpy(scratch.data(), &m_data[pos], first * sizeof(T));
+        std::memcpy(scratch.data() + first, &m_data[0], (count - first) * sizeof(T));
+        return scratch.data();
+    }
+
+private:
+    std::vector<T> m_data;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_write{ 0 };
+    alignas(64) std::atomic<size_t> m_read{ 0 };
+    std::atomic<uint64_t> m_overflow{ 0 };
+};
+
+template <class T, size_t N>
+class AudioQueue {
+    static_assert((N & (N - 1)) == 0, "AudioQueue size must be a power of two");
+public:
+    AudioQueue() {
+        for (size_t i = 0; i < N; ++i) m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // false = full, 'value' is left untouched
+    bool Push(T& value) {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = m_cells[pos & (N - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = std::move(value);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false;
+            else pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool Pop(T& out) {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = m_cells[pos & (N - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(c.value);
+                    c.seq.store(pos + N, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false;
+            else pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+    Cell m_cells[N];
+    alignas(64) std::atomic<size_t> m_tail{ 0 };
+    alignas(64) std::atomic<size_t> m_head{ 0 };
+};
+
+//EOF
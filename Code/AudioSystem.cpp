@@ -1,5 +1,9 @@
 #include "AudioSystem.h"
 #include "AudioManager.h"
+#include "TtsPipeline.h"
+#include "PhonemeCache.h"
+#include "PcmCache.h"
+#include "OrtTuning.h"
 #include "babylon/babylon.h"
 #include "main.h"
 #include <cstring>
@@ -10,56 +14,13 @@
 std::unique_ptr<DeepPhonemizer::Session> AudioSystem::s_g2p_session = nullptr;
 std::unique_ptr<ma_device> AudioSystem::s_device = nullptr;
 bool AudioSystem::s_isInitialized = false;
-std::mutex AudioSystem::s_generationMutex;
+std::mutex AudioSystem::s_g2pMutex;
 
-std::vector<int16_t> AudioSystem::s_audioBuffer;
-float AudioSystem::s_playCursor = 0.0f;
-float AudioSystem::s_resampleStep = 1.0f;
-std::mutex AudioSystem::s_bufferMutex;
 std::atomic<AudioState> AudioSystem::s_state(AudioState::UNINITIALIZED);
 
 
 
 
-struct WAV_HEADER {
-    char riff[4] = { 'R', 'I', 'F', 'F' };
-    uint32_t overall_size;
-    char wave[4] = { 'W', 'A', 'V', 'E' };
-    char fmt_chunk_marker[4] = { 'f', 'm', 't', ' ' };
-    uint32_t length_of_fmt = 16;
-    uint16_t format_type = 1; // PCM
-    uint16_t channels = 1;    // Mono 
-    uint32_t sample_rate;
-    uint32_t byterate;
-    uint16_t block_align;
-    uint16_t bits_per_sample = 16;
-    char data_chunk_header[4] = { 'd', 'a', 't', 'a' };
-    uint32_t data_size;
-};
-
-
-void WriteDebugWav(const std::string& filename, const std::vector<int16_t>& data, int sampleRate) {
-    if (data.empty()) return;
-
-    std::ofstream f(filename, std::ios::binary);
-    if (!f.is_open()) return;
-
-    WAV_HEADER header;
-    header.sample_rate = sampleRate;
-    header.bits_per_sample = 16;
-    header.channels = 1;
-    header.data_size = data.size() * sizeof(int16_t);
-    header.overall_size = header.data_size + 36;
-    header.block_align = header.channels * header.bits_per_sample / 8;
-    header.byterate = header.sample_rate * header.block_align;
-
-    f.write((char*)&header, sizeof(WAV_HEADER));
-    f.write((char*)data.data(), header.data_size);
-    f.close();
-
-    Log("AudioSystem: [DEBUG] Saved " + filename + " (" + std::to_string(data.size()) + " samples)");
-}
-
 void ORT_API_CALL OnnxLogCallback(void* param, OrtLoggingLevel severity, const char* category,
     const char* logid, const char* code_location, const char* message);
 
@@ -82,11 +43,28 @@ bool AudioSystem::Initialize(const std::string& g2pModelPath, int hardwareRate)
 
         // --- TEST B: BABYLON KONSTRUKTOR ---
         Log("AudioSystem: [STEP 3] Attempting to create DeepPhonemizer Session...");
-        // Wir nutzen hier testweise den aller-simpelsten Aufruf
+        // ORT env (our logger) before the first babylon session
+        OrtTuning::Init();
         s_g2p_session = std::make_unique<DeepPhonemizer::Session>(g2pModelPath);
 
         Log("AudioSystem: [STEP 4] DeepPhonemizer Session created successfully");
 
+        // Phoneme cache, warmed with every name an NPC can say or be called
+        PhonemeCache::Init(g2pModelPath, (size_t)std::max(0, ConfigReader::g_Settings.TTS_PHONEME_CACHE), RawG2p);
+        std::vector<std::string> names;
+        ConfigReader::ForEachPersona([&names](const NpcPersona& p) { names.push_back(p.inGameName); });
+        for (const auto& kv : ConfigReader::Current()->defaultTypes) names.push_back(kv.second.inGameName);
+        names.insert(names.end(), MALE_FIRST_NAMES.begin(), MALE_FIRST_NAMES.end());
+        names.insert(names.end(), FEMALE_FIRST_NAMES.begin(), FEMALE_FIRST_NAMES.end());
+        names.insert(names.end(), LAST_NAMES.begin(), LAST_NAMES.end());
+        PhonemeCache::WarmAsync(std::move(names));
+
+        const auto& s = ConfigReader::g_Settings;
+        std::string pcmFolder = (std::filesystem::path(g2pModelPath).parent_path().parent_path() / "AudioCache").string();
+        PcmCache::Init(pcmFolder, (size_t)std::max(0, s.TTS_AUDIO_CACHE_MB) * 1024 * 1024,
+            (PcmCodec)std::clamp(s.TTS_AUDIO_CACHE_CODEC, 0, 2), s.TTS_AUDIO_CACHE_DISK != 0, (size_t)std::max(0, s.TTS_AUDIO_CACHE_MAX_CHARS));
+        if (s.TTS_DEBUG_WAV) WavRecorder::Start("");
+
         // --- TEST C: MINIAUDIO ---
         Log("AudioSystem: [STEP 5] Initializing Miniaudio device...");
         s_device = std::make_unique<ma_device>();
@@ -97,6 +75,7 @@ bool AudioSystem::Initialize(const std::string& g2pModelPath, int hardwareRate)
         config.playback.channels = 2;
         config.sampleRate = hardwareRate;
         config.dataCallback = miniaudio_callback;
+        AudioMixer::Init(hardwareRate);
 
         Log("AudioSystem: [STEP 7] Calling ma_device_init...");
         if (ma_device_init(NULL, &config, s_device.get()) != MA_SUCCESS) {
@@ -113,6 +92,8 @@ bool AudioSystem::Initialize(const std::string& g2pModelPath, int hardwareRate)
         Log("AudioSystem: [STEP 9] Audio Engine started");
         s_state = AudioState::IDLE;
         s_isInitialized = true;
+
+        TtsPipeline::Init(ConfigReader::g_Settings.TTS_WORKERS, ConfigReader::g_Settings.TTS_QUEUE_DEPTH);
         return true;
 
     }
@@ -126,88 +107,132 @@ bool AudioSystem::Initialize(const std::string& g2pModelPath, int hardwareRate)
     }
 }
 
-void AudioSystem::PlayBuffer(const std::vector<int16_t>& pcmData, int modelRate) {
-    if (pcmData.empty()) return;
-    std::lock_guard<std::mutex> lock(s_bufferMutex);
-
-    s_audioBuffer = pcmData;
-    s_playCursor = 0.0f;
-
+void AudioSystem::PlayBuffer(const PcmRef& pcmData, int modelRate, uint32_t voiceKey) {
+    if (PcmEmpty(pcmData) || !s_device) return;
+    AudioMixer::Play(pcmData, modelRate, voiceKey);
+}
 
-    if (s_device) {
-        s_resampleStep = (float)modelRate / (float)s_device->sampleRate;
-    }
-    s_state = AudioState::PLAYING;
+StreamHandle AudioSystem::OpenStream(int modelRate) {
+    // 8 s ring, the producer waits when it is ahead of playback
+    size_t jitter = (size_t)std::max(0, ConfigReader::g_Settings.TTS_STREAM_JITTER_MS) * (size_t)modelRate / 1000;
+    return std::make_shared<VoiceStream>(modelRate, (size_t)modelRate * 8, jitter);
 }
 
-std::vector<int16_t> AudioSystem::Generate(const std::string& text, Vits::Session* voiceSession, int speakerID, float speed, float noise, float noise_w) {
-    // Sicherheitschecks
-    if (!s_isInitialized || !voiceSession || text.empty()) return {};
+void AudioSystem::PlayStream(const StreamHandle& stream, uint32_t voiceKey) {
+    if (!stream) return;
+    if (!s_device) { stream->Cancel(); return; }
+    AudioMixer::PlayStream(stream, voiceKey);
+}
 
-    std::lock_guard<std::mutex> lock(s_generationMutex);
-    try {
-        // 1. Text zu Phonemen
-        std::vector<std::string> phonemes = s_g2p_session->g2p(text);
+static PcmKey MakePcmKey(const std::string& text, const std::string& modelKey, int speakerID, float speed, float noise, float noise_w) {
+    PcmKey key;
+    key.model = modelKey;
+    key.speaker = speakerID;
+    key.speed = speed;
+    key.noise = noise;
+    key.noise_w = noise_w;
+    key.text = text;
+    return key;
+}
 
-        // 2. Phoneme zu Audio (PCM)
-        std::vector<int16_t> pcm = voiceSession->tts_to_memory(phonemes, speakerID, speed, noise, noise_w);
+bool AudioSystem::LookupCached(const std::string& text, const std::string& modelKey, int speakerID, float speed, float noise, float noise_w, PcmRef& out, bool countMiss) {
+    if (!s_isInitialized || modelKey.empty()) return false;
+    std::vector<int16_t> pcm;
+    if (!PcmCache::Find(MakePcmKey(text, modelKey, speakerID, speed, noise, noise_w), pcm, countMiss)) return false;
+    out = MakePcm(std::move(pcm));
+    return true;
+}
 
-        // --- DEBUG: SPEICHERN AUF FESTPLATTE ---
-        if (!pcm.empty()) {
-            static int counter = 0;
-            std::string fname = "debug_tts_" + std::to_string(counter++ % 5) + ".wav";
+PcmRef AudioSystem::Generate(const std::string& text, Vits::Session* voiceSession, int speakerID, float speed, float noise, float noise_w, const std::string& modelKey, StreamHandle stream) {
+    // Sicherheitschecks
+    if (!s_isInitialized || !voiceSession || text.empty()) {
+        if (stream) stream->Finish();
+        return nullptr;
+    }
 
-            int rate = 22050;
+    PcmRef cached;
+    if (LookupCached(text, modelKey, speakerID, speed, noise, noise_w, cached)) {
+        if (stream) {
+            stream->Write(cached->data(), cached->size());
+            stream->Finish();
+        }
+        return cached;
+    }
 
-            WriteDebugWav(fname, pcm, rate);
+    std::vector<int16_t> pcm;
+    try {
+        // Text -> Phoneme -> PCM, satzweise in der Pipeline
+        TtsRequest req;
+        req.session = voiceSession;
+        req.speakerID = speakerID;
+        req.speed = speed;
+        req.noise = noise;
+        req.noise_w = noise_w;
+        if (stream) {
+            req.onChunk = [stream](const std::vector<int16_t>& chunk) { stream->Write(chunk.data(), chunk.size()); };
         }
-        // ---------------------------------------
-        return pcm;
+        double inferenceSeconds = 0.0;
+        pcm = TtsPipeline::Synthesize(text, req, &inferenceSeconds);
+        if (!modelKey.empty()) PcmCache::Store(MakePcmKey(text, modelKey, speakerID, speed, noise, noise_w), pcm);
+        if (!modelKey.empty() && !pcm.empty()) AudioManager::ReportSynthesis(modelKey, inferenceSeconds, pcm.size() / 22050.0);
+
     }
     catch (const std::exception& e) {
         Log("AudioSystem: [ERROR] Exception in Generate: " + std::string(e.what()));
-        return {};
+        pcm.clear();
     }
     catch (...) {
-        return {};
+        pcm.clear();
     }
-}
 
-void AudioSystem::OnAudioData(float* pOutput, size_t frameCount, int channels) {
-    if (s_state != AudioState::PLAYING) {
-        std::memset(pOutput, 0, frameCount * channels * sizeof(float));
-        return;
-    }
+    if (stream) stream->Finish();
+    if (pcm.empty()) return nullptr;
 
-    std::lock_guard<std::mutex> lock(s_bufferMutex);
-    for (size_t i = 0; i < frameCount; ++i) {
-        float sampleVal = 0.0f;
-        size_t idx = (size_t)s_playCursor;
+    // Ab hier nur noch Referenzen, keine Kopien (Subtitles, Mixer, Debug-Dump)
+    PcmRef result = MakePcm(std::move(pcm));
+    WavRecorder::Record(result, 22050);
+    return result;
+}
 
-        if (idx < s_audioBuffer.size()) {
-            sampleVal = s_audioBuffer[idx] / 32768.0f;
-            s_playCursor += s_resampleStep;
-        }
+std::vector<std::string> AudioSystem::Phonemize(const std::string& text) {
+    if (!s_g2p_session || text.empty()) return {};
+    if (PhonemeCache::IsEnabled()) return PhonemeCache::Phonemize(text);
+    return RawG2p(text);
+}
 
-        for (int c = 0; c < channels; ++c) pOutput[i * channels + c] = sampleVal;
+std::vector<std::string> AudioSystem::RawG2p(const std::string& text) {
+    if (!s_g2p_session || text.empty()) return {};
+
+    std::lock_guard<std::mutex> lock(s_g2pMutex);
+    try {
+        return s_g2p_session->g2p(text);
     }
+    catch (const std::exception& e) {
+        Log("AudioSystem: [ERROR] Exception in Phonemize: " + std::string(e.what()));
+        return {};
+    }
+}
 
-    if ((size_t)s_playCursor >= s_audioBuffer.size()) s_state = AudioState::IDLE;
+// Echtzeit-Thread: nur mischen, kein Lock, keine Allokation
+void AudioSystem::OnAudioData(float* pOutput, size_t frameCount, int channels) {
+    AudioMixer::Render(pOutput, frameCount, channels);
 }
 
 void AudioSystem::Stop() {
-    std::lock_guard<std::mutex> lock(s_bufferMutex);
-    s_audioBuffer.clear();
-    s_playCursor = 0.0f;
-    s_state = AudioState::IDLE;
+    AudioMixer::StopAll();
 }
 
 void AudioSystem::Shutdown() {
+    TtsPipeline::Shutdown();
+    PhonemeCache::Shutdown();
+    PcmCache::Shutdown();
+    WavRecorder::Stop();
     Stop();
     if (s_device) {
         ma_device_uninit(s_device.get());
         s_device.reset(); 
     }
+    AudioMixer::Shutdown();
     s_g2p_session.reset();
     s_isInitialized = false;
     s_state = AudioState::UNINITIALIZED;
@@ -225,7 +250,8 @@ bool AudioSystem::IsInitialized() {
 }
 
 AudioState AudioSystem::GetState() { 
-    return s_state.load(); 
+    if (s_state.load() == AudioState::UNINITIALIZED) return AudioState::UNINITIALIZED;
+    return AudioMixer::ActiveVoices() > 0 ? AudioState::PLAYING : AudioState::IDLE;
 }
 
 void ORT_API_CALL OnnxLogCallback(void* param, OrtLoggingLevel severity, const char* category,
@@ -6,6 +6,7 @@
 #include <mutex>
 #include <atomic>
 #include <memory>
+#include "AudioMixer.h"
 
 // Forward declarations
 namespace DeepPhonemizer { class Session; }
@@ -19,17 +20,29 @@ public:
     static bool Initialize(const std::string& g2pModelPath, int hardwareRate = 22050);
     static void Shutdown();
     static int GetSampleRate();
-    static std::vector<int16_t> Generate(
+    static PcmRef Generate(
         const std::string& text,
         Vits::Session* voiceSession,
         int speakerID = 0,
         float speed = 1.0f,
         float noise = 0.667f,
-        float noise_w = 0.8f
+        float noise_w = 0.8f,
+        const std::string& modelKey = "",  // enables PcmCache for this line
+        StreamHandle stream = nullptr       // optional: every sentence is written here as soon as it is ready
     );
+    // Cache-only lookup, works before the voice model is loaded. countMiss = false when
+    // Generate follows on a miss and looks the line up again.
+    static bool LookupCached(const std::string& text, const std::string& modelKey, int speakerID,
+        float speed, float noise, float noise_w, PcmRef& out, bool countMiss = true);
+    // Text -> phonemes with the shared DeepPhonemizer session (serialized, used by TtsPipeline)
+    static std::vector<std::string> Phonemize(const std::string& text);
     void OnnxLogCallback(void* param, OrtLoggingLevel severity, const char* category,         const char* logid, const char* code_location, const char* message);
     
-    static void PlayBuffer(const std::vector<int16_t>& pcmData, int modelRate = 22050);
+    // voiceKey: lines with the same key replace each other, different keys are mixed
+    static void PlayBuffer(const PcmRef& pcmData, int modelRate = 22050, uint32_t voiceKey = 0);
+    // Streaming playback: open, hand to PlayStream (or a subtitle), fill through Generate
+    static StreamHandle OpenStream(int modelRate = 22050);
+    static void PlayStream(const StreamHandle& stream, uint32_t voiceKey = 0);
     static void Stop();
 
     static bool IsInitialized();
@@ -39,12 +52,9 @@ public:
 private:
     static std::unique_ptr<DeepPhonemizer::Session> s_g2p_session;
     static std::unique_ptr<ma_device> s_device;
-    static std::mutex s_generationMutex;
+    static std::mutex s_g2pMutex;
+    static std::vector<std::string> RawG2p(const std::string& text);
     static bool s_isInitialized;
 
-    static std::vector<int16_t> s_audioBuffer;
-    static float s_playCursor;      // Gendert auf float fr Resampling
-    static float s_resampleStep;    // Neu hinzugefgt
-    static std::mutex s_bufferMutex;
     static std::atomic<AudioState> s_state;
 };
\ No newline at end of file
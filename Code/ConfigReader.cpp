@@ -1,6 +1,11 @@
 #include "main.h" 
+#include "SemanticIndex.h"
+#include "ConfigSnapshot.h"
+#include "ConfigWatcher.h"
+#include "PersonaTable.h"
 #include <algorithm> 
 #include <sstream>
+#include <chrono>
 
 using namespace AbstractGame;
 using namespace AbstractTypes;
@@ -10,28 +15,23 @@ using namespace AbstractTypes;
 const char* SETTINGS_INI_PATH = ".\\ECMod\\EC_DataFiles\\GTAV_EC_Settings.ini";
 const char* RELATIONSHIPS_INI_PATH = ".\\ECMod\\EC_DataFiles\\GTAV_EC_Relationships.ini";
 const char* PERSONAS_INI_PATH = ".\\ECMod\\EC_DataFiles\\GTAV_EC_Personas.ini";
-
-std::map<std::string, VoiceConfig> ConfigReader::g_VoiceMap;
-std::map<std::string, KnowledgeSection> ConfigReader::g_KnowledgeDB;
+const char* CONFIG_SNAPSHOT_PATH = ".\\ECMod\\EC_DataFiles\\EC_ConfigSnapshot.bin";
 
 // Initialization of static members
 ModSettings ConfigReader::g_Settings;
-std::map<uint32_t, NpcPersona> ConfigReader::g_PersonaCache;
-std::map<std::string, NpcPersona> ConfigReader::g_DefaultTypeCache;
-std::map<std::string, std::string> ConfigReader::g_RelationshipMatrix;
-std::map<std::string, std::string> ConfigReader::g_ZoneContextCache;
-std::map<std::string, std::string> ConfigReader::g_OrgContextCache;
 
-std::string ConfigReader::g_GlobalContextStyle;
-std::string ConfigReader::g_GlobalContextTimeEra;
-std::string ConfigReader::g_GlobalContextLocation;
-std::string ConfigReader::g_ContentGuidelines;
+std::shared_ptr<const ConfigData> ConfigReader::s_current;
+std::mutex ConfigReader::s_reloadMutex;
 
 // --- HELPER FUNCTION IMPLEMENTATIONS ---
 
-std::string ConfigReader::GetValueFromINI(const char* iniPath, const std::string& section, const std::string& key, const std::string& defaultValue) {
-    // [FIX] Abstraction: Using AOS
-    std::string value = AOS::GetIniValue(section, key, defaultValue, iniPath);
+std::string ConfigReader::GetValueFromINI(const IniDocument& ini, const std::string& section, const std::string& key, const std::string& defaultValue) {
+    return CleanValue(ini.Get(section, key), defaultValue);
+}
+
+// Value as the loaders want it: inline comment (';') cut off, trimmed, default if empty
+std::string ConfigReader::CleanValue(std::string_view raw, const std::string& defaultValue) {
+    std::string value(raw);
 
     // Process Comments (removes everything after ';')
     size_t commentPos = value.find(';');
@@ -123,148 +123,66 @@ uint32_t ConfigReader::GetHashFromHex(const std::string& hexString) {
     }
 }
 
-void ConfigReader::LoadINISectionToCache(const char* iniPath, const std::string& section, std::map<std::string, std::string>& cache) {
-    LogConfig("LoadINISectionToCache called for INI: " + std::string(iniPath) + ", section: " + section);
-
-    // [FIX] Abstraction: Using AOS to get raw section data
-    std::string sectionData = AOS::GetIniSection(section, iniPath);
-    if (sectionData.empty()) {
-        LogConfig("LoadINISectionToCache: No data read for section " + section);
-        return;
-    }
-
-    // Parse the double-null terminated style string manually if needed, 
-    // OR if AOS::GetIniSection returns a processed string map, use that.
-    // Based on PlatformSystem.cpp implementation, it returns the raw buffer (string).
-
-    // Windows GetPrivateProfileSection returns "key=val\0key2=val2\0\0"
-    // But std::string might stop at the first null. 
-    // *CORRECTION*: AOS::GetIniSection returns a std::string. If the OS returns double-null terminated buffer, 
-    // std::string constructor stops at the first null. 
-    // WE NEED TO FIX THIS LOGIC OR RELY ON A BETTER AOS FUNCTION.
-    //
-    // Let's assume AOS::GetIniSection returns a string where nulls are replaced by newlines, 
-    // OR we just use a loop over the raw buffer in PlatformSystem.cpp.
-    //
-    // BETTER APPROACH for this specific function:
-    // Since this logic is complex to abstract perfectly without a custom parser, 
-    // let's assume the string passed back contains "Key=Value" pairs separated by nulls 
-    // and the string length covers it all.
-
-    // Actually, looking at your original code, it iterated over a buffer.
-    // Let's rely on the fact that we can't easily pass a null-separated string via std::string.
-    // I will rewrite this to use the standard manual parser provided in your `LoadKnowledgeDatabase` which is cross-platform safe!
-
-    // ... Re-reading your original code: You used GetPrivateProfileSectionA which is Windows specific.
-    // Since we are abstracting, we should probably write a simple manual parser here 
-    // or assume AOS provides a map.
-
-    // FOR NOW: I will leave the parsing logic but adapted to a safer "Split by Null" assumption 
-    // if AOS handles it, but since std::string hates nulls, we will implement a MANUAL PARSE here 
-    // using standard file IO if possible? No, stick to AOS.
-
-    // Let's assume AOS::GetIniSection returns "key=val\nkey2=val2" (Standardized format).
-    // You should update PlatformSystem.cpp to replace \0 with \n.
-
-    const char* pKey = sectionData.c_str();
-    int len = (int)sectionData.length();
+void ConfigReader::LoadINISectionToCache(const IniDocument& ini, const std::string& section, std::map<std::string, std::string>& cache) {
+    // Every section of that name (duplicates are merged, the first key wins like IniDocument)
+    IniCaseEqual sameName;
     int entries = 0;
-
-    // Standard parser for "Key=Value" lines
-    // Note: This assumes AOS returned a string with embedded nulls or newlines.
-    // If AOS::GetIniSection returned a std::string, it likely truncated at the first null.
-    // 
-    // ** CRITICAL FIX **: We will use a FILE STREAM based approach for cross-platform safety here instead of Windows API.
-    // It's cleaner than trying to wrap GetPrivateProfileSection.
-
-    std::ifstream file(iniPath);
-    if (!file.is_open()) return;
-
-    std::string line;
-    bool inSection = false;
-    while (std::getline(file, line)) {
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        if (line.empty() || line[0] == ';') continue;
-
-        if (line[0] == '[') {
-            size_t end = line.find(']');
-            if (end != std::string::npos) {
-                std::string secName = line.substr(1, end - 1);
-                if (secName == section) inSection = true;
-                else inSection = false;
-            }
-            continue;
-        }
-
-        if (inSection) {
-            size_t sep = line.find('=');
-            if (sep != std::string::npos) {
-                std::string k = line.substr(0, sep);
-                std::string v = line.substr(sep + 1);
-                // Trim
-                k.erase(0, k.find_first_not_of(" \t"));
-                size_t kEnd = k.find_last_not_of(" \t");
-                if (kEnd != std::string::npos) k.erase(kEnd + 1);
-
-                v.erase(0, v.find_first_not_of(" \t"));
-                size_t vEnd = v.find_last_not_of(" \t\r\n");
-                if (vEnd != std::string::npos) v.erase(vEnd + 1);
-
-                cache[k] = v;
-                entries++;
-            }
+    for (const IniSection& sec : ini.Sections()) {
+        if (!sameName(sec.name, section)) continue;
+        for (const IniEntry& e : sec.entries) {
+            cache.emplace(std::string(e.key), std::string(e.value));
+            entries++;
         }
     }
-
+    if (entries == 0) {
+        LogConfig("LoadINISectionToCache: No data read for section " + section);
+        return;
+    }
     LogConfig("LoadINISectionToCache: Loaded " + std::to_string(entries) + " entries for section " + section);
 }
 
 // --- CORE LOADING FUNCTIONS ---
 
-void ConfigReader::LoadWorldContextDatabase() {
+void ConfigReader::LoadWorldContextDatabase(const IniDocument& ini, ConfigData& data) {
     LogConfig("LoadWorldContextDatabase started");
-    g_GlobalContextStyle = GetValueFromINI(SETTINGS_INI_PATH, "GLOBAL_CONTEXT", "STYLE");
-    g_GlobalContextTimeEra = GetValueFromINI(SETTINGS_INI_PATH, "GLOBAL_CONTEXT", "TIME_ERA");
-    g_GlobalContextLocation = GetValueFromINI(SETTINGS_INI_PATH, "GLOBAL_CONTEXT", "LOCATION");
-
-    LoadINISectionToCache(SETTINGS_INI_PATH, "KEY_ORGANIZATIONS", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "CITY_CONTEXT", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "MEDIA_AND_CULTURE", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "POLITICS", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "ECONOMY_AND_BRANDS", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "ENTERTAINMENT", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "HEALTH_AND_ISSUES", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "COMPANIES", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "GANGS", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "CELEBRITIES", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "NORTH_YANKTON", g_ZoneContextCache);
-    LoadINISectionToCache(SETTINGS_INI_PATH, "REGIONS_LIST", g_ZoneContextCache);
+    data.globalContextStyle = GetValueFromINI(ini, "GLOBAL_CONTEXT", "STYLE");
+    data.globalContextTimeEra = GetValueFromINI(ini, "GLOBAL_CONTEXT", "TIME_ERA");
+    data.globalContextLocation = GetValueFromINI(ini, "GLOBAL_CONTEXT", "LOCATION");
+    data.contentGuidelines = GetValueFromINI(ini, "CONTENT_GUIDELINES", "PROMPT_INJECTION", "You are a helpful assistant.");
+
+    LoadINISectionToCache(ini, "KEY_ORGANIZATIONS", data.zoneContext);
+    LoadINISectionToCache(ini, "CITY_CONTEXT", data.zoneContext);
+    LoadINISectionToCache(ini, "MEDIA_AND_CULTURE", data.zoneContext);
+    LoadINISectionToCache(ini, "POLITICS", data.zoneContext);
+    LoadINISectionToCache(ini, "ECONOMY_AND_BRANDS", data.zoneContext);
+    LoadINISectionToCache(ini, "ENTERTAINMENT", data.zoneContext);
+    LoadINISectionToCache(ini, "HEALTH_AND_ISSUES", data.zoneContext);
+    LoadINISectionToCache(ini, "COMPANIES", data.zoneContext);
+    LoadINISectionToCache(ini, "GANGS", data.zoneContext);
+    LoadINISectionToCache(ini, "CELEBRITIES", data.zoneContext);
+    LoadINISectionToCache(ini, "NORTH_YANKTON", data.zoneContext);
+    LoadINISectionToCache(ini, "REGIONS_LIST", data.zoneContext);
     LogConfig("LoadWorldContextDatabase completed");
 }
 
-void ConfigReader::LoadRelationshipDatabase() {
+void ConfigReader::LoadRelationshipDatabase(const IniDocument& ini, ConfigData& data) {
     LogConfig("LoadRelationshipDatabase started");
 
-    // [FIX] Abstraction: Using AOS
-    std::vector<std::string> sections = AOS::GetIniSectionNames(RELATIONSHIPS_INI_PATH);
-
-    if (sections.empty()) {
+    if (ini.Sections().empty()) {
         LogConfig("LoadRelationshipDatabase: No sections found in " + std::string(RELATIONSHIPS_INI_PATH));
         return;
     }
 
     int sectionCount = 0;
-    for (const auto& sectionName : sections) {
+    for (const IniSection& sec : ini.Sections()) {
+        const std::string sectionName(sec.name);
         if (sectionName == "RELATIONSHIPS" || sectionName == "TYPES" || sectionName == "GENDERS" ||
             sectionName == "GANG_SUBGROUPS" || sectionName == "LAW_SUBGROUPS" ||
             sectionName == "PRIVATE_SUBGROUPS" || sectionName == "BUSINESS_SUBGROUPS") {
             continue;
         }
-        std::map<std::string, std::string> sectionCache;
-        LoadINISectionToCache(RELATIONSHIPS_INI_PATH, sectionName, sectionCache);
-        for (const auto& pair : sectionCache) {
-            std::string key = sectionName + ":" + pair.first;
-            g_RelationshipMatrix[key] = pair.second;
+        for (const IniEntry& e : sec.entries) {
+            data.relationships[sectionName + ":" + std::string(e.key)] = std::string(e.value);
         }
         sectionCount++;
     }
@@ -272,146 +190,271 @@ void ConfigReader::LoadRelationshipDatabase() {
 }
 
 std::string ConfigReader::GetSetting(const std::string& section, const std::string& key) {
-    return GetValueFromINI(SETTINGS_INI_PATH, section, key);
+    auto config = Current();
+    return config->settingsIni ? GetValueFromINI(*config->settingsIni, section, key) : "";
 }
 
-void ConfigReader::LoadPersonaDatabase() {
+void ConfigReader::LoadPersonaDatabase(const IniDocument& ini, ConfigData& data) {
     LogConfig("LoadPersonaDatabase started");
 
-    // [FIX] Abstraction: Using AOS
-    std::vector<std::string> sections = AOS::GetIniSectionNames(PERSONAS_INI_PATH);
-
-    if (sections.empty()) {
+    if (ini.Sections().empty()) {
         LogConfig("LoadPersonaDatabase: No sections found in " + std::string(PERSONAS_INI_PATH));
         return;
     }
 
     int personaCount = 0;
-    for (const auto& sectionName : sections) {
+    std::map<uint32_t, NpcPersona> parsed;   // a later section for the same hash wins
+    for (const IniSection& sec : ini.Sections()) {
+        const std::string sectionName(sec.name);
         NpcPersona persona;
         persona.modelName = sectionName;
-        persona.modelHash = GetHashFromHex(GetValueFromINI(PERSONAS_INI_PATH, sectionName, "Hash"));
-        persona.isHuman = (GetValueFromINI(PERSONAS_INI_PATH, sectionName, "IsHuman") == "1");
-        persona.inGameName = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "InGameName");
-        persona.type = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "Type");
-        persona.relationshipGroup = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "Relationship");
-        persona.subGroup = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "SubGroup");
-        persona.gender = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "Gender");
-        persona.behaviorTraits = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "Behavior");
-        persona.p_audio_model = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "voicemodel");
-        persona.p_audio_ID = std::stoi(GetValueFromINI(PERSONAS_INI_PATH, sectionName, "voiceID"));
-        persona.LORAID = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "LORAID");
-        persona.LORAName = GetValueFromINI(PERSONAS_INI_PATH, sectionName, "LORAName");
+        persona.modelHash = GetHashFromHex(CleanValue(sec.Get("Hash")));
+        persona.isHuman = (CleanValue(sec.Get("IsHuman")) == "1");
+        persona.inGameName = CleanValue(sec.Get("InGameName"));
+        persona.type = CleanValue(sec.Get("Type"));
+        persona.relationshipGroup = CleanValue(sec.Get("Relationship"));
+        persona.subGroup = CleanValue(sec.Get("SubGroup"));
+        persona.gender = CleanValue(sec.Get("Gender"));
+        persona.behaviorTraits = CleanValue(sec.Get("Behavior"));
+        persona.p_audio_model = CleanValue(sec.Get("voicemodel"));
+        // Most personas have no voiceID, they keep the default instead of aborting the load
+        try { persona.p_audio_ID = std::stoi(CleanValue(sec.Get("voiceID"), std::to_string(persona.p_audio_ID))); }
+        catch (...) {}
+        persona.LORAID = CleanValue(sec.Get("LORAID"));
+        persona.LORAName = CleanValue(sec.Get("LORAName"));
         if (sectionName.find("DEFAULT_") == 0) {
-            g_DefaultTypeCache[persona.type] = persona;
+            data.defaultTypes[persona.type] = persona;
         }
         else if (persona.modelHash != 0) {
-            g_PersonaCache[persona.modelHash] = persona;
+            parsed[persona.modelHash] = persona;
         }
         personaCount++;
     }
+
+    data.personas.reserve(parsed.size());
+    data.personaTable = std::make_shared<PersonaTable>(parsed.size());
+    for (auto& kv : parsed) {
+        data.personas.push_back(std::make_shared<const NpcPersona>(std::move(kv.second)));
+        data.personaTable->Insert(data.personas.back());
+    }
     LogConfig("LoadPersonaDatabase: Loaded " + std::to_string(personaCount) + " personas");
 }
 
 // --- CORE PUBLIC FUNCTIONS ---
 void ConfigReader::LoadAllConfigs() {
     LogConfig("LoadAllConfigs started");
+    std::lock_guard<std::mutex> lock(s_reloadMutex);
     try {
-        g_Settings.Enabled = (GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "Enabled", "1") == "1");
-        g_Settings.ActivationKey = KeyNameToVK(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "ACTIVATION_KEY", "T"));
-        g_Settings.ActivationDurationMs = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "ACTIVATION_DURATION", "1000"));
-        g_Settings.StopKey_Primary = KeyNameToVK(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "STOP_KEY", "U"));
-        g_Settings.StopDurationMs = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "STOP_DURATION", "3000"));
-        g_Settings.MaxConversationRadius = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MAX_CONVERSATION_RADIUS", "3.0"));
-
-        g_Settings.MaxOutputChars = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MAX_OUTPUT_CHARS", "512"));
-        g_Settings.MaxInputChars = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MAX_INPUT_CHARS", "786"));
-        g_Settings.MaxHistoryTokens = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MAX_REMEMBER_HISTORY", "1024"));
-        g_Settings.MaxChatHistoryLines = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MAX_PROMPT_MEMORY_HALFED", "16"));
-        g_Settings.MinResponseDelayMs = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MIN_RESPONSE_DELAY_MS", "750"));
-
-        g_Settings.USE_VRAM_PREFERED = (GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "USE_VRAM_PREFERED", "1") == "1");
-        g_Settings.USE_GPU_LAYERS = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "USE_GPU_LAYERS", "33"));
+        // Each file is read and indexed once, every lookup below is a hash lookup in memory
+        auto settingsDoc = std::make_shared<IniDocument>();
+        if (!settingsDoc->Load(SETTINGS_INI_PATH)) LogConfig("LoadAllConfigs: Cannot read " + std::string(SETTINGS_INI_PATH));
+        const IniDocument& settingsIni = *settingsDoc;
+
+        g_Settings.Enabled = (GetValueFromINI(settingsIni, "SETTINGS", "Enabled", "1") == "1");
+        g_Settings.ActivationKey = KeyNameToVK(GetValueFromINI(settingsIni, "SETTINGS", "ACTIVATION_KEY", "T"));
+        g_Settings.ActivationDurationMs = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "ACTIVATION_DURATION", "1000"));
+        g_Settings.StopKey_Primary = KeyNameToVK(GetValueFromINI(settingsIni, "SETTINGS", "STOP_KEY", "U"));
+        g_Settings.StopDurationMs = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "STOP_DURATION", "3000"));
+        g_Settings.MaxConversationRadius = std::stof(GetValueFromINI(settingsIni, "SETTINGS", "MAX_CONVERSATION_RADIUS", "3.0"));
+
+        g_Settings.MaxOutputChars = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "MAX_OUTPUT_CHARS", "512"));
+        g_Settings.MaxInputChars = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "MAX_INPUT_CHARS", "786"));
+        g_Settings.MaxHistoryTokens = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "MAX_REMEMBER_HISTORY", "1024"));
+        g_Settings.MaxChatHistoryLines = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "MAX_PROMPT_MEMORY_HALFED", "16"));
+        g_Settings.MinResponseDelayMs = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "MIN_RESPONSE_DELAY_MS", "750"));
+
+        g_Settings.USE_VRAM_PREFERED = (GetValueFromINI(settingsIni, "SETTINGS", "USE_VRAM_PREFERED", "1") == "1");
+        g_Settings.USE_GPU_LAYERS = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "USE_GPU_LAYERS", "33"));
 
         // Models & Logging
-        g_Settings.MODEL_PATH = GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MODEL_PATH", "");
-        g_Settings.MODEL_ALT_NAME = GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MODEL_ALT_NAME", "Phi3.gguf");
-        g_Settings.LOG_NAME = GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "LOG_NAME", "kkamel.log");
-        g_Settings.DEBUG_LEVEL = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "DEBUG_LEVEL", "0"));
+        g_Settings.MODEL_PATH = GetValueFromINI(settingsIni, "SETTINGS", "MODEL_PATH", "");
+        g_Settings.MODEL_ALT_NAME = GetValueFromINI(settingsIni, "SETTINGS", "MODEL_ALT_NAME", "Phi3.gguf");
+        g_Settings.LOG_NAME = GetValueFromINI(settingsIni, "SETTINGS", "LOG_NAME", "kkamel.log");
+        g_Settings.DEBUG_LEVEL = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "DEBUG_LEVEL", "0"));
 
         // STT / TTS
-        g_Settings.StT_Enabled = (GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "SPEECH_TO_TEXT", "0") == "1");
-        g_Settings.StTRB_Activation_Key = KeyNameToVK(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "SPEECH_TO_TEXT_RECORDING_BUTTON", "L"));
-        g_Settings.STT_MODEL_PATH = GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "STT_MODEL_PATH", "");
-        g_Settings.STT_MODEL_ALT_NAME = GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "STT_MODEL_ALT_NAME", "ggml-base.en.bin");
+        g_Settings.StT_Enabled = (GetValueFromINI(settingsIni, "SETTINGS", "SPEECH_TO_TEXT", "0") == "1");
+        g_Settings.StTRB_Activation_Key = KeyNameToVK(GetValueFromINI(settingsIni, "SETTINGS", "SPEECH_TO_TEXT_RECORDING_BUTTON", "L"));
+        g_Settings.STT_MODEL_PATH = GetValueFromINI(settingsIni, "SETTINGS", "STT_MODEL_PATH", "");
+        g_Settings.STT_MODEL_ALT_NAME = GetValueFromINI(settingsIni, "SETTINGS", "STT_MODEL_ALT_NAME", "ggml-base.en.bin");
 
-        g_Settings.TtS_Enabled = (GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "TEXT_TO_SPEECH", "0") == "1");
-        g_Settings.TTS_MODEL_PATH = GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "TTS__MODEL_PATH", "");
-        g_Settings.TTS_MODEL_ALT_NAME = GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "TTS_MODEL_ALT_NAME", "");
+        g_Settings.TtS_Enabled = (GetValueFromINI(settingsIni, "SETTINGS", "TEXT_TO_SPEECH", "0") == "1");
+        g_Settings.TTS_MODEL_PATH = GetValueFromINI(settingsIni, "SETTINGS", "TTS__MODEL_PATH", "");
+        g_Settings.TTS_MODEL_ALT_NAME = GetValueFromINI(settingsIni, "SETTINGS", "TTS_MODEL_ALT_NAME", "");
 
         // 2. MEMORY & OPTIMIZATION SETTINGS
-        g_Settings.DeletionTimer = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "DELETION_TIMER", "120"));
-        g_Settings.MaxAllowedChatHistory = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MAX_ALLOWED_CHAT_HISTORY", "1"));
-        g_Settings.DeletionTimerClearFull = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "DELETION_TIMER_CLEAR_FULL", "160"));
+        g_Settings.DeletionTimer = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "DELETION_TIMER", "120"));
+        g_Settings.MaxAllowedChatHistory = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "MAX_ALLOWED_CHAT_HISTORY", "1"));
+        g_Settings.DeletionTimerClearFull = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "DELETION_TIMER_CLEAR_FULL", "160"));
 
-        g_Settings.TrySummarizeChat = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "TRY_SUMMARIZE_CHAT", "1"));
-        g_Settings.MIN_PCSREMEMBER_SIZE = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MIN_PCSREMEMBER_SIZE", "5"));
-        g_Settings.MAX_PCSREMEMBER_SIZE = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "MAX_PCSREMEMBER_SIZE", "256"));
-        g_Settings.Level_Optimization_Chat_Going = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "Level_Optimization_Chat_Going", "0"));
-        g_Settings.VRAM_BUDGET_MB = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "VRAM_BUDGET_MB", "7828"));
-        g_Settings.Allow_KV_Cache_Quantization_Type = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "Allow_KV_Cache_Quantization_Type","0"));
+        g_Settings.TrySummarizeChat = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "TRY_SUMMARIZE_CHAT", "1"));
+        g_Settings.MIN_PCSREMEMBER_SIZE = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "MIN_PCSREMEMBER_SIZE", "5"));
+        g_Settings.MAX_PCSREMEMBER_SIZE = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "MAX_PCSREMEMBER_SIZE", "256"));
+        g_Settings.Level_Optimization_Chat_Going = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "Level_Optimization_Chat_Going", "0"));
+        g_Settings.VRAM_BUDGET_MB = std::stoi(GetValueFromINI(settingsIni, "SETTINGS", "VRAM_BUDGET_MB", "7828"));
+        g_Settings.Allow_KV_Cache_Quantization_Type = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "Allow_KV_Cache_Quantization_Type","0"));
 
         
         // 3. ADDITIONAL SETTINGS
         // (Using standard try/catch blocks for safety as before)
-        try { g_Settings.Max_Working_Input = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "MAX_INPUT_SIZE", "4096")); }
+        try { g_Settings.Max_Working_Input = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "MAX_INPUT_SIZE", "4096")); }
         catch (...) {
             g_Settings.Max_Working_Input = 4069;
 
         }
-        try { g_Settings.n_batch = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "n_batch", "512")); }
+        try { g_Settings.n_batch = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "n_batch", "512")); }
         catch (...) { g_Settings.n_batch = 2888; }
-        try { g_Settings.n_ubatch = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "n_ubatch", "256")); }
+        try { g_Settings.n_ubatch = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "n_ubatch", "256")); }
         catch (...) { g_Settings.n_ubatch = 512; }
-        try { g_Settings.KV_Cache_Quantization_Type = std::stoi(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "kv_cache_model_quantization_type", "0")); }
+        try { g_Settings.KV_Cache_Quantization_Type = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "kv_cache_model_quantization_type", "0")); }
         catch (...) { g_Settings.KV_Cache_Quantization_Type = -1; }
-        try { g_Settings.temp = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "temp", "0.65")); }
+        try { g_Settings.temp = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "temp", "0.65")); }
         catch (...) { g_Settings.temp = 0.75; }
-        try { g_Settings.top_k = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "top_k", "40")); }
+        try { g_Settings.top_k = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "top_k", "40")); }
         catch (...) { g_Settings.top_k = 0.4; }
-        try { g_Settings.top_p = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "top_p", "0.95")); }
+        try { g_Settings.top_p = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "top_p", "0.95")); }
         catch (...) { g_Settings.top_p = 0.95; }
-        try { g_Settings.min_p = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "min_p", "0.05")); }
+        try { g_Settings.min_p = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "min_p", "0.05")); }
         catch (...) { g_Settings.min_p = 0.05; }
-        try { g_Settings.repeat_penalty = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "repeat_penatly", "1.1")); }
+        try { g_Settings.repeat_penalty = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "repeat_penatly", "1.1")); }
         catch (...) { g_Settings.repeat_penalty = 1.0; }
-        try { g_Settings.freq_penalty = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "freq_penalty", "0.0")); }
+        try { g_Settings.freq_penalty = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "freq_penalty", "0.0")); }
         catch (...) { g_Settings.freq_penalty = 0.0; }
-        try { g_Settings.presence_penalty = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "presence_penalty", "0.0")); }
+        try { g_Settings.presence_penalty = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "presence_penalty", "0.0")); }
         catch (...) { g_Settings.presence_penalty = 0.0; }
-        try { g_Settings.SAMPLER_TYPE = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "SAMPLER_TYPE", "1")); }
+        try { g_Settings.SAMPLER_TYPE = std::stof(GetValueFromINI(settingsIni, "SETTINGS", "SAMPLER_TYPE", "1")); }
         catch (...) { g_Settings.SAMPLER_TYPE = 1; }
-        try { g_Settings.FORCE_GPU_INDEX = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "FORCE_GPU_INDEX", "-1")); }
+        try { g_Settings.FORCE_GPU_INDEX = std::stof(GetValueFromINI(settingsIni, "SETTINGS", "FORCE_GPU_INDEX", "-1")); }
         catch (...) { g_Settings.FORCE_GPU_INDEX = -1; }
 
 
-        std::string loraEn = GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "lora_enabled", "0");
+        std::string loraEn = GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "lora_enabled", "0");
         g_Settings.Lora_Enabled;
-        g_Settings.LORA_ALT_NAME = GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "LORA_ALT_NAME", "mod_lora.gguf");
-        g_Settings.LORA_FILE_PATH = GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "LORA_FILE_PATH", "");
-        try { g_Settings.LORA_SCALE = std::stof(GetValueFromINI(SETTINGS_INI_PATH, "ADDITIONAL_SETTINGS", "LORA_SCALE", "1.0")); }
+        g_Settings.LORA_ALT_NAME = GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "LORA_ALT_NAME", "mod_lora.gguf");
+        g_Settings.LORA_FILE_PATH = GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "LORA_FILE_PATH", "");
+        try { g_Settings.LORA_SCALE = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "LORA_SCALE", "1.0")); }
         catch (...) {}
 
-        g_Settings.StopStrings = GetValueFromINI(SETTINGS_INI_PATH, "SETTINGS", "STOP_TOKENS", "");
-        g_ContentGuidelines = GetValueFromINI(SETTINGS_INI_PATH, "CONTENT_GUIDELINES", "PROMPT_INJECTION", "You are a helpful assistant.");
-
-        LoadWorldContextDatabase();
-        LoadRelationshipDatabase();
-        LoadPersonaDatabase();
-        LoadKnowledgeDatabase();
-
-        if (g_Settings.TtS_Enabled) {
-            LoadVoiceDatabase();
+        // Semantic knowledge retrieval
+        try { g_Settings.SEMANTIC_KNOWLEDGE = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "SEMANTIC_KNOWLEDGE", "0")); }
+        catch (...) { g_Settings.SEMANTIC_KNOWLEDGE = 0; }
+        try { g_Settings.KNOWLEDGE_TOP_K = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "KNOWLEDGE_TOP_K", "3")); }
+        catch (...) { g_Settings.KNOWLEDGE_TOP_K = 3; }
+        try { g_Settings.KNOWLEDGE_MIN_SIMILARITY = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "KNOWLEDGE_MIN_SIMILARITY", "0.35")); }
+        catch (...) { g_Settings.KNOWLEDGE_MIN_SIMILARITY = 0.35f; }
+        g_Settings.EMBEDDING_MODEL_PATH = GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "EMBEDDING_MODEL_PATH", "");
+        try { g_Settings.EMBEDDING_PROJECT_DIM = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "EMBEDDING_PROJECT_DIM", "384")); }
+        catch (...) { g_Settings.EMBEDDING_PROJECT_DIM = 384; }
+
+        // Per-NPC long-term memory
+        try { g_Settings.MEMORY_STORE = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "MEMORY_STORE", "0")); }
+        catch (...) { g_Settings.MEMORY_STORE = 0; }
+        try { g_Settings.MEMORY_TOKEN_BUDGET = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "MEMORY_TOKEN_BUDGET", "256")); }
+        catch (...) { g_Settings.MEMORY_TOKEN_BUDGET = 256; }
+        try { g_Settings.MEMORY_MAX_FACTS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "MEMORY_MAX_FACTS", "2048")); }
+        catch (...) { g_Settings.MEMORY_MAX_FACTS = 2048; }
+
+        // Speculative prefill (proximity watcher)
+        try { g_Settings.SPECULATIVE_PREFILL = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "SPECULATIVE_PREFILL", "0")); }
+        catch (...) { g_Settings.SPECULATIVE_PREFILL = 0; }
+        try { g_Settings.PREFETCH_INTERVAL_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "PREFETCH_INTERVAL_MS", "250")); }
+        catch (...) { g_Settings.PREFETCH_INTERVAL_MS = 250; }
+        try { g_Settings.PREFETCH_RADIUS_SCALE = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "PREFETCH_RADIUS_SCALE", "2.0")); }
+        catch (...) { g_Settings.PREFETCH_RADIUS_SCALE = 2.0f; }
+
+        // Streaming speech-to-text
+        try { g_Settings.STT_STREAMING = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_STREAMING", "0")); }
+        catch (...) { g_Settings.STT_STREAMING = 0; }
+        try { g_Settings.STT_STREAM_STEP_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_STREAM_STEP_MS", "1000")); }
+        catch (...) { g_Settings.STT_STREAM_STEP_MS = 1000; }
+        try { g_Settings.STT_STREAM_HOLDBACK_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_STREAM_HOLDBACK_MS", "1500")); }
+        catch (...) { g_Settings.STT_STREAM_HOLDBACK_MS = 1500; }
+        try { g_Settings.STT_STREAM_MAX_WINDOW_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_STREAM_MAX_WINDOW_MS", "20000")); }
+        catch (...) { g_Settings.STT_STREAM_MAX_WINDOW_MS = 20000; }
+        try { g_Settings.STT_MAX_RECORD_SECONDS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_MAX_RECORD_SECONDS", "60")); }
+        catch (...) { g_Settings.STT_MAX_RECORD_SECONDS = 60; }
+
+        // Voice activity trimming
+        try { g_Settings.STT_VAD = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_VAD", "1")); }
+        catch (...) { g_Settings.STT_VAD = 1; }
+        try { g_Settings.STT_VAD_THRESHOLD_RATIO = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_VAD_THRESHOLD_RATIO", "4.0")); }
+        catch (...) { g_Settings.STT_VAD_THRESHOLD_RATIO = 4.0f; }
+        try { g_Settings.STT_VAD_PAD_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_VAD_PAD_MS", "200")); }
+        catch (...) { g_Settings.STT_VAD_PAD_MS = 200; }
+        try { g_Settings.STT_VAD_MAX_GAP_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_VAD_MAX_GAP_MS", "400")); }
+        catch (...) { g_Settings.STT_VAD_MAX_GAP_MS = 400; }
+
+        // Whisper decoding
+        try { g_Settings.STT_THREADS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_THREADS", "4")); }
+        catch (...) { g_Settings.STT_THREADS = 4; }
+        try { g_Settings.STT_STRATEGY = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_STRATEGY", "0")); }
+        catch (...) { g_Settings.STT_STRATEGY = 0; }
+        try { g_Settings.STT_BEAM_SIZE = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_BEAM_SIZE", "5")); }
+        catch (...) { g_Settings.STT_BEAM_SIZE = 5; }
+        g_Settings.STT_LANGUAGE = GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_LANGUAGE", "auto");
+        if (g_Settings.STT_LANGUAGE.empty()) g_Settings.STT_LANGUAGE = "auto";
+        try { g_Settings.STT_STATE_POOL = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_STATE_POOL", "2")); }
+        catch (...) { g_Settings.STT_STATE_POOL = 2; }
+
+        // Two-pass STT
+        g_Settings.STT_DRAFT_MODEL = GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_DRAFT_MODEL", "");
+        try { g_Settings.STT_REFINE_THRESHOLD = std::stof(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "STT_REFINE_THRESHOLD", "0.2")); }
+        catch (...) { g_Settings.STT_REFINE_THRESHOLD = 0.2f; }
+
+        // TTS pipeline
+        try { g_Settings.TTS_WORKERS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_WORKERS", "2")); }
+        catch (...) { g_Settings.TTS_WORKERS = 2; }
+        try { g_Settings.TTS_QUEUE_DEPTH = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_QUEUE_DEPTH", "8")); }
+        catch (...) { g_Settings.TTS_QUEUE_DEPTH = 8; }
+        try { g_Settings.TTS_PHONEME_CACHE = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_PHONEME_CACHE", "20000")); }
+        catch (...) { g_Settings.TTS_PHONEME_CACHE = 20000; }
+        try { g_Settings.TTS_AUDIO_CACHE_MB = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_AUDIO_CACHE_MB", "32")); }
+        catch (...) { g_Settings.TTS_AUDIO_CACHE_MB = 32; }
+        try { g_Settings.TTS_AUDIO_CACHE_CODEC = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_AUDIO_CACHE_CODEC", "1")); }
+        catch (...) { g_Settings.TTS_AUDIO_CACHE_CODEC = 1; }
+        try { g_Settings.TTS_AUDIO_CACHE_DISK = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_AUDIO_CACHE_DISK", "0")); }
+        catch (...) { g_Settings.TTS_AUDIO_CACHE_DISK = 0; }
+        try { g_Settings.TTS_AUDIO_CACHE_MAX_CHARS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_AUDIO_CACHE_MAX_CHARS", "160")); }
+        catch (...) { g_Settings.TTS_AUDIO_CACHE_MAX_CHARS = 160; }
+        try { g_Settings.TTS_STREAMING = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_STREAMING", "0")); }
+        catch (...) { g_Settings.TTS_STREAMING = 0; }
+        try { g_Settings.TTS_STREAM_JITTER_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_STREAM_JITTER_MS", "150")); }
+        catch (...) { g_Settings.TTS_STREAM_JITTER_MS = 150; }
+        try { g_Settings.TTS_DEBUG_WAV = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_DEBUG_WAV", "0")); }
+        catch (...) { g_Settings.TTS_DEBUG_WAV = 0; }
+        try { g_Settings.TTS_VOICE_RAM_MB = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_VOICE_RAM_MB", "768")); }
+        catch (...) { g_Settings.TTS_VOICE_RAM_MB = 768; }
+        try { g_Settings.TTS_VOICE_PRELOAD = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_VOICE_PRELOAD", "0")); }
+        catch (...) { g_Settings.TTS_VOICE_PRELOAD = 0; }
+        try { g_Settings.TTS_VOICE_PRELOAD_PEDS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_VOICE_PRELOAD_PEDS", "4")); }
+        catch (...) { g_Settings.TTS_VOICE_PRELOAD_PEDS = 4; }
+        try { g_Settings.TTS_VOICE_PRELOAD_INTERVAL_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_VOICE_PRELOAD_INTERVAL_MS", "1000")); }
+        catch (...) { g_Settings.TTS_VOICE_PRELOAD_INTERVAL_MS = 1000; }
+        try { g_Settings.TTS_VOICE_VARIETY = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "TTS_VOICE_VARIETY", "25")); }
+        catch (...) { g_Settings.TTS_VOICE_VARIETY = 25; }
+        try { g_Settings.CPU_BUDGET = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "CPU_BUDGET", "0")); }
+        catch (...) { g_Settings.CPU_BUDGET = 0; }
+        try { g_Settings.CPU_GAME_CORES = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "CPU_GAME_CORES", "2")); }
+        catch (...) { g_Settings.CPU_GAME_CORES = 2; }
+        try { g_Settings.CPU_PIN_THREADS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "CPU_PIN_THREADS", "0")); }
+        catch (...) { g_Settings.CPU_PIN_THREADS = 0; }
+        try { g_Settings.CONFIG_SNAPSHOT = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "CONFIG_SNAPSHOT", "1")); }
+        catch (...) { g_Settings.CONFIG_SNAPSHOT = 1; }
+        try { g_Settings.CONFIG_HOT_RELOAD = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "CONFIG_HOT_RELOAD", "0")); }
+        catch (...) { g_Settings.CONFIG_HOT_RELOAD = 0; }
+        try { g_Settings.CONFIG_WATCH_INTERVAL_MS = std::stoi(GetValueFromINI(settingsIni, "ADDITIONAL_SETTINGS", "CONFIG_WATCH_INTERVAL_MS", "1000")); }
+        catch (...) { g_Settings.CONFIG_WATCH_INTERVAL_MS = 1000; }
+
+        g_Settings.StopStrings = GetValueFromINI(settingsIni, "SETTINGS", "STOP_TOKENS", "");
+
+        auto data = std::make_shared<ConfigData>();
+        data->settingsIni = settingsDoc;
+        LoadWorldContextDatabase(settingsIni, *data);
+        LoadDatabases(*data);
+        Publish(data);
+
+        if (g_Settings.SEMANTIC_KNOWLEDGE) {
+            SemanticIndex::Prepare(data->knowledge, data->knowledgeHash);
         }
 
         LogConfig("LoadAllConfigs completed");
@@ -421,16 +464,144 @@ void ConfigReader::LoadAllConfigs() {
     }
 }
 
-NpcPersona ConfigReader::GetPersona(AHandle ped) {
-    if (!AbstractGame::IsEntityValid(ped)) return NpcPersona();
+// Personas, relationships and knowledge: from the snapshot if the INIs did not change since it
+// was written, otherwise parsed (and a new snapshot written for the next launch)
+void ConfigReader::LoadDatabases(ConfigData& data) {
+    auto t0 = std::chrono::steady_clock::now();
+    ConfigSnapshot::Close();
+
+    uint64_t key = g_Settings.CONFIG_SNAPSHOT ? ConfigSnapshot::SourceKey({ SETTINGS_INI_PATH, RELATIONSHIPS_INI_PATH, PERSONAS_INI_PATH }) : 0;
+    if (key != 0 && ConfigSnapshot::Open(CONFIG_SNAPSHOT_PATH, key)) {
+        ConfigSnapshot::LoadTables(data);
+        data.personaTable = std::make_shared<PersonaTable>(ConfigSnapshot::PersonaCount());
+        LogConfig("LoadDatabases: Snapshot mapped, " + std::to_string(ConfigSnapshot::PersonaCount()) + " personas (decoded on first use), " +
+            std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count()) + " us");
+    }
+    else {
+        // Everything ends up in data, the documents are dropped at the end of the block
+        IniDocument relationshipsIni;
+        IniDocument personasIni;
+        if (!relationshipsIni.Load(RELATIONSHIPS_INI_PATH)) LogConfig("LoadDatabases: Cannot read " + std::string(RELATIONSHIPS_INI_PATH));
+        if (!personasIni.Load(PERSONAS_INI_PATH)) LogConfig("LoadDatabases: Cannot read " + std::string(PERSONAS_INI_PATH));
+        LoadRelationshipDatabase(relationshipsIni, data);
+        LoadPersonaDatabase(personasIni, data);
+        if (data.settingsIni) LoadKnowledgeDatabase(*data.settingsIni, data);
+        LogConfig("LoadDatabases: Parsed in " +
+            std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count()) + " us");
+
+        if (key != 0) {
+            ConfigSnapshot::Write(CONFIG_SNAPSHOT_PATH, key, data);
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// PUBLISHED CONFIG / HOT RELOAD
+// ------------------------------------------------------------
+std::shared_ptr<const ConfigData> ConfigReader::Current() {
+    std::shared_ptr<const ConfigData> config = std::atomic_load(&s_current);
+    if (config) return config;
+    static const std::shared_ptr<const ConfigData> s_empty = std::make_shared<ConfigData>();
+    return s_empty;
+}
+
+// Caller holds s_reloadMutex
+void ConfigReader::Publish(std::shared_ptr<ConfigData> data) {
+    std::shared_ptr<const ConfigData> previous = std::atomic_load(&s_current);
+    data->generation = previous ? previous->generation + 1 : 1;
+    std::atomic_store(&s_current, std::shared_ptr<const ConfigData>(std::move(data)));
+}
+
+void ConfigReader::StartHotReload() {
+    if (!g_Settings.CONFIG_HOT_RELOAD) return;
+    ConfigWatcher::Start({ SETTINGS_INI_PATH, RELATIONSHIPS_INI_PATH, PERSONAS_INI_PATH }, g_Settings.CONFIG_WATCH_INTERVAL_MS, ReloadFile);
+}
+
+void ConfigReader::StopHotReload() {
+    ConfigWatcher::Stop();
+}
+
+// Watcher thread. Only the part that comes from the changed file is parsed again, the rest is
+// copied from the current generation. Readers holding the old one are not affected.
+void ConfigReader::ReloadFile(const std::string& path) {
+    std::lock_guard<std::mutex> lock(s_reloadMutex);
+    auto t0 = std::chrono::steady_clock::now();
+    auto data = std::make_shared<ConfigData>(*Current());
+    // Keyed on the files as they are before parsing: a save during the reload leaves a stale
+    // key, so the next launch parses again instead of mapping outdated data
+    uint64_t key = g_Settings.CONFIG_SNAPSHOT ? ConfigSnapshot::SourceKey({ SETTINGS_INI_PATH, RELATIONSHIPS_INI_PATH, PERSONAS_INI_PATH }) : 0;
+
+    if (path == SETTINGS_INI_PATH) {
+        auto settingsDoc = std::make_shared<IniDocument>();
+        if (!settingsDoc->Load(path)) {
+            LogConfig("ReloadFile: Cannot read " + path);
+            return;
+        }
+        data->settingsIni = settingsDoc;
+        data->zoneContext.clear();
+        data->orgContext.clear();
+        LoadWorldContextDatabase(*settingsDoc, *data);
+        LoadKnowledgeDatabase(*settingsDoc, *data);
+    }
+    else if (path == RELATIONSHIPS_INI_PATH) {
+        IniDocument relationshipsIni;
+        if (!relationshipsIni.Load(path)) {
+            LogConfig("ReloadFile: Cannot read " + path);
+            return;
+        }
+        data->relationships.clear();
+        LoadRelationshipDatabase(relationshipsIni, *data);
+    }
+    else if (path == PERSONAS_INI_PATH) {
+        IniDocument personasIni;
+        if (!personasIni.Load(path)) {
+            LogConfig("ReloadFile: Cannot read " + path);
+            return;
+        }
+        data->personas.clear();
+        data->defaultTypes.clear();
+        data->personaTable.reset();   // the old one stays with the old generation
+        data->personasInSnapshot = false;
+        LoadPersonaDatabase(personasIni, *data);
+    }
+    else {
+        return;
+    }
+
+    Publish(data);
+    LogConfig("ReloadFile: " + path + " reloaded as generation " + std::to_string(data->generation) + " in " +
+        std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count()) + " us");
+
+    // Next launch maps the new state instead of parsing. The mapping in use stays valid (its
+    // file is replaced, not overwritten); where that is not allowed the write just fails.
+    if (key != 0) ConfigSnapshot::Write(CONFIG_SNAPSHOT_PATH, key, *data);
+}
+
+void ConfigReader::ForEachPersona(const std::function<void(const NpcPersona&)>& fn) {
+    auto config = Current();
+    if (config->personasInSnapshot) {
+        ConfigSnapshot::ForEachPersona(fn);
+        return;
+    }
+    for (const PersonaRef& p : config->personas) fn(*p);
+}
+
+PersonaRef ConfigReader::GetPersona(AHandle ped) {
+    static const PersonaRef s_invalidPed = std::make_shared<const NpcPersona>();
+    if (!AbstractGame::IsEntityValid(ped)) return s_invalidPed;
     Hash entityHash = AbstractGame::GetEntityModel(ped);
-    LogConfig("GetPersona: Entity model hash=" + std::to_string(entityHash));
-    auto it = g_PersonaCache.find(entityHash);
-    if (it != g_PersonaCache.end()) {
-        LogConfig("Persona found in .ini");
-        return it->second;
+    auto config = Current();
+    if (config->personaTable) {
+        if (PersonaRef found = config->personaTable->Find(entityHash)) return found;
     }
+
+    // First lookup of this model in this generation: decode or build it once, then it is in the table
     NpcPersona p;
+    if (config->personasInSnapshot && ConfigSnapshot::FindPersona(entityHash, p)) {
+        PersonaRef decoded = std::make_shared<const NpcPersona>(std::move(p));
+        return config->personaTable ? config->personaTable->Insert(decoded) : decoded;
+    }
+    LogConfig("GetPersona: Model " + std::to_string(entityHash) + " not in the personas .ini");
     p.modelHash = entityHash;
     p.modelName = "UNKNOWN_MODEL";
     p.isHuman = AbstractGame::IsPedHuman(ped);
@@ -446,9 +617,8 @@ NpcPersona ConfigReader::GetPersona(AHandle ped) {
         p.gender = "Neutral";
         p.type = "ANIMAL";
     }
-    LogConfig("Persona loaded successfully");
-    g_PersonaCache[entityHash] = p;
-    return p;
+    PersonaRef unknown = std::make_shared<const NpcPersona>(std::move(p));
+    return config->personaTable ? config->personaTable->Insert(unknown) : unknown;
 }
 
 std::string ConfigReader::GetRelationship(const std::string& npcSubGroup, const std::string& playerSubGroup) {
@@ -457,15 +627,17 @@ std::string ConfigReader::GetRelationship(const std::string& npcSubGroup, const
         LogConfig("GetRelationship: SubGroup is empty, fallback to neutral");
         return "neutral, stranger";
     }
+    auto config = Current();
+    const auto& matrix = config->relationships;
     std::string key = npcSubGroup + ":" + playerSubGroup;
-    auto it = g_RelationshipMatrix.find(key);
-    if (it != g_RelationshipMatrix.end()) {
+    auto it = matrix.find(key);
+    if (it != matrix.end()) {
         LogConfig("GetRelationship: Found direct relationship: " + it->second);
         return it->second;
     }
     key = playerSubGroup + ":" + npcSubGroup;
-    it = g_RelationshipMatrix.find(key);
-    if (it != g_RelationshipMatrix.end()) {
+    it = matrix.find(key);
+    if (it != matrix.end()) {
         LogConfig("GetRelationship: Found reverse relationship: " + it->second);
         return it->second;
     }
@@ -484,84 +656,44 @@ std::string ConfigReader::GetRelationship(const std::string& npcSubGroup, const
 }
 
 std::string ConfigReader::GetZoneContext(const std::string& zoneName) {
-    auto it = g_ZoneContextCache.find(zoneName);
-    if (it != g_ZoneContextCache.end()) {
+    auto config = Current();
+    auto it = config->zoneContext.find(zoneName);
+    if (it != config->zoneContext.end()) {
         return it->second;
     }
     return "Location: Unknown";
 }
 
 std::string ConfigReader::GetOrgContext(const std::string& orgName) {
-    auto it = g_OrgContextCache.find(orgName);
-    if (it != g_OrgContextCache.end()) {
+    auto config = Current();
+    auto it = config->orgContext.find(orgName);
+    if (it != config->orgContext.end()) {
         return it->second;
     }
     return "";
 }
 
-void ConfigReader::LoadVoiceDatabase() {
-    LogConfig("LoadVoiceDatabase started");
-    const char* vPath = ".\\EC_Voices_list_01.ini";
-
-    // [FIX] Abstraction: Using AOS
-    std::vector<std::string> sections = AOS::GetIniSectionNames(vPath);
-
-    if (sections.empty()) {
-        LogConfig("LoadVoiceDatabase: No sections found in " + std::string(vPath));
-        return;
-    }
+void ConfigReader::LoadKnowledgeDatabase(const IniDocument& ini, ConfigData& data) {
+    data.knowledge.clear();
+    data.knowledgeHash = 0;
+    if (!ini.IsLoaded()) return;
 
-    for (const auto& sectionName : sections) {
-        VoiceConfig vc;
-        vc.gender = GetValueFromINI(vPath, sectionName, "gender", "");
-        vc.age = GetValueFromINI(vPath, sectionName, "age", "");
-        vc.voice = GetValueFromINI(vPath, sectionName, "voice", "");
-        vc.special = GetValueFromINI(vPath, sectionName, "special", "");
-        ConfigReader::g_VoiceMap[sectionName] = vc;
+    // FNV-1a over the file without its line breaks (as the old line reader saw it), keys the
+    // embedding cache of the SemanticIndex
+    uint64_t iniHash = 1469598103934665603ULL;
+    for (unsigned char c : ini.Text()) {
+        if (c == '\r' || c == '\n') continue;
+        iniHash ^= c;
+        iniHash *= 1099511628211ULL;
     }
-    LogConfig("LoadVoiceDatabase completed. Loaded " + std::to_string(ConfigReader::g_VoiceMap.size()) + " voices.");
-}
-
-void ConfigReader::LoadKnowledgeDatabase() {
-    g_KnowledgeDB.clear();
-    // This function already used std::ifstream (Cross platform!) 
-    // It is already perfect. No changes needed except maybe ensuring SetEnvVar/etc aren't used here.
-
-    std::ifstream iniFile(SETTINGS_INI_PATH);
-    if (!iniFile.is_open()) return;
-
-    std::string line;
-    KnowledgeSection currentSection;
 
-    while (std::getline(iniFile, line)) {
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        size_t last = line.find_last_not_of(" \t\r\n");
-        if (last != std::string::npos) line.erase(last + 1);
+    for (const IniSection& sec : ini.Sections()) {
+        KnowledgeSection currentSection;
+        currentSection.sectionName = "[" + std::string(sec.name) + "]";
 
-        if (line.empty() || line[0] == ';') continue;
-
-        if (line[0] == '[' && line.back() == ']') {
-            if (!currentSection.sectionName.empty()) {
-                g_KnowledgeDB[currentSection.sectionName] = currentSection;
-            }
-            currentSection = KnowledgeSection();
-            currentSection.sectionName = line;
-            continue;
-        }
-
-        if (!currentSection.sectionName.empty()) {
-            size_t delimiterPos = line.find('=');
-            if (delimiterPos == std::string::npos) continue;
-
-            std::string key = line.substr(0, delimiterPos);
-            std::string value = line.substr(delimiterPos + 1);
-
-            key.erase(0, key.find_first_not_of(" \t"));
-            size_t kEnd = key.find_last_not_of(" \t");
-            if (kEnd != std::string::npos) key.erase(kEnd + 1);
-
-            value.erase(0, value.find_first_not_of(" \t"));
-            // Keep trailing spaces in values usually, but trimming logic is fine
+        for (const IniEntry& e : sec.entries) {
+            std::string key(e.key);
+            std::string value(e.value);
 
             if (key == "isalwaysloaded") {
                 currentSection.isAlwaysLoaded = (value == "1");
@@ -583,17 +715,16 @@ void ConfigReader::LoadKnowledgeDatabase() {
                 }
             }
             else {
-                currentSection.content += line + "\n";
+                currentSection.content += std::string(e.line) + "\n";
                 currentSection.keyValues[key] = value;
                 if (!key.empty()) {
                     currentSection.keywords.push_back(NormalizeString(key));
                 }
             }
         }
+        data.knowledge[currentSection.sectionName] = std::move(currentSection);
     }
-    if (!currentSection.sectionName.empty()) {
-        g_KnowledgeDB[currentSection.sectionName] = currentSection;
-    }
+    data.knowledgeHash = iniHash;
 }
 
 std::string NormalizeString(const std::string& input) {
@@ -1,23 +1,20 @@
 #pragma once
 #include "AbstractTypes.h"
+#include "IniDocument.h"
 #include <string>
 #include <vector>
 #include <map>
 #include <cstdint>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 
 // ---------------------------------------------------------------------
 // 1. DATA STRUCTURES
 // ---------------------------------------------------------------------
 
-struct VoiceConfig {
-    std::string gender;
-    std::string age;
-    std::string voice;
-    std::string special;
-};
-
 struct NpcPersona {
     uint32_t modelHash = 0; 
     bool isHuman = true;
@@ -39,6 +36,10 @@ struct NpcPersona {
     std::string LORAID = "";
 };
 
+// Shared, never modified persona record. GetPersona hands these out instead of copies.
+using PersonaRef = std::shared_ptr<const NpcPersona>;
+class PersonaTable;
+
 struct ModSettings {
     bool Enabled = false;
     int ActivationKey = 0x54;
@@ -101,6 +102,65 @@ struct ModSettings {
     std::string StopStrings = "";
     int DeletionTimerClearFull = 160;
     int MaxAllowedChatHistory = 2;
+    // Semantic knowledge retrieval
+    int SEMANTIC_KNOWLEDGE = 0;
+    int KNOWLEDGE_TOP_K = 3;
+    float KNOWLEDGE_MIN_SIMILARITY = 0.35f;
+    std::string EMBEDDING_MODEL_PATH = "";
+    int EMBEDDING_PROJECT_DIM = 384;
+    // Per-NPC long-term memory
+    int MEMORY_STORE = 0;
+    int MEMORY_TOKEN_BUDGET = 256;
+    int MEMORY_MAX_FACTS = 2048;
+    // Speculative prefill (proximity watcher)
+    int SPECULATIVE_PREFILL = 0;
+    int PREFETCH_INTERVAL_MS = 250;
+    float PREFETCH_RADIUS_SCALE = 2.0f;
+    // Streaming speech-to-text
+    int STT_STREAMING = 0;
+    int STT_STREAM_STEP_MS = 1000;
+    int STT_STREAM_HOLDBACK_MS = 1500;
+    int STT_STREAM_MAX_WINDOW_MS = 20000;
+    int STT_MAX_RECORD_SECONDS = 60;
+    // Voice activity trimming
+    int STT_VAD = 1;
+    float STT_VAD_THRESHOLD_RATIO = 4.0f;
+    int STT_VAD_PAD_MS = 200;
+    int STT_VAD_MAX_GAP_MS = 400;
+    // Whisper decoding
+    int STT_THREADS = 4;
+    int STT_STRATEGY = 0;
+    int STT_BEAM_SIZE = 5;
+    std::string STT_LANGUAGE = "auto";
+    int STT_STATE_POOL = 2;
+    // Two-pass STT
+    std::string STT_DRAFT_MODEL = "";
+    float STT_REFINE_THRESHOLD = 0.2f;
+    // TTS pipeline
+    int TTS_WORKERS = 2;
+    int TTS_QUEUE_DEPTH = 8;
+    int TTS_PHONEME_CACHE = 20000;
+    int TTS_AUDIO_CACHE_MB = 32;
+    int TTS_AUDIO_CACHE_CODEC = 1;
+    int TTS_AUDIO_CACHE_DISK = 0;
+    int TTS_AUDIO_CACHE_MAX_CHARS = 160;
+    int TTS_STREAMING = 0;
+    int TTS_STREAM_JITTER_MS = 150;
+    int TTS_DEBUG_WAV = 0;
+    int TTS_VOICE_RAM_MB = 768;
+    int TTS_VOICE_PRELOAD = 0;
+    int TTS_VOICE_PRELOAD_PEDS = 4;
+    int TTS_VOICE_PRELOAD_INTERVAL_MS = 1000;
+    int TTS_VOICE_VARIETY = 25;
+    // CPU budget shared by LLM, STT and TTS
+    int CPU_BUDGET = 0;
+    int CPU_GAME_CORES = 2;
+    int CPU_PIN_THREADS = 0;
+    // Binary snapshot of the parsed personas / relationships / knowledge
+    int CONFIG_SNAPSHOT = 1;
+    // Re-parse changed INIs while the game runs
+    int CONFIG_HOT_RELOAD = 0;
+    int CONFIG_WATCH_INTERVAL_MS = 1000;
     
 };
 
@@ -113,28 +173,46 @@ struct KnowledgeSection {
     bool loadEntireSectionOnMatch = true;
 };
 
+// Everything parsed from the INIs except g_Settings. Never changed once published: a reload
+// builds a new one and swaps the pointer, a reader keeps the generation it loaded.
+struct ConfigData {
+    uint64_t generation = 0;
+    std::shared_ptr<const IniDocument> settingsIni;
+    std::vector<PersonaRef> personas;               // from the INI, empty while they are read from the snapshot
+    bool personasInSnapshot = false;
+    // GetPersona lookups; also caches snapshot personas and unknown models (internally synchronized)
+    std::shared_ptr<PersonaTable> personaTable;
+    std::map<std::string, NpcPersona> defaultTypes;
+    std::map<std::string, std::string> relationships;
+    std::map<std::string, std::string> zoneContext;
+    std::map<std::string, std::string> orgContext;
+    std::map<std::string, KnowledgeSection> knowledge;
+    uint64_t knowledgeHash = 0;
+    std::string globalContextStyle;
+    std::string globalContextTimeEra;
+    std::string globalContextLocation;
+    std::string contentGuidelines;
+};
+
 // ---------------------------------------------------------------------
 // 2. CONFIG READER CLASS
 // ---------------------------------------------------------------------
 class ConfigReader {
 public:
-    // Caches
+    // Read once at startup, not reloaded (the engines apply it when they initialize)
     static ModSettings g_Settings;
-    static std::map<uint32_t, NpcPersona> g_PersonaCache;
-    static std::map<std::string, NpcPersona> g_DefaultTypeCache;
-    static std::map<std::string, std::string> g_RelationshipMatrix;
-    static std::map<std::string, std::string> g_ZoneContextCache;
-    static std::map<std::string, std::string> g_OrgContextCache;
-    static std::string g_GlobalContextStyle;
-    static std::string g_GlobalContextTimeEra;
-    static std::string g_GlobalContextLocation;
-    static std::map<std::string, VoiceConfig> g_VoiceMap;
-    static std::map<std::string, KnowledgeSection> g_KnowledgeDB;
-    static std::string g_ContentGuidelines;
 
     // Public API
     static void LoadAllConfigs();
-    static NpcPersona GetPersona(AHandle npc);
+    // Lock-free; hold the pointer for as long as the data is used
+    static std::shared_ptr<const ConfigData> Current();
+    // Watches the INIs and republishes Current() when one of them changes
+    static void StartHotReload();
+    static void StopHotReload();
+    // Never null; lock-free once the model was looked up before
+    static PersonaRef GetPersona(AHandle npc);
+    // Every persona of the personas INI (also the ones not decoded from the snapshot yet)
+    static void ForEachPersona(const std::function<void(const NpcPersona&)>& fn);
     static std::string GetRelationship(const std::string& npcSubGroup, const std::string& playerSubGroup);
     static std::string GetZoneContext(const std::string& zoneName);
     static std::string GetOrgContext(const std::string& orgName);
@@ -145,14 +223,20 @@ public:
     static int KeyNameToVK(const std::string& keyName);
 
 private:
-    static void LoadKnowledgeDatabase();
-    static std::string GetValueFromINI(const char* iniPath, const std::string& section, const std::string& key, const std::string& defaultValue = "");
-    static void LoadINISectionToCache(const char* iniPath, const std::string& section, std::map<std::string, std::string>& cache);
-    static void LoadPersonaDatabase();
-    static void LoadRelationshipDatabase();
-    static void LoadVoiceDatabase();
-    static void LoadWorldContextDatabase();
+    static void LoadDatabases(ConfigData& data);
+    static void LoadKnowledgeDatabase(const IniDocument& ini, ConfigData& data);
+    static std::string GetValueFromINI(const IniDocument& ini, const std::string& section, const std::string& key, const std::string& defaultValue = "");
+    static std::string CleanValue(std::string_view raw, const std::string& defaultValue = "");
+    static void LoadINISectionToCache(const IniDocument& ini, const std::string& section, std::map<std::string, std::string>& cache);
+    static void LoadPersonaDatabase(const IniDocument& ini, ConfigData& data);
+    static void LoadRelationshipDatabase(const IniDocument& ini, ConfigData& data);
+    static void LoadWorldContextDatabase(const IniDocument& ini, ConfigData& data);
     static uint32_t GetHashFromHex(const std::string& hexString);
+    static void ReloadFile(const std::string& path);
+    static void Publish(std::shared_ptr<ConfigData> data);
+
+    static std::shared_ptr<const ConfigData> s_current;   // std::atomic_load / atomic_store only
+    static std::mutex s_reloadMutex;                       // one writer at a time
 };
 
 //EOF
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "ConfigSnapshot.h"
+#include "IniDocument.h"
+#include "helperfunctions.h"
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+AOS::MappedFile ConfigSnapshot::s_file;
+
+static const uint32_t SNAP_MAGIC = 0x53434345; // "ECCS"
+static const uint32_t SNAP_VERSION = 1;
+static const int PERSONA_STRINGS = 10;
+
+// ------------------------------------------------------------
+// FILE LAYOUT (little endian, every table 8 byte aligned)
+// ------------------------------------------------------------
+struct StrRef { uint32_t off; uint32_t len; };          // into the string pool
+
+struct SnapHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t knowledgeHash;
+    uint32_t personaCount;      // records [0, personaCount) are models, the rest DEFAULT_ types
+    uint32_t defaultCount;
+    uint32_t indexSlots;        // power of two
+    uint32_t relationCount;
+    uint32_t knowledgeCount;
+    uint32_t kvCount;
+    uint32_t keywordCount;
+    uint32_t stringsSize;
+    uint64_t personaOff, indexOff, relationOff, knowledgeOff, kvOff, keywordOff, stringsOff;
+};
+
+struct PersonaRec {
+    uint32_t modelHash;
+    int32_t audioId;
+    uint32_t isHuman;
+    uint32_t pad;
+    StrRef s[PERSONA_STRINGS];  // modelName, inGameName, type, relationshipGroup, subGroup, gender, behaviorTraits, p_audio_model, LORAName, LORAID
+};
+
+struct IndexSlot { uint32_t modelHash; uint32_t record; };   // record + 1, 0 = empty
+struct PairRec { StrRef key; StrRef value; };
+struct KnowledgeRec {
+    StrRef name;
+    StrRef content;
+    uint32_t flags;             // 1 = isAlwaysLoaded, 2 = loadEntireSectionOnMatch
+    uint32_t kvFirst, kvCount;
+    uint32_t kwFirst, kwCount;
+    uint32_t pad;
+};
+
+static inline uint32_t SlotOf(uint32_t modelHash, uint32_t mask) {
+    return (modelHash * 0x9E3779B1u) & mask;
+}
+
+template <typename T>
+static const T* Table(const AOS::MappedFile& f, uint64_t off) {
+    return reinterpret_cast<const T*>(f.data + off);
+}
+
+static std::string Str(const AOS::MappedFile& f, const StrRef& r) {
+    const SnapHeader* h = Table<SnapHeader>(f, 0);
+    if ((uint64_t)r.off + r.len > h->stringsSize) return "";
+    return std::string(reinterpret_cast<const char*>(f.data + h->stringsOff + r.off), r.len);
+}
+
+static void DecodePersona(const AOS::MappedFile& f, const PersonaRec& rec, NpcPersona& p) {
+    p = NpcPersona();
+    p.modelHash = rec.modelHash;
+    p.p_audio_ID = rec.audioId;
+    p.isHuman = rec.isHuman != 0;
+    p.modelName = Str(f, rec.s[0]);
+    p.inGameName = Str(f, rec.s[1]);
+    p.type = Str(f, rec.s[2]);
+    p.relationshipGroup = Str(f, rec.s[3]);
+    p.subGroup = Str(f, rec.s[4]);
+    p.gender = Str(f, rec.s[5]);
+    p.behaviorTraits = Str(f, rec.s[6]);
+    p.p_audio_model = Str(f, rec.s[7]);
+    p.LORAName = Str(f, rec.s[8]);
+    p.LORAID = Str(f, rec.s[9]);
+}
+
+// ------------------------------------------------------------
+// 1. KEY / OPEN
+// ------------------------------------------------------------
+uint64_t ConfigSnapshot::SourceKey(const std::vector<std::string>& iniPaths) {
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&h](uint64_t v) {
+        for (int i = 0; i < 8; ++i) { h ^= (v >> (i * 8)) & 0xFF; h *= 1099511628211ULL; }
+    };
+    mix(SNAP_VERSION);
+    for (const auto& path : iniPaths) {
+        std::error_code ec;
+        std::string native = IniDocument::NativePath(path);
+        uint64_t size = (uint64_t)fs::file_size(native, ec);
+        if (ec) return 0;
+        auto mtime = fs::last_write_time(native, ec);
+        if (ec) return 0;
+        mix(size);
+        mix((uint64_t)mtime.time_since_epoch().count());
+    }
+    return h ? h : 1;
+}
+
+bool ConfigSnapshot::Open(const std::string& path, uint64_t key) {
+    Close();
+    AOS::MappedFile f;
+    if (!AOS::MapFile(IniDocument::NativePath(path), f)) return false;
+
+    // Every table has to lie inside the file, a torn or foreign file is rejected as a whole
+    bool ok = f.size >= sizeof(SnapHeader);
+    const SnapHeader* h = ok ? Table<SnapHeader>(f, 0) : nullptr;
+    ok = ok && h->magic == SNAP_MAGIC && h->version == SNAP_VERSION && h->key == key;
+    auto fits = [&f](uint64_t off, uint64_t bytes) { return off % 8 == 0 && off <= f.size && bytes <= f.size - off; };
+    ok = ok && (h->indexSlots & (h->indexSlots - 1)) == 0 && h->indexSlots >= 1 &&
+        fits(h->personaOff, (uint64_t)(h->personaCount + h->defaultCount) * sizeof(PersonaRec)) &&
+        fits(h->indexOff, (uint64_t)h->indexSlots * sizeof(IndexSlot)) &&
+        fits(h->relationOff, (uint64_t)h->relationCount * sizeof(PairRec)) &&
+        fits(h->knowledgeOff, (uint64_t)h->knowledgeCount * sizeof(KnowledgeRec)) &&
+        fits(h->kvOff, (uint64_t)h->kvCount * sizeof(PairRec)) &&
+        fits(h->keywordOff, (uint64_t)h->keywordCount * sizeof(StrRef)) &&
+        fits(h->stringsOff, h->stringsSize);
+    if (!ok) {
+        AOS::UnmapFile(f);
+        return false;
+    }
+    s_file = f;
+    return true;
+}
+
+void ConfigSnapshot::Close() {
+    AOS::UnmapFile(s_file);
+}
+
+// ------------------------------------------------------------
+// 2. READ
+// ------------------------------------------------------------
+void ConfigSnapshot::LoadTables(ConfigData& data) {
+    if (!IsOpen()) return;
+    const SnapHeader* h = Table<SnapHeader>(s_file, 0);
+    data.knowledgeHash = h->knowledgeHash;
+    data.personasInSnapshot = true;
+
+    const PersonaRec* recs = Table<PersonaRec>(s_file, h->personaOff);
+    for (uint32_t i = 0; i < h->defaultCount; ++i) {
+        NpcPersona p;
+        DecodePersona(s_file, recs[h->personaCount + i], p);
+        data.defaultTypes[p.type] = std::move(p);
+    }
+
+    const PairRec* rel = Table<PairRec>(s_file, h->relationOff);
+    for (uint32_t i = 0; i < h->relationCount; ++i) {
+        data.relationships[Str(s_file, rel[i].key)] = Str(s_file, rel[i].value);
+    }
+
+    const KnowledgeRec* kn = Table<KnowledgeRec>(s_file, h->knowledgeOff);
+    const PairRec* kv = Table<PairRec>(s_file, h->kvOff);
+    const StrRef* kw = Table<StrRef>(s_file, h->keywordOff);
+    for (uint32_t i = 0; i < h->knowledgeCount; ++i) {
+        KnowledgeSection sec;
+        sec.sectionName = Str(s_file, kn[i].name);
+        sec.content = Str(s_file, kn[i].content);
+        sec.isAlwaysLoaded = (kn[i].flags & 1) != 0;
+        sec.loadEntireSectionOnMatch = (kn[i].flags & 2) != 0;
+        for (uint32_t j = 0; j < kn[i].kvCount && (uint64_t)kn[i].kvFirst + j < h->kvCount; ++j) {
+            sec.keyValues[Str(s_file, kv[kn[i].kvFirst + j].key)] = Str(s_file, kv[kn[i].kvFirst + j].value);
+        }
+        for (uint32_t j = 0; j < kn[i].kwCount && (uint64_t)kn[i].kwFirst + j < h->keywordCount; ++j) {
+            sec.keywords.push_back(Str(s_file, kw[kn[i].kwFirst + j]));
+        }
+        data.knowledge[sec.sectionName] = std::move(sec);
+    }
+}
+
+bool ConfigSnapshot::FindPersona(uint32_t modelHash, NpcPersona& out) {
+    if (!IsOpen() || modelHash == 0) return false;
+    const SnapHeader* h = Table<SnapHeader>(s_file, 0);
+    const IndexSlot* index = Table<IndexSlot>(s_file, h->indexOff);
+    const uint32_t mask = h->indexSlots - 1;
+
+    for (uint32_t i = SlotOf(modelHash, mask), probes = 0; probes < h->indexSlots; i = (i + 1) & mask, ++probes) {
+        if (index[i].record == 0) return false;
+        if (index[i].modelHash != modelHash) continue;
+        if (index[i].record > h->personaCount) return false;
+        DecodePersona(s_file, Table<PersonaRec>(s_file, h->personaOff)[index[i].record - 1], out);
+        return true;
+    }
+    return false;
+}
+
+void ConfigSnapshot::ForEachPersona(const std::function<void(const NpcPersona&)>& fn) {
+    if (!IsOpen()) return;
+    const SnapHeader* h = Table<SnapHeader>(s_file, 0);
+    const PersonaRec* recs = Table<PersonaRec>(s_file, h->personaOff);
+    NpcPersona p;
+    for (uint32_t i = 0; i < h->personaCount; ++i) {
+        DecodePersona(s_file, recs[i], p);
+        fn(p);
+    }
+}
+
+uint32_t ConfigSnapshot::PersonaCount() {
+    return IsOpen() ? Table<SnapHeader>(s_file, 0)->personaCount : 0;
+}
+
+// ------------------------------------------------------------
+// 3. WRITE
+// ------------------------------------------------------------
+namespace {
+    // Identical strings ("Ambient", "CIVMALE", ...) are stored once
+    struct StringPool {
+        std::string data;
+        std::unordered_map<std::string, uint32_t> offsets;
+
+        StrRef Add(const std::string& s) {
+            auto it = offsets.find(s);
+            if (it != offsets.end()) return { it->second, (uint32_t)s.size() };
+            uint32_t off = (uint32_t)data.size();
+            data += s;
+            offsets.emplace(s, off);
+            return { off, (uint32_t)s.size() };
+        }
+    };
+
+    PersonaRec EncodePersona(const NpcPersona& p, StringPool& pool) {
+        PersonaRec rec = {};
+        rec.modelHash = p.modelHash;
+        rec.audioId = p.p_audio_ID;
+        rec.isHuman = p.isHuman ? 1 : 0;
+        const std::string* fields[PERSONA_STRINGS] = { &p.modelName, &p.inGameName, &p.type, &p.relationshipGroup, &p.subGroup,
+            &p.gender, &p.behaviorTraits, &p.p_audio_model, &p.LORAName, &p.LORAID };
+        for (int i = 0; i < PERSONA_STRINGS; ++i) rec.s[i] = pool.Add(*fields[i]);
+        return rec;
+    }
+
+    template <typename T>
+    uint64_t Append(std::vector<uint8_t>& out, const T* items, size_t count) {
+        while (out.size() % 8) out.push_back(0);
+        uint64_t off = out.size();
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(items);
+        out.insert(out.end(), p, p + count * sizeof(T));
+        return off;
+    }
+}
+
+bool ConfigSnapshot::Write(const std::string& path, uint64_t key, const ConfigData& data) {
+    std::vector<PersonaRef> decoded;
+    if (data.personasInSnapshot) {
+        ForEachPersona([&](const NpcPersona& p) { decoded.push_back(std::make_shared<const NpcPersona>(p)); });
+    }
+    const std::vector<PersonaRef>& personas = data.personasInSnapshot ? decoded : data.personas;
+    const std::map<std::string, NpcPersona>& defaultTypes = data.defaultTypes;
+    const std::map<std::string, std::string>& relationships = data.relationships;
+    const std::map<std::string, KnowledgeSection>& knowledge = data.knowledge;
+    StringPool pool;
+
+    std::vector<PersonaRec> recs;
+    recs.reserve(personas.size() + defaultTypes.size());
+    for (const PersonaRef& p : personas) recs.push_back(EncodePersona(*p, pool));
+    for (const auto& kv : defaultTypes) recs.push_back(EncodePersona(kv.second, pool));
+
+    // Load factor <= 0.5, a miss ends at the first empty slot
+    uint32_t slots = 1;
+    while (slots < personas.size() * 2) slots <<= 1;
+    std::vector<IndexSlot> index(slots, IndexSlot{ 0, 0 });
+    uint32_t i = 0;
+    for (const PersonaRef& p : personas) {
+        uint32_t s = SlotOf(p->modelHash, slots - 1);
+        while (index[s].record != 0) s = (s + 1) & (slots - 1);
+        index[s] = { p->modelHash, ++i };
+    }
+
+    std::vector<PairRec> rel;
+    rel.reserve(relationships.size());
+    for (const auto& kv : relationships) rel.push_back({ pool.Add(kv.first), pool.Add(kv.second) });
+
+    std::vector<KnowledgeRec> kn;
+    std::vector<PairRec> kvs;
+    std::vector<StrRef> kws;
+    for (const auto& kv : knowledge) {
+        const KnowledgeSection& sec = kv.second;
+        KnowledgeRec r = {};
+        r.name = pool.Add(sec.sectionName);
+        r.content = pool.Add(sec.content);
+        r.flags = (sec.isAlwaysLoaded ? 1u : 0u) | (sec.loadEntireSectionOnMatch ? 2u : 0u);
+        r.kvFirst = (uint32_t)kvs.size();
+        for (const auto& p : sec.keyValues) kvs.push_back({ pool.Add(p.first), pool.Add(p.second) });
+        r.kvCount = (uint32_t)kvs.size() - r.kvFirst;
+        r.kwFirst = (uint32_t)kws.size();
+        for (const auto& w : sec.keywords) kws.push_back(pool.Add(w));
+        r.kwCount = (uint32_t)kws.size() - r.kwFirst;
+        kn.push_back(r);
+    }
+
+    SnapHeader h = {};
+    h.magic = SNAP_MAGIC;
+    h.version = SNAP_VERSION;
+    h.key = key;
+    h.knowledgeHash = data.knowledgeHash;
+    h.personaCount = (uint32_t)personas.size();
+    h.defaultCount = (uint32_t)defaultTypes.size();
+    h.indexSlots = slots;
+    h.relationCount = (uint32_t)rel.size();
+    h.knowledgeCount = (uint32_t)kn.size();
+    h.kvCount = (uint32_t)kvs.size();
+    h.keywordCount = (uint32_t)kws.size();
+    h.stringsSize = (uint32_t)pool.data.size();
+
+    std::vector<uint8_t> out;
+    Append(out, &h, 1);
+    h.personaOff = Append(out, recs.data(), recs.size());
+    h.indexOff = Append(out, index.data(), index.size());
+    h.relationOff = Append(out, rel.data(), rel.size());
+    h.knowledgeOff = Append(out, kn.data(), kn.size());
+    h.kvOff = Append(out, kvs.data(), kvs.size());
+    h.keywordOff = Append(out, kws.data(), kws.size());
+    h.stringsOff = Append(out, pool.data.data(), pool.data.size());
+    std::memcpy(out.data(), &h, sizeof(h));
+
+    // Written next to it and renamed, a crash never leaves half a snapshot behind
+    std::string native = IniDocument::NativePath(path);
+    std::string tmp = native + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) {
+            LogConfig("ConfigSnapshot: Could not write " + tmp);
+            return false;
+        }
+        f.write(reinterpret_cast<const char*>(out.data()), (std::streamsize)out.size());
+        if (!f) {
+            f.close();
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, native, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    LogConfig("ConfigSnapshot: Wrote " + std::to_string(h.personaCount) + " personas, " + std::to_string(out.size() / 1024) +
+        " KB (" + std::to_string(pool.data.size() / 1024) + " KB strings)");
+    return true;
+}
+
+//EOF
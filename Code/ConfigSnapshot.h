@@ -0,0 +1,42 @@
+#pragma once
+#include "ConfigReader.h"
+#include "PlatformSystem.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstdint>
+
+// ConfigSnapshot.h
+// Binary image of what LoadAllConfigs builds from the personas / relationships INIs and the
+// knowledge part of the settings INI (EC_ConfigSnapshot.bin). Keyed by size + mtime of the
+// source files; a matching snapshot is memory mapped on the next launch instead of parsing.
+// Defaults, relationships and knowledge are small and decoded at once. Personas stay in the
+// mapping (flat records, deduplicated string pool, open addressing index by model hash) and
+// are decoded one at a time on their first GetPersona.
+
+class ConfigSnapshot {
+public:
+    // 0 if a source file is missing
+    static uint64_t SourceKey(const std::vector<std::string>& iniPaths);
+
+    static bool Open(const std::string& path, uint64_t key);
+    static void Close();
+    static bool IsOpen() { return s_file.data != nullptr; }
+
+    // Defaults, relationships and knowledge into data, personas stay in the mapping
+    static void LoadTables(ConfigData& data);
+
+    static bool FindPersona(uint32_t modelHash, NpcPersona& out);
+    // Decodes every persona into a temporary, nothing is kept
+    static void ForEachPersona(const std::function<void(const NpcPersona&)>& fn);
+    static uint32_t PersonaCount();
+
+    // Personas come from the current mapping if data still refers to it (personasInSnapshot)
+    static bool Write(const std::string& path, uint64_t key, const ConfigData& data);
+
+private:
+    static AOS::MappedFile s_file;
+};
+
+//EOF
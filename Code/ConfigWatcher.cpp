@@ -0,0 +1,145 @@
+#include "ConfigWatcher.h"
+#include "IniDocument.h"
+#include "PlatformSystem.h"
+#include "helperfunctions.h"
+#include <filesystem>
+#include <algorithm>
+#include <set>
+
+#ifdef PLATFORM_LINUX
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::vector<ConfigWatcher::Watched> ConfigWatcher::s_files;
+std::function<void(const std::string&)> ConfigWatcher::s_onChanged;
+int ConfigWatcher::s_intervalMs = 1000;
+std::thread ConfigWatcher::s_thread;
+std::atomic<bool> ConfigWatcher::s_running{ false };
+std::mutex ConfigWatcher::s_waitMutex;
+std::condition_variable ConfigWatcher::s_waitCv;
+int ConfigWatcher::s_inotifyFd = -1;
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE
+// ------------------------------------------------------------
+void ConfigWatcher::Start(const std::vector<std::string>& files, int intervalMs, std::function<void(const std::string&)> onChanged) {
+    if (s_running) return;
+    s_files.clear();
+    std::set<std::string> folders;
+    for (const auto& path : files) {
+        Watched w;
+        w.path = path;
+        w.native = IniDocument::NativePath(path);
+        w.current = Stat(w.native);
+        s_files.push_back(w);
+        folders.insert(fs::path(w.native).parent_path().string());
+    }
+    s_onChanged = std::move(onChanged);
+    s_intervalMs = std::max(100, intervalMs);
+
+#ifdef PLATFORM_LINUX
+    // The folder is watched, not the files: editors usually save by writing a new file and renaming it
+    s_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (s_inotifyFd >= 0) {
+        int watches = 0;
+        for (const auto& folder : folders) {
+            if (inotify_add_watch(s_inotifyFd, folder.empty() ? "." : folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MODIFY) >= 0) watches++;
+        }
+        if (watches == 0) {
+            close(s_inotifyFd);
+            s_inotifyFd = -1;
+        }
+    }
+#endif
+
+    s_running = true;
+    s_thread = std::thread(Run);
+    Log("ConfigWatcher: watching " + std::to_string(s_files.size()) + " files (" +
+        (s_inotifyFd >= 0 ? std::string("inotify") : "polling every " + std::to_string(s_intervalMs) + " ms") + ")");
+}
+
+void ConfigWatcher::Stop() {
+    if (!s_running.exchange(false)) return;
+    { std::lock_guard<std::mutex> lock(s_waitMutex); }
+    s_waitCv.notify_all();
+    if (s_thread.joinable()) s_thread.join();
+#ifdef PLATFORM_LINUX
+    if (s_inotifyFd >= 0) close(s_inotifyFd);
+#endif
+    s_inotifyFd = -1;
+    s_onChanged = nullptr;
+}
+
+// ------------------------------------------------------------
+// 2. WATCH LOOP
+// ------------------------------------------------------------
+ConfigWatcher::Stamp ConfigWatcher::Stat(const std::string& native) {
+    Stamp s;
+    std::error_code ec;
+    s.size = (uint64_t)fs::file_size(native, ec);
+    if (ec) return Stamp();
+    auto mtime = fs::last_write_time(native, ec);
+    if (ec) return Stamp();
+    s.mtime = (int64_t)mtime.time_since_epoch().count();
+    s.exists = true;
+    return s;
+}
+
+bool ConfigWatcher::Wait(int timeoutMs) {
+#ifdef PLATFORM_LINUX
+    if (s_inotifyFd >= 0) {
+        // Short slices so Stop does not have to wait for the next event
+        pollfd pfd = { s_inotifyFd, POLLIN, 0 };
+        int slice = std::min(timeoutMs, 250);
+        if (poll(&pfd, 1, slice) <= 0) return false;
+        char buffer[4096];
+        while (read(s_inotifyFd, buffer, sizeof(buffer)) > 0) {}   // only "something changed" matters
+        return true;
+    }
+#endif
+    std::unique_lock<std::mutex> lock(s_waitMutex);
+    return s_waitCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [] { return !s_running.load(); });
+}
+
+void ConfigWatcher::Run() {
+    AOS::LowerCurrentThreadPriority();
+    while (s_running) {
+        bool anyPending = std::any_of(s_files.begin(), s_files.end(), [](const Watched& w) { return w.isPending; });
+        Wait(anyPending ? DEBOUNCE_MS / 2 : s_intervalMs);
+        if (!s_running) break;
+
+        uint64_t now = AOS::GetTimeMs();
+        for (auto& w : s_files) {
+            Stamp s = Stat(w.native);
+            if (s == w.current) {
+                w.isPending = false;
+                continue;
+            }
+            // Changed again since the last look: the editor is still writing
+            if (!w.isPending || s != w.pending) {
+                w.pending = s;
+                w.pendingSinceMs = now;
+                w.isPending = true;
+                continue;
+            }
+            if (now - w.pendingSinceMs < (uint64_t)DEBOUNCE_MS) continue;
+
+            w.current = s;
+            w.isPending = false;
+            if (!s.exists) continue;   // deleted: keep what is loaded
+            LogConfig("ConfigWatcher: " + w.path + " changed");
+            try {
+                if (s_onChanged) s_onChanged(w.path);
+            }
+            catch (const std::exception& e) {
+                LogConfig("ConfigWatcher: [ERROR] Reload of " + w.path + " failed: " + std::string(e.what()));
+            }
+        }
+    }
+}
+
+//EOF
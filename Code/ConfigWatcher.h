@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+// ConfigWatcher.h
+// Watches the config INIs and reports a file once it changed and stayed unchanged for
+// DEBOUNCE_MS (editors write in several steps). inotify on the data folder on Linux, a
+// size + mtime poll every interval elsewhere (and as a fallback). The callback runs on the
+// watcher thread.
+
+class ConfigWatcher {
+public:
+    static void Start(const std::vector<std::string>& files, int intervalMs, std::function<void(const std::string&)> onChanged);
+    static void Stop();
+
+private:
+    static const int DEBOUNCE_MS = 300;
+
+    struct Stamp {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        bool exists = false;
+        bool operator==(const Stamp& o) const { return size == o.size && mtime == o.mtime && exists == o.exists; }
+        bool operator!=(const Stamp& o) const { return !(*this == o); }
+    };
+    struct Watched {
+        std::string path;           // as given to Start (passed to the callback)
+        std::string native;
+        Stamp current;              // last reported state
+        Stamp pending;              // changed state waiting for the debounce
+        uint64_t pendingSinceMs = 0;
+        bool isPending = false;
+    };
+
+    static void Run();
+    static Stamp Stat(const std::string& native);
+    // Blocks up to timeoutMs; true if a file system event (or Stop) woke it up
+    static bool Wait(int timeoutMs);
+
+    static std::vector<Watched> s_files;
+    static std::function<void(const std::string&)> s_onChanged;
+    static int s_intervalMs;
+    static std::thread s_thread;
+    static std::atomic<bool> s_running;
+    static std::mutex s_waitMutex;
+    static std::condition_variable s_waitCv;
+    static int s_inotifyFd;         // -1 = polling
+};
+
+//EOF
@@ -0,0 +1,79 @@
+#include "main.h"
+#include "ConversationPrefetch.h"
+#include "PlatformSystem.h"
+#include <algorithm>
+
+using namespace AbstractGame;
+
+// ------------------------------------------------------------
+// STATIC MEMBERS
+// ------------------------------------------------------------
+AHandle ConversationPrefetch::s_candidate = 0;
+ConversationCache ConversationPrefetch::s_cache;
+bool ConversationPrefetch::s_hasCache = false;
+uint64_t ConversationPrefetch::s_lastUpdateMs = 0;
+std::future<bool> ConversationPrefetch::s_task;
+
+// ------------------------------------------------------------
+// 1. PROXIMITY WATCHER
+// ------------------------------------------------------------
+void ConversationPrefetch::Update(AHandle playerPed) {
+    if (!ConfigReader::g_Settings.SPECULATIVE_PREFILL || !g_model || !g_ctx) return;
+
+    uint64_t now = AOS::GetTimeMs();
+    if (now < s_lastUpdateMs + (uint64_t)std::max(0, ConfigReader::g_Settings.PREFETCH_INTERVAL_MS)) return;
+    s_lastUpdateMs = now;
+
+    // Previous prefill still running -> try again next interval
+    if (s_task.valid()) {
+        if (s_task.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) return;
+        s_task.get();
+    }
+
+    AVec3 centre = GetEntityPosition(playerPed);
+    float radius = ConfigReader::g_Settings.MaxConversationRadius * ConfigReader::g_Settings.PREFETCH_RADIUS_SCALE;
+    AHandle candidate = GetClosestPed(centre, radius, playerPed);
+
+    if (!IsEntityValid(candidate) || !IsEntityLivingEntity(candidate) || candidate == playerPed || IsPedInDenialTask(candidate)) {
+        return; // keep the last prefix, the player may just have turned around
+    }
+    if (candidate == s_candidate && s_hasCache) return;
+
+    ConversationCache cache;
+    ResolveConversationCache(candidate, playerPed, cache);
+    std::string systemPrompt = AssembleSystemPrompt(cache, candidate, playerPed);
+    if (systemPrompt.empty()) return;
+
+    s_candidate = candidate;
+    s_cache = cache;
+    s_hasCache = true;
+    s_task = std::async(std::launch::async, PrefillPrefix, systemPrompt);
+    LogLLM("ConversationPrefetch: Prefilling for " + cache.npcName + " (AHandle " + std::to_string((uintptr_t)candidate) + ")");
+}
+
+// ------------------------------------------------------------
+// 2. CONSUME / RESET
+// ------------------------------------------------------------
+bool ConversationPrefetch::TryConsume(AHandle targetPed, ConversationCache& out) {
+    if (!s_hasCache || targetPed != s_candidate) return false;
+    out = s_cache;
+    // The conversation now owns the prefix, the next idle phase prefetches again
+    s_hasCache = false;
+    s_candidate = 0;
+    return true;
+}
+
+void ConversationPrefetch::Invalidate() {
+    s_hasCache = false;
+    s_candidate = 0;
+}
+
+void ConversationPrefetch::Shutdown() {
+    Invalidate();
+    if (s_task.valid()) {
+        try { s_task.wait(); s_task.get(); }
+        catch (...) {}
+    }
+}
+
+//EOF
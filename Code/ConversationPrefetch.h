@@ -0,0 +1,32 @@
+#pragma once
+#include "AbstractTypes.h"
+#include <future>
+#include <cstdint>
+
+// ConversationPrefetch.h
+// Proximity watcher for speculative prefill. While the player is idle, the most likely
+// conversation target (same GetClosestPed logic as the START CONVERSATION TRIGGER, wider
+// radius) is resolved ahead of time and its system prompt is decoded into the prefix
+// sequence of the KV cache. When the activation key is pressed, FillConversationCache
+// takes the resolved data and GenerateLLMResponse only decodes the new tokens.
+
+struct ConversationCache;
+
+class ConversationPrefetch {
+public:
+    // Main thread, once per frame while no conversation is running (throttled internally)
+    static void Update(AHandle playerPed);
+    // true + filled cache if targetPed is the prefetched NPC
+    static bool TryConsume(AHandle targetPed, ConversationCache& out);
+    static void Invalidate();
+    static void Shutdown();
+
+private:
+    static AHandle s_candidate;
+    static ConversationCache s_cache;
+    static bool s_hasCache;
+    static uint64_t s_lastUpdateMs;
+    static std::future<bool> s_task;
+};
+
+//EOF
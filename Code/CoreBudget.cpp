@@ -0,0 +1,160 @@
+#include "CoreBudget.h"
+#include "ConfigReader.h"
+#include "PlatformSystem.h"
+#include "main.h"
+#include <thread>
+#include <algorithm>
+
+bool CoreBudget::s_enabled = false;
+int CoreBudget::s_cores = 4;
+int CoreBudget::s_firstCore = 0;
+std::mutex CoreBudget::s_mutex;
+int CoreBudget::s_active[CoreBudget::STAGES] = {};
+std::atomic<int> CoreBudget::s_threads[CoreBudget::STAGES];
+std::atomic<uint64_t> CoreBudget::s_affinity[CoreBudget::STAGES];
+std::atomic<uint32_t> CoreBudget::s_epoch(0);
+
+// Relative share when stages overlap. Token decode is the longest stage of a turn, STT is
+// what the player waits on right after speaking, TTS streams sentence by sentence.
+static const int STAGE_WEIGHT[] = { 3, 2, 1 };
+static const char* STAGE_NAME[] = { "LLM", "STT", "TTS" };
+
+static uint64_t CoreMask(int first, int count) {
+    uint64_t mask = 0;
+    for (int c = first; c < first + count && c < 64; ++c) mask |= (1ULL << c);
+    return mask;
+}
+
+// ------------------------------------------------------------
+// 1. SETUP
+// ------------------------------------------------------------
+void CoreBudget::Init() {
+    const auto& s = ConfigReader::g_Settings;
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    int cores = (int)std::thread::hardware_concurrency();
+    s_cores = std::clamp(cores > 0 ? cores : 4, 1, 64);
+    // At least one core stays with the engines, even if the game asks for everything
+    s_firstCore = std::clamp(s.CPU_GAME_CORES, 0, s_cores - 1);
+    s_enabled = s.CPU_BUDGET != 0;
+
+    RebalanceLocked();
+    Log("CoreBudget: " + std::to_string(s_cores) + " cores, " + std::to_string(s_firstCore) + " kept for the game" +
+        (s_enabled ? "" : " (disabled, engines keep their own thread counts)"));
+}
+
+// ------------------------------------------------------------
+// 2. STAGES
+// ------------------------------------------------------------
+CoreBudget::Scope::Scope(CpuStage stage, bool pin) : m_stage(stage) {
+    Enter(stage);
+    if (pin && s_enabled && ConfigReader::g_Settings.CPU_PIN_THREADS) {
+        m_pinned = AOS::SetCurrentThreadAffinity(Affinity(stage));
+    }
+}
+
+CoreBudget::Scope::~Scope() {
+    // std::async threads are pooled, do not leave them pinned
+    if (m_pinned) AOS::SetCurrentThreadAffinity(0);
+    Leave(m_stage);
+}
+
+void CoreBudget::Enter(CpuStage stage) {
+    if (!s_enabled) return;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_active[(int)stage]++ == 0) RebalanceLocked();
+}
+
+void CoreBudget::Leave(CpuStage stage) {
+    if (!s_enabled) return;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_active[(int)stage] > 0 && --s_active[(int)stage] == 0) RebalanceLocked();
+}
+
+// Active stages split the budget by weight (at least one core each) and get neighbouring core
+// ranges above the game's cores. An idle stage is offered the whole budget, it is rebalanced
+// the moment it starts anyway.
+void CoreBudget::RebalanceLocked() {
+    const int budget = s_cores - s_firstCore;
+
+    int weightSum = 0;
+    int activeCount = 0;
+    for (int i = 0; i < STAGES; ++i) {
+        if (s_active[i] > 0) { weightSum += STAGE_WEIGHT[i]; activeCount++; }
+    }
+
+    int share[STAGES] = {};
+    if (activeCount > 0) {
+        int given = 0;
+        int largest = -1;
+        for (int i = 0; i < STAGES; ++i) {
+            if (s_active[i] == 0) continue;
+            share[i] = std::max(1, budget * STAGE_WEIGHT[i] / weightSum);
+            given += share[i];
+            if (largest < 0 || share[i] > share[largest]) largest = i;
+        }
+        // Rounding leftovers go to the biggest share; with more stages than cores they overlap
+        if (given < budget) share[largest] += budget - given;
+    }
+
+    int next = s_firstCore;
+    for (int i = 0; i < STAGES; ++i) {
+        int threads = (s_active[i] > 0) ? share[i] : budget;
+        int first = s_firstCore;
+        if (s_active[i] > 0) {
+            if (next + threads > s_cores) next = s_firstCore;
+            first = next;
+            next += threads;
+        }
+        s_threads[i].store(std::max(1, threads));
+        s_affinity[i].store(s_enabled ? CoreMask(first, threads) : 0);
+    }
+    s_epoch.fetch_add(1, std::memory_order_release);
+
+    // Runs on every stage entry / exit, so only for verbose debugging
+    if (activeCount > 0 && ConfigReader::g_Settings.DEBUG_LEVEL >= 3) LogM("CoreBudget: " + DescribeLocked());
+}
+
+// ------------------------------------------------------------
+// 3. QUERIES
+// ------------------------------------------------------------
+int CoreBudget::Threads(CpuStage stage) {
+    return s_threads[(int)stage].load();
+}
+
+uint64_t CoreBudget::Affinity(CpuStage stage) {
+    return s_affinity[(int)stage].load();
+}
+
+void CoreBudget::ApplyToThisThread(CpuStage stage) {
+    thread_local uint32_t applied = 0;
+    if (!s_enabled || !ConfigReader::g_Settings.CPU_PIN_THREADS) return;
+    uint32_t epoch = Epoch();
+    if (epoch == applied) return;
+    applied = epoch;
+    AOS::SetCurrentThreadAffinity(Affinity(stage));
+}
+
+std::string CoreBudget::Describe() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return DescribeLocked();
+}
+
+std::string CoreBudget::DescribeLocked() {
+    std::string out;
+    for (int i = 0; i < STAGES; ++i) {
+        if (!out.empty()) out += "  ";
+        out += STAGE_NAME[i];
+        if (s_active[i] == 0) { out += " -"; continue; }
+        uint64_t mask = s_affinity[i].load();
+        int lo = -1, hi = -1;
+        for (int c = 0; c < 64; ++c) {
+            if (mask & (1ULL << c)) { if (lo < 0) lo = c; hi = c; }
+        }
+        out += " " + std::to_string(s_threads[i].load());
+        if (lo >= 0) out += " [" + std::to_string(lo) + "-" + std::to_string(hi) + "]";
+    }
+    return out;
+}
+
+//EOF
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// CoreBudget.h
+// One CPU budget for llama, Whisper and ONNX instead of three thread pools sized on their own.
+// The cores after CPU_GAME_CORES are split between the stages that are running right now
+// (LLM > STT > TTS by weight). Every stage entry / exit rebalances; engines read their thread
+// count at the next decode / transcription and owned threads get pinned to the stage's cores
+// (CPU_PIN_THREADS). Only the threads we own are pinned: the internal pools of ggml, whisper
+// and ORT are not, so they can still run on the game cores. The budget bounds their size only.
+
+enum class CpuStage : int { LLM = 0, STT, TTS, COUNT };
+
+class CoreBudget {
+public:
+    static void Init();
+    static bool IsEnabled() { return s_enabled; }
+
+    // The stage counts as active while a Scope lives. pin = pin the calling thread meanwhile.
+    class Scope {
+    public:
+        explicit Scope(CpuStage stage, bool pin = true);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        CpuStage m_stage;
+        bool m_pinned = false;
+    };
+
+    // Current share of the stage (what it gets when it starts now if it is idle)
+    static int Threads(CpuStage stage);
+    static uint64_t Affinity(CpuStage stage);   // 0 = not pinned
+    static uint32_t Epoch() { return s_epoch.load(std::memory_order_acquire); }
+
+    // Re-pins the calling thread if the allocation changed since its last call
+    static void ApplyToThisThread(CpuStage stage);
+    // "LLM 6 [2-7] STT - TTS 2 [8-9]" for the metrics log
+    static std::string Describe();
+
+private:
+    static const int STAGES = (int)CpuStage::COUNT;
+
+    static void Enter(CpuStage stage);
+    static void Leave(CpuStage stage);
+    static void RebalanceLocked();
+    static std::string DescribeLocked();
+
+    static bool s_enabled;
+    static int s_cores;
+    static int s_firstCore;                       // cores below are the game's
+    static std::mutex s_mutex;
+    static int s_active[STAGES];                  // guarded by s_mutex
+    static std::atomic<int> s_threads[STAGES];
+    static std::atomic<uint64_t> s_affinity[STAGES];
+    static std::atomic<uint32_t> s_epoch;
+};
+
+//EOF
@@ -17,6 +17,12 @@
 #include "SharedData.h"
 #include "LLM_Inference.h"
 #include "SubtitleManager.h"
+#include "VoicePreloader.h"
+#include "SemanticIndex.h"
+#include "SttStream.h"
+#include "WhisperPool.h"
+#include "SttTwoPass.h"
+#include "CoreBudget.h"
 
 
 #define MINIAUDIO_IMPLEMENTATION
@@ -61,6 +67,13 @@ std::string g_current_npc_name;
 std::vector<std::future<void>> g_backgroundTasks;
 ConversationCache g_ConvoCache;
 ULONGLONG g_stt_start_time = 0;
+// Two-pass STT: the LLM starts on the draft, the main model refines in the background
+std::future<std::string> g_stt_refine_future;
+std::string g_stt_draft_text;
+// Generation cancelled for a refined transcript; its restart waits until this has returned
+std::future<std::string> g_llm_retiring;
+// Prefill of system part + history while the player is still talking
+std::future<bool> g_prefill_future;
 std::chrono::high_resolution_clock::time_point g_llm_start_time;
 
 int g_current_task_type = 1;
@@ -87,6 +100,7 @@ void LogSystemMetrics(const std::string& ctx) {
     else {
         LogM("VRAM: Check failed or unsupported.");
     }
+    if (CoreBudget::IsEnabled()) LogM("CPU: " + CoreBudget::Describe());
 
     LogM("--- END BENCHMARK ---");
 }
@@ -123,6 +137,14 @@ bool DoesFileExist(const std::string& p) {
     return f.good();
 }
 
+// Reply generation on the current chat history (refine restart)
+static void RestartGeneration(AHandle playerPed) {
+    std::string prompt = AssemblePrompt(g_target_ped, playerPed, ConvoManager::GetChatHistory(g_current_chat_ID));
+    g_llm_start_time = std::chrono::high_resolution_clock::now();
+    g_llm_future = std::async(std::launch::async, GenerateLLMResponse, prompt, false);
+    g_llm_state = InferenceState::RUNNING;
+}
+
 void EndConversation() {
     Log("EndConversation() called.");
 
@@ -130,6 +152,8 @@ void EndConversation() {
         StopAudioRecording();
         LogA("Forced audio stop.");
     }
+    SttStream::Cancel();
+    WhisperPool::ResetSessionLanguage();
     if (g_current_task_type == 1 || g_current_task_type == 2) {
         AbstractGame::ClearTasks(g_target_ped);
     }
@@ -166,9 +190,14 @@ void EndConversation() {
     g_renderText.clear();
     // setting conversation task back to 1, default
     g_current_task_type = 1;
-    // Reset futures
+    // Reset futures (cancel first, the future destructor waits for the thread)
+    g_llm_cancel = true;
     if (g_llm_future.valid()) g_llm_future = std::future<std::string>();
+    if (g_llm_retiring.valid()) g_llm_retiring = std::future<std::string>();
+    g_llm_cancel = false;
     if (g_stt_future.valid()) g_stt_future = std::future<std::string>();
+    if (g_stt_refine_future.valid()) g_stt_refine_future = std::future<std::string>();
+    g_stt_draft_text.clear();
 }
 
 bool IsGameInSafeMode() {
@@ -254,8 +283,11 @@ GAME_API void ScriptMain() {
             // 1. CONFIG
             try {
                 ConfigReader::LoadAllConfigs();
+                ConfigReader::StartHotReload();
+                CoreBudget::Init();
                 std::string rootPath = GetModRootPath();
                 AudioManager::Initialize(rootPath);
+                if (ConfigReader::g_Settings.TtS_Enabled) VoicePreloader::Init();
                 std::string g2pModelPath = rootPath + "ECMod\\AudioModels\\deep_phonemizer.onnx";
                 if (!AudioSystem::Initialize(g2pModelPath, 22050)) {
                     Log("ERROR: AudioSystem (G2P engine) failed to initialize. TTS will not function.");
@@ -307,6 +339,9 @@ GAME_API void ScriptMain() {
             ctx_params.n_ctx = static_cast<uint32_t>(ConfigReader::g_Settings.Max_Working_Input);
             ctx_params.n_batch = static_cast<uint32_t>(ConfigReader::g_Settings.n_batch);
             ctx_params.n_ubatch = static_cast<uint32_t>(ConfigReader::g_Settings.n_ubatch);
+            // seq 0 = inference, seq 1 = prefix cache (speculative prefill). Unified KV keeps the full n_ctx for both.
+            ctx_params.n_seq_max = 2;
+            ctx_params.kv_unified = true;
 
             // Detailed Quantization Logging (Restored fully)
             if (ConfigReader::g_Settings.Allow_KV_Cache_Quantization_Type == 1) {
@@ -390,6 +425,16 @@ GAME_API void ScriptMain() {
                 }
             }
             
+            // SEMANTIC KNOWLEDGE INDEX + MEMORY EMBEDDER
+            // Needs the model, so it is built here and not in LoadAllConfigs. Cache hit = instant, otherwise embeds in the background.
+            if (ConfigReader::g_Settings.SEMANTIC_KNOWLEDGE || ConfigReader::g_Settings.MEMORY_STORE) {
+                g_backgroundTasks.push_back(std::async(std::launch::async, [root]() {
+                    if (SemanticIndex::InitEmbedder(g_model, root) && ConfigReader::g_Settings.SEMANTIC_KNOWLEDGE) {
+                        SemanticIndex::Build(g_model, root);
+                    }
+                    }));
+            }
+
             // ------------------------------------------------------------
             // 3. WHISPER (STT) INITIALIZATION
             // ------------------------------------------------------------
@@ -406,6 +451,14 @@ GAME_API void ScriptMain() {
 
                 if (!sttPath.empty() && InitializeWhisper(sttPath.c_str()) && InitializeAudioCaptureDevice()) {
                     Log("Whisper + mic ready");
+
+                    // Optional draft model for two-pass STT
+                    const auto& draftSTT = ConfigReader::g_Settings.STT_DRAFT_MODEL;
+                    if (!draftSTT.empty()) {
+                        if (DoesFileExist(draftSTT)) SttTwoPass::Init(draftSTT);
+                        else if (DoesFileExist(root + draftSTT)) SttTwoPass::Init(root + draftSTT);
+                        else Log("STT draft model not found: " + draftSTT);
+                    }
                 }
                 else {
                     Log("STT disabled - model or mic missing");
@@ -562,7 +615,16 @@ GAME_API void ScriptMain() {
             }
 
             // ----- 3. LLM TIMEOUT CHECK -----
-            if (g_llm_state == InferenceState::RUNNING) {
+            // A refine restart (6b) starts the new generation once the cancelled one has returned
+            if (g_llm_retiring.valid() &&
+                g_llm_retiring.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready) {
+                try { g_llm_retiring.get(); }
+                catch (...) {}
+                g_llm_retiring = std::future<std::string>();
+                g_llm_cancel = false;
+                RestartGeneration(playerPed);
+            }
+            if (g_llm_state == InferenceState::RUNNING && !g_llm_retiring.valid()) {
                 auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - g_llm_start_time).count();
                 if (elapsed > 30) {
                     Log("LLM Timeout -> discard");
@@ -642,7 +704,21 @@ GAME_API void ScriptMain() {
                     StopAudioRecording();
                     g_stt_start_time = AOS::GetTimeMs();
                     g_input_state = InputState::TRANSCRIBING;
-                    g_stt_future = std::async(std::launch::async, TranscribeAudio, g_audio_buffer);
+                    std::future<std::string> mainPass;
+                    if (SttStream::IsActive()) {
+                        // Streaming: everything but the last window is already transcribed
+                        mainPass = std::async(std::launch::async, SttStream::Finish);
+                    }
+                    else {
+                        mainPass = std::async(std::launch::async, TranscribeRecording);
+                    }
+                    if (SttTwoPass::IsEnabled()) {
+                        g_stt_future = std::async(std::launch::async, SttTwoPass::TranscribeDraft);
+                        g_stt_refine_future = std::move(mainPass);
+                    }
+                    else {
+                        g_stt_future = std::move(mainPass);
+                    }
                     g_Subtitles.ShowMessage("System", "Transcribing...");
                 }
             }
@@ -654,6 +730,14 @@ GAME_API void ScriptMain() {
                     std::string txt = g_stt_future.get();
                     g_stt_future = std::future<std::string>();
 
+                    if ((txt.empty() || txt.length() <= 2) && g_stt_refine_future.valid()) {
+                        // Draft heard nothing, wait for the main model instead
+                        Log("STT draft empty -> waiting for refined pass");
+                        g_stt_future = std::move(g_stt_refine_future);
+                        continue;
+                    }
+                    g_stt_draft_text = g_stt_refine_future.valid() ? txt : "";
+
                     if (!txt.empty() && txt.length() > 2) {
                         if (g_current_chat_ID != 0) {
                             ConvoManager::AddMessageToChat(g_current_chat_ID, "Player", txt);
@@ -681,9 +765,52 @@ GAME_API void ScriptMain() {
                 }
             }
 
+            // ----- 6b. STT REFINEMENT (two-pass) -----
+            if (g_stt_refine_future.valid() && g_input_state != InputState::TRANSCRIBING &&
+                g_stt_refine_future.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready) {
+                std::string refined = g_stt_refine_future.get();
+                g_stt_refine_future = std::future<std::string>();
+
+                float dist = SttTwoPass::WordDistance(g_stt_draft_text, refined);
+                if (!g_stt_draft_text.empty() && refined.length() > 2 && dist > 0.0f && g_current_chat_ID != 0) {
+                    // The history keeps the better text either way
+                    std::vector<std::string> history = ConvoManager::GetChatHistory(g_current_chat_ID);
+                    for (auto it = history.rbegin(); it != history.rend(); ++it) {
+                        if (*it == "<|user|>\n" + g_stt_draft_text) {
+                            *it = "<|user|>\n" + refined;
+                            ConvoManager::ReplaceHistory(g_current_chat_ID, history);
+                            break;
+                        }
+                    }
+
+                    bool notShownYet = (g_llm_state == InferenceState::RUNNING || g_llm_state == InferenceState::COMPLETE);
+                    if (dist > ConfigReader::g_Settings.STT_REFINE_THRESHOLD && notShownYet) {
+                        Log("STT refined differs (" + std::to_string(dist) + ") -> restarting generation");
+                        if (g_llm_future.valid()) {
+                            // Not waited for here: step 3 restarts once the cancelled generation has returned
+                            g_llm_cancel = true;
+                            g_llm_retiring = std::move(g_llm_future);
+                            g_llm_state = InferenceState::RUNNING;
+                        }
+                        else {
+                            RestartGeneration(playerPed);
+                        }
+                    }
+                    else {
+                        Log("STT refined kept draft reply (distance " + std::to_string(dist) + ")");
+                    }
+                }
+                g_stt_draft_text.clear();
+            }
+
             // ----- 7. START CONVERSATION TRIGGER -----
             if (g_convo_state == ConvoState::IDLE && g_input_state == InputState::IDLE && g_llm_state == InferenceState::IDLE) {
                 if (IsGameInSafeMode()) {
+                    // Speculative prefill for the NPC the player is most likely to talk to
+                    ConversationPrefetch::Update(playerPed);
+                    // Voices of the closest NPCs are loaded before anyone talks to them
+                    VoicePreloader::Update(playerPed);
+
                     if (IsKeyJustPressed(ConfigReader::g_Settings.ActivationKey)) {
 
                         // 1. Find Target
@@ -733,12 +860,24 @@ GAME_API void ScriptMain() {
             if (g_convo_state == ConvoState::IN_CONVERSATION &&
                 g_input_state == InputState::IDLE &&
                 g_llm_state == InferenceState::IDLE &&
+                !g_stt_refine_future.valid() && // refine pass still reads the last recording
+                !SttStream::IsRetiring() &&     // so does a cancelled streaming pass
+                !IsCaptureInUse() &&            // and any other reader of the capture ring
                 ConfigReader::g_Settings.StT_Enabled &&
                 ConfigReader::g_Settings.StTRB_Activation_Key != 0 &&
                 IsKeyJustPressed(ConfigReader::g_Settings.StTRB_Activation_Key))
             {
                 LogA("PTT pressed -> start recording");
                 StartAudioRecording();
+                if (ConfigReader::g_Settings.STT_STREAMING && g_is_recording) {
+                    SttStream::Begin();
+                }
+                // Everything but the coming player line is known now -> compute its KV while recording
+                if (ConfigReader::g_Settings.SPECULATIVE_PREFILL && g_current_chat_ID != 0 &&
+                    (!g_prefill_future.valid() || g_prefill_future.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready)) {
+                    std::string prefix = AssemblePrefixPrompt(g_target_ped, playerPed, ConvoManager::GetChatHistory(g_current_chat_ID));
+                    g_prefill_future = std::async(std::launch::async, PrefillPrefix, prefix);
+                }
                 g_input_state = InputState::RECORDING;
                 g_Subtitles.ShowMessage("System", "Recording...");
             }
@@ -783,19 +922,37 @@ GAME_API void ScriptMain() {
 
                         if (vs.model.empty() || vs.model == "NONE") return;
 
-                        if (AudioManager::LoadAudioModel(vs.model)) {
-
-                            Vits::Session* session = AudioManager::GetSession(vs.model);
+                        // Repeated lines come straight from the PCM cache, no model load needed
+                        PcmRef pcmData;
+                        bool ready = AudioSystem::LookupCached(clean, vs.model, vs.id, vs.speed, TTS_NOISE, TTS_NOISE_W, pcmData, false);
+
+                        AudioManager::SessionLease lease;
+                        if (!ready) lease = AudioManager::AcquireSession(vs.model);
+                        if (lease) {
+
+                            Vits::Session* session = lease.get();
+                            if (session && ConfigReader::g_Settings.TTS_STREAMING) {
+                                // Subtitle first, the voice starts with the first finished sentence
+                                StreamHandle stream = AudioSystem::OpenStream(22050);
+                                g_Subtitles.ShowMessage(g_current_npc_name, clean, nullptr, 22050, stream);
+                                AudioSystem::Generate(clean, session, vs.id, vs.speed, TTS_NOISE, TTS_NOISE_W, vs.model, stream);
+                                if (stream->Underruns() > 0) {
+                                    Log("TTS: stream underruns " + std::to_string(stream->Underruns()) + " (total " + std::to_string(AudioMixer::TotalUnderruns()) + ")");
+                                }
+                                return;
+                            }
                             if (session) {
                                 // Schritt B: Die blockierende Audio-Generierung (jetzt auch sicher)
-                                std::vector<int16_t> pcmData = AudioSystem::Generate(clean, session, vs.id, vs.speed, TTS_NOISE, TTS_NOISE_W);
-
-                                int finalRate = 22050; // Sicherer Standardwert
-
-                                  g_Subtitles.ShowMessage(g_current_npc_name, clean, pcmData, finalRate);
+                                pcmData = AudioSystem::Generate(clean, session, vs.id, vs.speed, TTS_NOISE, TTS_NOISE_W, vs.model);
+                                ready = true;
                             }
                         }
 
+                        if (ready) {
+                            int finalRate = 22050; // Sicherer Standardwert
+                            g_Subtitles.ShowMessage(g_current_npc_name, clean, pcmData, finalRate);
+                        }
+
                         }));
                 }
 
@@ -823,12 +980,16 @@ GAME_API void ScriptMain() {
     catch (const std::exception& e) {
         Log("SCRIPT EXCEPTION: " + std::string(e.what()));
         ShutdownLLM();
+        ConfigReader::StopHotReload();
+        VoicePreloader::Shutdown();
         AudioSystem::Shutdown();
         TERMINATE();
     }
     catch (...) {
         Log("UNKNOWN EXCEPTION");
         ShutdownLLM();
+        ConfigReader::StopHotReload();
+        VoicePreloader::Shutdown();
         AudioSystem::Shutdown();
         TERMINATE();
     }
@@ -838,6 +999,8 @@ void FinalShutdownHandler() {
     Log("--- FINAL SHUTDOWN HANDLER TRIGGERED ---");
     // We can't do complex logging here, but we can call our main shutdown logic
     if (g_isInitialized) {
+        ConfigReader::StopHotReload();
+        VoicePreloader::Shutdown();
         AudioManager::UnloadAllAudioModels();
         AudioSystem::Shutdown();
         ShutdownLLM();
@@ -941,55 +1104,75 @@ std::string PerformChatSummarization(const std::string& npcName, const std::vect
     return llmSummary + contextFooter;
 }
 
-void FillConversationCache(AHandle targetPed, AHandle playerPed) {
-    Log("Caching conversation context...");
-
-    PersistID npcPid = EntityRegistry::RegisterNPC(targetPed);
+void ResolveConversationCache(AHandle targetPed, AHandle playerPed, ConversationCache& cache) {
+    PersistID npcPid = EntityRegistry::GetIDFromHandle(targetPed);
 
-    g_ConvoCache.npcPersona = ConfigReader::GetPersona(targetPed);
-    g_ConvoCache.playerPersona = ConfigReader::GetPersona(playerPed);
+    cache.npcPersona = ConfigReader::GetPersona(targetPed);
+    cache.playerPersona = ConfigReader::GetPersona(playerPed);
 
-    if (!g_ConvoCache.npcPersona.inGameName.empty()) {
-        g_ConvoCache.npcName = g_ConvoCache.npcPersona.inGameName;
-        EntityRegistry::AssignEntityName(npcPid, g_ConvoCache.npcName);
+    if (!cache.npcPersona->inGameName.empty()) {
+        cache.npcName = cache.npcPersona->inGameName;
     }
-    else if (EntityRegistry::HasAssignedName(npcPid)) {
-        g_ConvoCache.npcName = EntityRegistry::GetEntityName(npcPid);
+    else if (npcPid != 0 && EntityRegistry::HasAssignedName(npcPid)) {
+        cache.npcName = EntityRegistry::GetEntityName(npcPid);
     }
     else {
-        g_ConvoCache.npcName = GenerateNpcName(g_ConvoCache.npcPersona);
-        EntityRegistry::AssignEntityName(npcPid, g_ConvoCache.npcName);
+        // Assigned in FillConversationCache, once the conversation really starts
+        cache.npcName = GenerateNpcName(*cache.npcPersona);
     }
-    g_current_npc_name = g_ConvoCache.npcName;
 
-    g_ConvoCache.playerName = "Stranger";
-    g_ConvoCache.characterRelationship = "unknown";
-    g_ConvoCache.groupRelationship = "unknown";
+    cache.playerName = "Stranger";
+    cache.characterRelationship = "unknown";
+    cache.groupRelationship = "unknown";
 
-    if (!g_ConvoCache.npcPersona.inGameName.empty() && !g_ConvoCache.playerPersona.inGameName.empty()) {
-        g_ConvoCache.characterRelationship = ConfigReader::GetRelationship(g_ConvoCache.npcPersona.inGameName, g_ConvoCache.playerPersona.inGameName);
+    if (!cache.npcPersona->inGameName.empty() && !cache.playerPersona->inGameName.empty()) {
+        cache.characterRelationship = ConfigReader::GetRelationship(cache.npcPersona->inGameName, cache.playerPersona->inGameName);
     }
-    if (!g_ConvoCache.npcPersona.subGroup.empty() && !g_ConvoCache.playerPersona.subGroup.empty()) {
-        g_ConvoCache.groupRelationship = ConfigReader::GetRelationship(g_ConvoCache.npcPersona.subGroup, g_ConvoCache.playerPersona.subGroup);
+    if (!cache.npcPersona->subGroup.empty() && !cache.playerPersona->subGroup.empty()) {
+        cache.groupRelationship = ConfigReader::GetRelationship(cache.npcPersona->subGroup, cache.playerPersona->subGroup);
     }
-    if (g_ConvoCache.playerPersona.type == "PLAYER") {
-        g_ConvoCache.playerName = g_ConvoCache.playerPersona.inGameName;
+    if (cache.playerPersona->type == "PLAYER") {
+        cache.playerName = cache.playerPersona->inGameName;
     }
+}
 
-    if (g_ConvoCache.playerPersona.type == "PLAYER") {
-        g_ConvoCache.playerName = g_ConvoCache.playerPersona.inGameName;
+void FillConversationCache(AHandle targetPed, AHandle playerPed) {
+    Log("Caching conversation context...");
+
+    PersistID npcPid = EntityRegistry::RegisterNPC(targetPed);
+
+    // Already resolved by the proximity watcher?
+    if (ConversationPrefetch::TryConsume(targetPed, g_ConvoCache)) {
+        Log("Using prefetched conversation context.");
+    }
+    else {
+        ResolveConversationCache(targetPed, playerPed, g_ConvoCache);
     }
 
+    if (!g_ConvoCache.npcPersona->inGameName.empty() || !EntityRegistry::HasAssignedName(npcPid)) {
+        EntityRegistry::AssignEntityName(npcPid, g_ConvoCache.npcName);
+    }
+    else {
+        g_ConvoCache.npcName = EntityRegistry::GetEntityName(npcPid);
+    }
+    g_current_npc_name = g_ConvoCache.npcName;
+
     // Die Initialisierungen fr AudioManager und AudioSystem wurden entfernt,
     // da sie nur einmal in ScriptMain() erfolgen sollten.
 
-    VoiceSettings vs = AudioManager::GetVoiceForNPC(g_ConvoCache.npcPersona);
+    // An NPC keeps its voice; a new one gets the voice the preloader has already been loading
+    VoiceSettings vs = EntityRegistry::GetVoiceSettings(npcPid);
+    bool hadVoice = !vs.model.empty() && vs.model != "NONE";
+    if (!hadVoice && !VoicePreloader::TakePrediction(targetPed, vs)) {
+        vs = AudioManager::GetVoiceForNPC(*g_ConvoCache.npcPersona);
+    }
 
-    EntityRegistry::SetVoiceSettings(npcPid, vs);
+    if (!hadVoice) EntityRegistry::SetVoiceSettings(npcPid, vs);
     Log("Assigned Voice: Model=" + vs.model + ", ID=" + std::to_string(vs.id) + " to NPC " + g_ConvoCache.npcName);
 
+    // No model load on the script thread: a miss is queued in front of the preload worker
     if (ConfigReader::g_Settings.TtS_Enabled && vs.model != "NONE" && !vs.model.empty()) {
-        AudioManager::LoadAudioModel(vs.model);
+        VoicePreloader::OnConversationStart(vs);
     }
 
     Log("Conversation context cached.");
@@ -8,6 +8,8 @@ using namespace AbstractTypes;
 #include <shared_mutex>
 #include <unordered_map>
 #include "EntityRegistry.h"
+#include "MemoryStore.h"
+#include "VoiceCatalog.h"
 #include "main.h"
 
 using namespace AbstractTypes;
@@ -43,7 +45,8 @@ PersistID EntityRegistry::RegisterNPC(GameHandle handle) {
     if (g_handleToID.count(handle)) return g_handleToID[handle];
 
     // 3. Load Identity Persona
-    NpcPersona persona = ConfigReader::GetPersona((AHandle)handle);
+    PersonaRef personaRef = ConfigReader::GetPersona((AHandle)handle);
+    const NpcPersona& persona = *personaRef;
 
     PersistID newID;
     bool isPersistent = false;
@@ -82,14 +85,25 @@ PersistID EntityRegistry::RegisterNPC(GameHandle handle) {
         data.e_audioID = data.voice.id;
     }
 
-    // Save to global storage
+    // Save to global storage (a returning hero replaces its old record)
+    VoiceSettings previous;
+    auto existing = g_registry.find(newID);
+    if (existing != g_registry.end()) previous = existing->second.voice;
     g_registry[newID] = data;
     g_handleToID[handle] = newID;
+    lock.unlock();
+
+    // Persona voices are reserved like assigned ones, OnEntityRemoved releases every voice
+    VoiceCatalog::Release(previous);
+    VoiceCatalog::Reserve(data.voice);
 
     return newID;
 }
 
 void EntityRegistry::OnEntityRemoved(GameHandle handle) {
+    PersistID forgottenID = 0;
+    VoiceSettings freedVoice;
+    {
     std::unique_lock<std::shared_mutex> lock(g_registryMutex);
 
     if (g_handleToID.count(handle)) {
@@ -105,11 +119,19 @@ void EntityRegistry::OnEntityRemoved(GameHandle handle) {
                 g_registry[id].handle = 0;
             }
             else {
-                // Extra: Forget forever
+                // Extra: Forget forever (heroes keep their voice reserved)
+                freedVoice = g_registry[id].voice;
                 g_registry.erase(id);
+                forgottenID = id;
             }
         }
     }
+    }
+    if (forgottenID != 0) {
+        MemoryStore::Erase(forgottenID);
+        AudioManager::UnpinEntity(forgottenID);
+        VoiceCatalog::Release(freedVoice);
+    }
 }
 
 // ---------------------------------------------------------------------
@@ -153,6 +175,11 @@ void EntityRegistry::SetGoal(PersistID id, const std::string& goal) {
 }
 
 void EntityRegistry::SetCustomKnowledge(PersistID id, const std::string& knowledge) {
+    if (ConfigReader::g_Settings.MEMORY_STORE) {
+        // Fact records instead of one growing string
+        if (HasEntity(id)) MemoryStore::ReplaceFacts(id, knowledge);
+        return;
+    }
     std::unique_lock<std::shared_mutex> lock(g_registryMutex);
     if (g_registry.count(id)) {
         g_registry[id].customKnowledge = knowledge;
@@ -160,6 +187,10 @@ void EntityRegistry::SetCustomKnowledge(PersistID id, const std::string& knowled
 }
 
 void EntityRegistry::AppendMemory(PersistID id, const std::string& fact) {
+    if (ConfigReader::g_Settings.MEMORY_STORE) {
+        if (HasEntity(id)) MemoryStore::AddFact(id, fact);
+        return;
+    }
     std::unique_lock<std::shared_mutex> lock(g_registryMutex);
     if (g_registry.count(id)) {
         if (!g_registry[id].customKnowledge.empty()) {
@@ -263,13 +294,19 @@ bool EntityRegistry::IsVoiceActive(const std::string& modelName, int id) {
 
 
 void EntityRegistry::SetVoiceSettings(PersistID id, const VoiceSettings& settings) {
-    std::unique_lock<std::shared_mutex> lock(g_registryMutex);
-    auto it = g_registry.find(id);
-    if (it != g_registry.end()) {
+    VoiceSettings previous;
+    {
+        std::unique_lock<std::shared_mutex> lock(g_registryMutex);
+        auto it = g_registry.find(id);
+        if (it == g_registry.end()) return;
+        previous = it->second.voice;
         it->second.voice = settings;
         it->second.e_audiomodel = settings.model;
         it->second.e_audioID = settings.id;
     }
+    // Reservation counts for VoiceCatalog::Pick (outside our lock, the catalog has its own)
+    VoiceCatalog::Release(previous);
+    VoiceCatalog::Reserve(settings);
 }
 
 VoiceSettings EntityRegistry::GetVoiceSettings(PersistID id) {
@@ -1,5 +1,7 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "main.h"
+#include "SttTwoPass.h"
+#include "SemanticIndex.h"
 #include <sstream>
 #include <fstream>
 #include <iomanip>
@@ -15,6 +17,7 @@ using namespace AbstractTypes;
 
 std::string LOG_FILE_NAME_METRICS;
 std::string LOG_FILE_NAME_AUDIO;
+extern std::vector<std::future<void>> g_backgroundTasks;
 
 
 // --- LOGGING IMPLEMENTATION ---
@@ -171,8 +174,7 @@ extern "C" {
         std::string finalName;
         if (name_override && name_override[0] != '\0') finalName = name_override;
         else {
-            NpcPersona p = ConfigReader::GetPersona((AHandle)pedHandle);
-            finalName = GenerateNpcName(p);
+            finalName = GenerateNpcName(*ConfigReader::GetPersona((AHandle)pedHandle));
         }
         g_current_npc_name = finalName;
 
@@ -230,6 +232,8 @@ extern "C" {
             llama_memory_t mem = llama_get_memory(g_ctx);
             if (mem) {
                 llama_memory_clear(mem, true);
+                ResetPrefixCache();
+                ConversationPrefetch::Invalidate();
                 Log("[API] KV Cache (LLM working memory) cleared.");
                 return;
             }
@@ -285,6 +289,9 @@ extern "C" {
             ctx_params.n_ctx = static_cast<uint32_t>(ConfigReader::g_Settings.Max_Working_Input);
             ctx_params.n_batch = 1024;
             ctx_params.n_ubatch = 256;
+            // seq 0 = inference, seq 1 = prefix cache (speculative prefill). Unified KV keeps the full n_ctx for both.
+            ctx_params.n_seq_max = 2;
+            ctx_params.kv_unified = true;
 
             if (ConfigReader::g_Settings.USE_VRAM_PREFERED) {
                 ctx_params.type_k = GGML_TYPE_F16;
@@ -315,6 +322,16 @@ extern "C" {
                 return false;
             }
 
+            // ShutdownLLM freed the embedder together with the old model, memory and knowledge
+            // retrieval need it back (same as the startup sequence)
+            if (ConfigReader::g_Settings.SEMANTIC_KNOWLEDGE || ConfigReader::g_Settings.MEMORY_STORE) {
+                g_backgroundTasks.push_back(std::async(std::launch::async, [root]() {
+                    if (SemanticIndex::InitEmbedder(g_model, root) && ConfigReader::g_Settings.SEMANTIC_KNOWLEDGE) {
+                        SemanticIndex::Build(g_model, root);
+                    }
+                    }));
+            }
+
             if (ConfigReader::g_Settings.StT_Enabled) {
                 std::string sttPath;
                 const auto& custSTT = ConfigReader::g_Settings.STT_MODEL_PATH;
@@ -325,6 +342,12 @@ extern "C" {
 
                 if (!sttPath.empty() && InitializeWhisper(sttPath.c_str()) && InitializeAudioCaptureDevice()) {
                     Log("Whisper re-initialized successfully.");
+
+                    const auto& draftSTT = ConfigReader::g_Settings.STT_DRAFT_MODEL;
+                    if (!draftSTT.empty()) {
+                        if (DoesFileExist(draftSTT)) SttTwoPass::Init(draftSTT);
+                        else if (DoesFileExist(root + draftSTT)) SttTwoPass::Init(root + draftSTT);
+                    }
                 }
                 else {
                     Log("STT re-initialization failed or model missing.");
@@ -453,6 +476,7 @@ extern "C" {
         vs.id = id;
         vs.speed = 1.0f; // Default speed
         EntityRegistry::SetVoiceSettings(pid, vs);
+        AudioManager::PinForEntity(pid, vs.model);   // script-assigned voices belong to named characters
         // Pre-load it if we can
         if (ConfigReader::g_Settings.TtS_Enabled && vs.model != "NONE") {
             // Dispatch a background load so it's ready when they speak
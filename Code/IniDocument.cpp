@@ -0,0 +1,142 @@
+#include "IniDocument.h"
+#include "Platform.h"
+#include <fstream>
+#include <algorithm>
+
+static inline unsigned char LowerAscii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+static std::string_view Trim(std::string_view s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string_view::npos) return {};
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+// ------------------------------------------------------------
+// 1. CASE-INSENSITIVE INDEX
+// ------------------------------------------------------------
+size_t IniCaseHash::operator()(std::string_view s) const {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : s) { h ^= LowerAscii(c); h *= 1099511628211ULL; }
+    return (size_t)h;
+}
+
+bool IniCaseEqual::operator()(std::string_view a, std::string_view b) const {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (LowerAscii((unsigned char)a[i]) != LowerAscii((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+const IniEntry* IniSection::Find(std::string_view key) const {
+    auto it = index.find(key);
+    return it != index.end() ? &entries[it->second] : nullptr;
+}
+
+std::string_view IniSection::Get(std::string_view key, std::string_view fallback) const {
+    const IniEntry* entry = Find(key);
+    if (!entry) return fallback;
+    std::string_view v = entry->value;
+    if (v.size() >= 2 && (v.front() == '"' || v.front() == '\'') && v.back() == v.front()) {
+        v = v.substr(1, v.size() - 2);
+    }
+    return v;
+}
+
+// ------------------------------------------------------------
+// 2. LOAD / PARSE
+// ------------------------------------------------------------
+bool IniDocument::Load(const std::string& path) {
+    Clear();
+    m_path = path;
+    std::ifstream file(NativePath(path), std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    std::streamoff size = file.tellg();
+    if (size < 0) return false;
+    std::string text((size_t)size, '\0');
+    file.seekg(0);
+    if (size > 0 && !file.read(&text[0], size)) return false;
+
+    Parse(std::move(text));
+    m_loaded = true;
+    return true;
+}
+
+std::string IniDocument::NativePath(const std::string& path) {
+    std::string native = path;
+#ifndef PLATFORM_WINDOWS
+    std::replace(native.begin(), native.end(), '\\', '/');
+#endif
+    return native;
+}
+
+// Single pass: every line is looked at once, sections and keys are indexed on the way
+void IniDocument::Parse(std::string text) {
+    std::string path = std::move(m_path);
+    Clear();
+    m_path = std::move(path);
+    m_text = std::move(text);
+
+    std::string_view all(m_text);
+    if (all.size() >= 3 && (unsigned char)all[0] == 0xEF && (unsigned char)all[1] == 0xBB && (unsigned char)all[2] == 0xBF) {
+        all.remove_prefix(3);
+    }
+
+    IniSection* current = nullptr;
+    size_t pos = 0;
+    while (pos < all.size()) {
+        size_t end = all.find('\n', pos);
+        if (end == std::string_view::npos) end = all.size();
+        std::string_view line = Trim(all.substr(pos, end - pos));
+        pos = end + 1;
+
+        if (line.empty() || line[0] == ';') continue;
+
+        if (line[0] == '[') {
+            size_t close = line.find(']');
+            if (close == std::string_view::npos) continue;
+            m_sections.emplace_back();
+            m_sections.back().name = line.substr(1, close - 1);
+            m_sectionIndex.emplace(m_sections.back().name, (uint32_t)(m_sections.size() - 1));
+            current = &m_sections.back();
+            continue;
+        }
+
+        if (!current) continue;
+        size_t sep = line.find('=');
+        if (sep == std::string_view::npos) continue;
+
+        IniEntry entry;
+        entry.key = Trim(line.substr(0, sep));
+        entry.value = Trim(line.substr(sep + 1));
+        entry.line = line;
+        current->entries.push_back(entry);
+        current->index.emplace(entry.key, (uint32_t)(current->entries.size() - 1));
+    }
+}
+
+void IniDocument::Clear() {
+    m_sectionIndex.clear();
+    m_sections.clear();
+    m_text.clear();
+    m_path.clear();
+    m_loaded = false;
+}
+
+// ------------------------------------------------------------
+// 3. LOOKUP
+// ------------------------------------------------------------
+const IniSection* IniDocument::FindSection(std::string_view name) const {
+    auto it = m_sectionIndex.find(name);
+    return it != m_sectionIndex.end() ? &m_sections[it->second] : nullptr;
+}
+
+std::string_view IniDocument::Get(std::string_view section, std::string_view key, std::string_view fallback) const {
+    const IniSection* sec = FindSection(section);
+    return sec ? sec->Get(key, fallback) : fallback;
+}
+
+//EOF
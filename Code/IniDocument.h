@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// IniDocument.h
+// One INI file read into memory in a single pass (replaces GetPrivateProfileString*, works on
+// every platform). Section and key lookups are case-insensitive hash lookups like the Windows
+// API; names and values are string_views into the document's own buffer, so nothing is copied
+// per key. The first occurrence of a section / key wins, Sections() still lists every section
+// in file order (duplicates included).
+
+struct IniCaseHash {
+    size_t operator()(std::string_view s) const;
+};
+struct IniCaseEqual {
+    bool operator()(std::string_view a, std::string_view b) const;
+};
+
+struct IniEntry {
+    std::string_view key;       // trimmed
+    std::string_view value;     // trimmed, quotes and comments kept
+    std::string_view line;      // whole trimmed line
+};
+
+struct IniSection {
+    std::string_view name;
+    std::vector<IniEntry> entries;                                            // file order
+    std::unordered_map<std::string_view, uint32_t, IniCaseHash, IniCaseEqual> index;   // key -> first entry
+
+    const IniEntry* Find(std::string_view key) const;
+    // Value like GetPrivateProfileString returns it (surrounding quotes removed), fallback if missing
+    std::string_view Get(std::string_view key, std::string_view fallback = {}) const;
+};
+
+class IniDocument {
+public:
+    IniDocument() = default;
+    // Not copyable / movable, the views would point into another object's buffer
+    IniDocument(const IniDocument&) = delete;
+    IniDocument& operator=(const IniDocument&) = delete;
+
+    // False if the file cannot be read (the document is empty then)
+    bool Load(const std::string& path);
+    void Parse(std::string text);
+    void Clear();
+
+    bool IsLoaded() const { return m_loaded; }
+    const std::string& Path() const { return m_path; }
+    const std::string& Text() const { return m_text; }
+    // The data paths are written Windows style (".\\ECMod\\..."), other platforms get '/'
+    static std::string NativePath(const std::string& path);
+
+    const std::vector<IniSection>& Sections() const { return m_sections; }
+    const IniSection* FindSection(std::string_view name) const;
+    // First section of that name, see IniSection::Get
+    std::string_view Get(std::string_view section, std::string_view key, std::string_view fallback = {}) const;
+
+private:
+    std::string m_path;
+    std::string m_text;       // every view points in here
+    bool m_loaded = false;
+    std::vector<IniSection> m_sections;
+    std::unordered_map<std::string_view, uint32_t, IniCaseHash, IniCaseEqual> m_sectionIndex;
+};
+
+//EOF
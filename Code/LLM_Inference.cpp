@@ -12,6 +12,7 @@
 #include <fstream>
 #include <iomanip>
 #include <mutex>
+#include <atomic>
 
 using namespace AbstractGame;
 using namespace AbstractTypes;
@@ -29,10 +30,27 @@ InferenceState g_llm_state = InferenceState::IDLE;
 std::future<std::string> g_llm_future;
 std::string g_llm_response = "";
 std::chrono::high_resolution_clock::time_point g_response_start_time;
+std::atomic<bool> g_llm_cancel{ false }; // set by the main thread to stop GenerateLLMResponse early
 static int32_t g_repeat_last_n = 512;
 
 // [FIX] Global Mutex to prevent Thread Collision (Crashes)
 static std::mutex g_inference_mutex;
+
+// Prefix Cache (speculative prefill)
+// Sequence 0 is the working sequence of GenerateLLMResponse, sequence 1 keeps the
+// last prefilled prompt. s_prefixTokens mirrors sequence 1 and is guarded by g_inference_mutex.
+static const llama_seq_id SEQ_WORK = 0;
+static const llama_seq_id SEQ_PREFIX = 1;
+static std::vector<llama_token> s_prefixTokens;
+static uint64_t s_prefixGeneration = 0;
+static std::atomic<int> s_foregroundWaiting{ 0 };
+
+// CPU budget: thread count of g_ctx follows CoreBudget (guarded by g_inference_mutex)
+static uint32_t s_threadEpoch = 0;
+static llama_context* s_threadCtx = nullptr;
+static int s_ctxThreads = 0;          // what g_ctx was created with, the budget never goes above
+static int s_ctxThreadsBatch = 0;
+
 std::string LOG_FILE_NAME3 = "kkamel_inf.log";
 // Metrics
 float g_current_tps = 20.0f;
@@ -42,9 +60,9 @@ struct llama_adapter_lora* g_lora_adapter = nullptr;
 
 // STT Globals
 struct whisper_context* g_whisper_ctx = nullptr;
-std::vector<float> g_audio_buffer;
+AudioRingBuffer<float> g_capture_ring;
 ma_device g_capture_device;
-bool g_is_recording = false;
+std::atomic<bool> g_is_recording{ false };
 std::future<std::string> g_stt_future;
 
 // Memory Monitoring
@@ -207,6 +225,13 @@ void UpdateRepeatPenaltyFromConfig() {
 #include "LLM_Inference.h"
 #include "EntityRegistry.h"
 #include "ConfigReader.h"
+#include "SemanticIndex.h"
+#include "MemoryStore.h"
+#include "SttStream.h"
+#include "VoiceActivity.h"
+#include "WhisperPool.h"
+#include "SttTwoPass.h"
+#include "CoreBudget.h"
 #include <sstream>
 #include <set>
 #include <algorithm>
@@ -217,23 +242,24 @@ extern AHandle g_target_ped;           // Access global target handle if needed
 
 
 
-std::string AssemblePrompt(AHandle targetPed, AHandle playerPed, const std::vector<std::string>& chatHistory) {
+// Prompt layout (keeps the front of the prompt identical between turns, so the KV prefix
+// cache can reuse it):
+//   <|system|> persona, scenario, instructions, always-loaded knowledge, zone <|end|>
+//   CHAT HISTORY (older lines)
+//   <|system|> [RELEVANT CONTEXT] memory + knowledge for the newest player line <|end|>
+//   newest player line
+//   <|assistant|>
 
-    // 1. Safety Checks
-    if (!g_model || !g_ctx) {
-        LogLLM("AssemblePrompt FATAL: g_model or g_ctx is null.");
-        return "";
-    }
-    const llama_vocab* vocab = llama_model_get_vocab(g_model);
-    if (!vocab) return "";
+// Stable system part. Split from AssemblePrompt so ConversationPrefetch can build it for an
+// NPC before the conversation exists.
+std::string AssembleSystemPrompt(const ConversationCache& cache, AHandle targetPed, AHandle playerPed) {
 
     std::stringstream basePromptStream;
 
-    // 2. Cache & Daten laden (DEIN ORIGINALER CODE, angepasst auf globale Variable)
-    // Wir nutzen hier g_ConvoCache statt dem Parameter "cache", weil Main.cpp den Cache global fllt.
-    const NpcPersona& target = g_ConvoCache.npcPersona;
-    const std::string& npcName = g_ConvoCache.npcName;
-    const std::string& playerName = g_ConvoCache.playerName;
+    // 2. Cache & Daten laden
+    const NpcPersona& target = *cache.npcPersona;
+    const std::string& npcName = cache.npcName;
+    const std::string& playerName = cache.playerName;
 
     // Dynamische Daten holen (wie in deinem Original)
     PersistID targetID = EntityRegistry::GetIDFromHandle(targetPed);
@@ -256,46 +282,82 @@ std::string AssemblePrompt(AHandle targetPed, AHandle playerPed, const std::vect
 
     basePromptStream << "\nSCENARIO:\n";
     // basePromptStream << "- Time: " << GetCurrentTimeState() << "\n"; // (Einkommentieren wenn verfgbar)
-    basePromptStream << "- Interacting with: " << playerName << " (Role: " << g_ConvoCache.playerPersona.type << " / " << g_ConvoCache.playerPersona.subGroup << ")\n";
-    basePromptStream << "- Character Relationship: " << g_ConvoCache.characterRelationship << "\n";
-    basePromptStream << "- Group Relationship: " << g_ConvoCache.groupRelationship << "\n";
+    basePromptStream << "- Interacting with: " << playerName << " (Role: " << cache.playerPersona->type << " / " << cache.playerPersona->subGroup << ")\n";
+    basePromptStream << "- Character Relationship: " << cache.characterRelationship << "\n";
+    basePromptStream << "- Group Relationship: " << cache.groupRelationship << "\n";
 
     basePromptStream << "\nINSTRUCTIONS:\n";
     basePromptStream << "- Speak ONLY as " << npcName << ".\n";
     // ... deine restlichen Anweisungen ...
     basePromptStream << "Never Say that you are an fictional character, an AI, phi3, or similar. Never say you are in a fictional world.";
 
-    // 4. COMPLEX CONTEXT INJECTION (DEIN KOMPLETTER ORIGINAL-CODE)
+    // 4. STABLE CONTEXT (does not depend on what the player just said)
     // -----------------------------------------------------------
     std::stringstream injectedContext;
-    std::set<std::string> alreadyInjectedSections;
 
-    if (!targetData.customKnowledge.empty()) {
-        injectedContext << "[PERSISTENT MEMORY]: " << targetData.customKnowledge << "\n";
-    }
-
-    for (const auto& pair : ConfigReader::g_KnowledgeDB) {
+    auto config = ConfigReader::Current();
+    for (const auto& pair : config->knowledge) {
         if (pair.second.isAlwaysLoaded) {
             injectedContext << pair.second.content;
-            alreadyInjectedSections.insert(pair.first);
         }
     }
 
-    std::string lastPlayerMsg = "";
-    if (!chatHistory.empty()) {
-        for (auto it = chatHistory.rbegin(); it != chatHistory.rend(); ++it) {
-            // Wir suchen nach dem User Tag oder nehmen einfach die letzte Zeile, wenn sie vom Spieler ist
-            if (it->find("Player") != std::string::npos || it->find("<|user|>") != std::string::npos) {
-                lastPlayerMsg = *it;
-                break;
+    // Zone Context
+    AVec3 centre = GetEntityPosition(playerPed);
+    std::string zoneName = AbstractGame::GetZoneName(centre);
+    std::string zoneContext = ConfigReader::GetZoneContext(zoneName);
+    if (!zoneContext.empty()) {
+        injectedContext << zoneName << " = " << zoneContext << "\n";
+    }
+
+    std::string finalInjectedText = injectedContext.str();
+    if (!finalInjectedText.empty()) {
+        basePromptStream << "\n[ADDITIONAL CONTEXT]:\n" << finalInjectedText;
+    }
+    // -----------------------------------------------------------
+
+    basePromptStream << "<|end|>\n";
+    return basePromptStream.str();
+}
+
+// Memory + knowledge selected for the newest player line. Goes right before that line,
+// so everything in front of it stays cacheable.
+static std::string AssembleRetrievedContext(AHandle targetPed, const std::string& lastPlayerMsg) {
+    std::stringstream injectedContext;
+    std::set<std::string> alreadyInjectedSections;
+
+    PersistID targetID = EntityRegistry::GetIDFromHandle(targetPed);
+    EntityData targetData = EntityRegistry::GetData(targetID);
+
+    // One query embedding, shared by memory and knowledge retrieval
+    std::vector<float> queryVec;
+    if ((ConfigReader::g_Settings.SEMANTIC_KNOWLEDGE || ConfigReader::g_Settings.MEMORY_STORE) &&
+        SemanticIndex::HasEmbedder() && !lastPlayerMsg.empty()) {
+        SemanticIndex::Embed(lastPlayerMsg, queryVec);
+    }
+
+    if (ConfigReader::g_Settings.MEMORY_STORE) {
+        std::vector<std::string> facts = MemoryStore::Retrieve(targetID, queryVec, ConfigReader::g_Settings.MEMORY_TOKEN_BUDGET);
+        if (!facts.empty()) {
+            injectedContext << "[PERSISTENT MEMORY]:\n";
+            for (const std::string& fact : facts) {
+                injectedContext << "- " << fact << "\n";
             }
         }
     }
+    else if (!targetData.customKnowledge.empty()) {
+        injectedContext << "[PERSISTENT MEMORY]: " << targetData.customKnowledge << "\n";
+    }
+
+    auto config = ConfigReader::Current();
+    for (const auto& pair : config->knowledge) {
+        if (pair.second.isAlwaysLoaded) alreadyInjectedSections.insert(pair.first); // already in the system part
+    }
 
     std::string normalizedPlayerInput = NormalizeString(lastPlayerMsg);
 
     if (!normalizedPlayerInput.empty()) {
-        for (const auto& pair : ConfigReader::g_KnowledgeDB) {
+        for (const auto& pair : config->knowledge) {
             const auto& section = pair.second;
             if (section.isAlwaysLoaded || alreadyInjectedSections.count(pair.first)) continue;
 
@@ -321,22 +383,54 @@ std::string AssemblePrompt(AHandle targetPed, AHandle playerPed, const std::vect
         }
     }
 
-    // Zone Context
-    AVec3 centre = GetEntityPosition(playerPed);
-    std::string zoneName = AbstractGame::GetZoneName(centre);
-    std::string zoneContext = ConfigReader::GetZoneContext(zoneName);
-    if (!zoneContext.empty()) {
-        injectedContext << zoneName << " = " << zoneContext << "\n";
+    // Semantic Knowledge (embedding similarity, catches what the keywords miss)
+    if (ConfigReader::g_Settings.SEMANTIC_KNOWLEDGE && SemanticIndex::IsReady() && !queryVec.empty()) {
+        std::set<std::string> injectedKeys;
+        std::vector<SemanticHit> hits = SemanticIndex::Query(queryVec, ConfigReader::g_Settings.KNOWLEDGE_TOP_K, ConfigReader::g_Settings.KNOWLEDGE_MIN_SIMILARITY);
+        for (const SemanticHit& hit : hits) {
+            SemanticEntry entry = SemanticIndex::GetEntry(hit.entry);
+            if (entry.text.empty() || alreadyInjectedSections.count(entry.sectionName)) continue;
+            if (entry.key.empty()) {
+                alreadyInjectedSections.insert(entry.sectionName);
+            }
+            else if (!injectedKeys.insert(entry.sectionName + entry.key).second) {
+                continue;
+            }
+            injectedContext << entry.text;
+        }
+        LogLLM("AssemblePrompt: Semantic knowledge hits: " + std::to_string(hits.size()));
     }
 
-    std::string finalInjectedText = injectedContext.str();
-    if (!finalInjectedText.empty()) {
-        basePromptStream << "\n[ADDITIONAL CONTEXT]:\n" << finalInjectedText;
+    std::string text = injectedContext.str();
+    if (text.empty()) return "";
+    return "<|system|>\n[RELEVANT CONTEXT]:\n" + text + "<|end|>\n";
+}
+
+static bool IsPlayerLine(const std::string& line) {
+    return line.find("Player") != std::string::npos || line.find("<|user|>") != std::string::npos;
+}
+
+// prefixOnly: everything that is already known before the player speaks (system part +
+// existing history), for PrefillPrefix while PTT is held.
+static std::string BuildPrompt(AHandle targetPed, AHandle playerPed, const std::vector<std::string>& chatHistory, bool prefixOnly) {
+
+    // 1. Safety Checks
+    if (!g_model || !g_ctx) {
+        LogLLM("AssemblePrompt FATAL: g_model or g_ctx is null.");
+        return "";
     }
-    // -----------------------------------------------------------
+    const llama_vocab* vocab = llama_model_get_vocab(g_model);
+    if (!vocab) return "";
 
-    basePromptStream << "<|end|>\n";
-    std::string static_prompt = basePromptStream.str();
+    // 2. - 4. System Prompt (g_ConvoCache is filled by FillConversationCache)
+    std::string static_prompt = AssembleSystemPrompt(g_ConvoCache, targetPed, playerPed);
+
+    // Newest player line -> retrieval query, placed after its context block
+    std::string lastPlayerMsg = "";
+    if (!prefixOnly && !chatHistory.empty() && IsPlayerLine(chatHistory.back())) {
+        lastPlayerMsg = chatHistory.back();
+    }
+    std::string retrieved_context = prefixOnly ? "" : AssembleRetrievedContext(targetPed, lastPlayerMsg);
 
     // 5. TOKEN BUDGETING (DEIN KOMPLETTER ORIGINAL-CODE)
     // -----------------------------------------------------------
@@ -344,7 +438,8 @@ std::string AssemblePrompt(AHandle targetPed, AHandle playerPed, const std::vect
     const int32_t response_buffer = 256;
 
     std::vector<llama_token> static_tokens(n_ctx);
-    int32_t static_token_count = llama_tokenize(vocab, static_prompt.c_str(), static_prompt.length(), static_tokens.data(), static_tokens.size(), false, false);
+    std::string budgeted_static = static_prompt + retrieved_context;
+    int32_t static_token_count = llama_tokenize(vocab, budgeted_static.c_str(), budgeted_static.length(), static_tokens.data(), static_tokens.size(), false, false);
 
     int32_t history_token_budget = n_ctx - static_token_count - response_buffer;
 
@@ -379,18 +474,35 @@ std::string AssemblePrompt(AHandle targetPed, AHandle playerPed, const std::vect
     std::stringstream finalPromptStream;
     finalPromptStream << static_prompt;
 
-    if (!selected_history.empty()) {
+    if (!selected_history.empty() || !retrieved_context.empty()) {
         finalPromptStream << "\nCHAT HISTORY:\n";
-        for (const std::string& line : selected_history) {
+        for (size_t i = 0; i < selected_history.size(); ++i) {
+            const std::string& line = selected_history[i];
+            if (!lastPlayerMsg.empty() && i + 1 == selected_history.size()) {
+                finalPromptStream << retrieved_context;
+            }
             // Wir lassen die History im Wesentlichen wie sie ist, um keine Formatierung zu verlieren
             finalPromptStream << line << "\n";
         }
+        if (lastPlayerMsg.empty() || selected_history.empty()) {
+            finalPromptStream << retrieved_context;
+        }
     }
 
+    if (prefixOnly) return finalPromptStream.str();
+
     finalPromptStream << "\n<|assistant|>\n";
     return finalPromptStream.str();
 }
 
+std::string AssemblePrompt(AHandle targetPed, AHandle playerPed, const std::vector<std::string>& chatHistory) {
+    return BuildPrompt(targetPed, playerPed, chatHistory, false);
+}
+
+std::string AssemblePrefixPrompt(AHandle targetPed, AHandle playerPed, const std::vector<std::string>& chatHistory) {
+    return BuildPrompt(targetPed, playerPed, chatHistory, true);
+}
+
 
 /**
 bool InitializeLLM(const char* model_path) {
@@ -596,6 +708,11 @@ void ShutdownLLM() {
             }
         }
     }
+    ResetPrefixCache();
+    ConversationPrefetch::Shutdown();
+    // Embedding context shares g_model, free it first
+    MemoryStore::Shutdown();
+    SemanticIndex::Shutdown();
     if (g_ctx != nullptr) {
         LogLLM("ShutdownLLM: Freeing context");
         llama_free(g_ctx);
@@ -798,12 +915,134 @@ std::string TokensToString(const std::vector<llama_token>& tokens, llama_context
 }
 
 
-std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
-    // Thread-Safety
+// ------------------------------------------------------------
+// PREFIX CACHE
+// ------------------------------------------------------------
+static int32_t CommonPrefix(const std::vector<llama_token>& a, const std::vector<llama_token>& b) {
+    size_t n = std::min(a.size(), b.size());
+    size_t i = 0;
+    while (i < n && a[i] == b[i]) ++i;
+    return static_cast<int32_t>(i);
+}
+
+static bool TokenizePrompt(const llama_vocab* vocab, const std::string& text, std::vector<llama_token>& out) {
+    out.resize(text.length() + 100);
+    int32_t n = llama_tokenize(vocab, text.c_str(), (int32_t)text.length(), out.data(), out.size(), true, false);
+    if (n <= 0) { out.clear(); return false; }
+    out.resize(n);
+    return true;
+}
+
+// Caller holds g_inference_mutex. Picks up a changed LLM share before the next llama_decode.
+static void ApplyCpuBudgetLocked() {
+    if (!CoreBudget::IsEnabled() || !g_ctx) return;
+    CoreBudget::ApplyToThisThread(CpuStage::LLM);
+    uint32_t epoch = CoreBudget::Epoch();
+    if (epoch == s_threadEpoch && g_ctx == s_threadCtx) return;
+    if (g_ctx != s_threadCtx) {
+        s_ctxThreads = std::max(1, (int)llama_n_threads(g_ctx));
+        s_ctxThreadsBatch = std::max(1, (int)llama_n_threads_batch(g_ctx));
+    }
+    s_threadEpoch = epoch;
+    s_threadCtx = g_ctx;
+    // Share of the CPU budget, the context's own thread count stays the upper limit
+    int n = CoreBudget::Threads(CpuStage::LLM);
+    llama_set_n_threads(g_ctx, std::min(n, s_ctxThreads), std::min(n, s_ctxThreadsBatch));
+}
+
+// Decodes text into SEQ_PREFIX at low priority: the mutex is taken per n_batch chunk and
+// released while GenerateLLMResponse is waiting. Only the part that differs from the
+// current prefix is decoded. Returns false if it was aborted or failed.
+bool PrefillPrefix(std::string text) {
+    if (!g_model || !g_ctx || text.empty()) return false;
+
+    const llama_vocab* vocab = llama_model_get_vocab(g_model);
+    std::vector<llama_token> tokens;
+    if (!TokenizePrompt(vocab, text, tokens)) return false;
+
+    const int32_t n_tokens = (int32_t)tokens.size();
+    const int32_t n_batch = std::max(1, ConfigReader::g_Settings.n_batch);
+    int32_t n_done = 0;
+    uint64_t generation = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(g_inference_mutex);
+        if (!g_ctx) return false;
+        if (n_tokens + ConfigReader::g_Settings.MaxOutputChars >= (int32_t)llama_n_ctx(g_ctx)) {
+            LogLLM("PrefillPrefix: Prompt too long for speculative prefill, skipped.");
+            return false;
+        }
+        llama_memory_t memory = llama_get_memory(g_ctx);
+        // The unified KV cache is shared: the last turn's SEQ_WORK cells would still occupy it
+        // next to the prefix. GenerateLLMResponse clears them first thing anyway.
+        llama_memory_seq_rm(memory, SEQ_WORK, -1, -1);
+        n_done = CommonPrefix(tokens, s_prefixTokens);
+        if (n_done == n_tokens) return true;
+
+        llama_memory_seq_rm(memory, SEQ_PREFIX, n_done, -1);
+        s_prefixTokens.resize(n_done);
+        generation = ++s_prefixGeneration;
+    }
+
+    CoreBudget::Scope cpu(CpuStage::LLM);
+    int32_t n_reused = n_done;
+    while (n_done < n_tokens) {
+        // Foreground inference has priority
+        while (s_foregroundWaiting.load() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        std::lock_guard<std::mutex> lock(g_inference_mutex);
+        if (!g_ctx || s_prefixGeneration != generation) {
+            LogLLM("PrefillPrefix: Aborted (prefix changed).");
+            return false;
+        }
+
+        int32_t n_eval = std::min(n_batch, n_tokens - n_done);
+        llama_batch batch = llama_batch_init(n_eval, 0, 1);
+        batch.n_tokens = n_eval;
+        for (int32_t j = 0; j < n_eval; j++) {
+            batch.token[j] = tokens[n_done + j];
+            batch.pos[j] = n_done + j;
+            batch.n_seq_id[j] = 1;
+            batch.seq_id[j][0] = SEQ_PREFIX;
+            batch.logits[j] = false;
+        }
+        batch.logits[n_eval - 1] = true;
+
+        ApplyCpuBudgetLocked();
+        int32_t rc = llama_decode(g_ctx, batch);
+        llama_batch_free(batch);
+        if (rc != 0) {
+            llama_memory_seq_rm(llama_get_memory(g_ctx), SEQ_PREFIX, n_done, -1);
+            LogLLM("PrefillPrefix: llama_decode failed (" + std::to_string(rc) + ").");
+            return false;
+        }
+
+        s_prefixTokens.insert(s_prefixTokens.end(), tokens.begin() + n_done, tokens.begin() + n_done + n_eval);
+        n_done += n_eval;
+    }
+
+    LogLLM("PrefillPrefix: " + std::to_string(n_tokens) + " tokens ready (" + std::to_string(n_reused) + " reused).");
+    return true;
+}
+
+void ResetPrefixCache() {
     std::lock_guard<std::mutex> lock(g_inference_mutex);
+    s_prefixTokens.clear();
+    ++s_prefixGeneration;
+}
+
+
+std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
+    // Thread-Safety (announce first, so a running PrefillPrefix steps aside)
+    s_foregroundWaiting++;
+    std::unique_lock<std::mutex> lock(g_inference_mutex);
+    s_foregroundWaiting--;
 
     // Validation
     if (!g_model || !g_ctx) return "ERR_NO_CTX";
+    CoreBudget::Scope cpu(CpuStage::LLM);
 
     const llama_vocab* vocab = llama_model_get_vocab(g_model);
 
@@ -838,12 +1077,9 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
     // -----------------------------------------------------------------------
     // 1. TOKENIZATION
     // -----------------------------------------------------------------------
-    // Reserve some space for new tokens
-    std::vector<llama_token> all_tokens(fullPrompt.length() + 100);
-    int32_t n_all_tokens = llama_tokenize(vocab, fullPrompt.c_str(), (int32_t)fullPrompt.length(), all_tokens.data(), all_tokens.size(), true, false);
-
-    if (n_all_tokens <= 0) return "ERROR: TOKENIZATION";
-    all_tokens.resize(n_all_tokens);
+    std::vector<llama_token> all_tokens;
+    if (!TokenizePrompt(vocab, fullPrompt, all_tokens)) return "ERROR: TOKENIZATION";
+    int32_t n_all_tokens = (int32_t)all_tokens.size();
 
     // -----------------------------------------------------------------------
     // 2. KV CACHE RESET (THE CRITICAL FIX)
@@ -851,10 +1087,21 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
     // We clear the memory for sequence 0 completely.
     // This prevents the "inconsistent sequence positions" error by ensuring a fresh start.
     llama_memory_t memory = llama_get_memory(g_ctx);
-    llama_memory_seq_rm(memory, -1, 0, -1);
+    llama_memory_seq_rm(memory, SEQ_WORK, -1, -1);
+
+    // Reuse the common part of the prefix sequence (speculative prefill or last turn).
+    // At least one token is always decoded, the sampler needs its logits.
+    int32_t n_reuse = std::min(CommonPrefix(all_tokens, s_prefixTokens), n_all_tokens - 1);
+    ++s_prefixGeneration; // a running PrefillPrefix must not touch the prefix anymore
+    llama_memory_seq_rm(memory, SEQ_PREFIX, n_reuse, -1);
+    s_prefixTokens.resize(n_reuse);
+    if (n_reuse > 0) {
+        llama_memory_seq_cp(memory, SEQ_PREFIX, SEQ_WORK, 0, n_reuse);
+        LogLLM("GenerateLLMResponse: Reusing " + std::to_string(n_reuse) + "/" + std::to_string(n_all_tokens) + " prompt tokens from prefix cache.");
+    }
 
-    int32_t n_past = 0; // Start fresh at 0
-    int32_t n_new_tokens = n_all_tokens; // Process everything
+    int32_t n_past = n_reuse;
+    int32_t n_new_tokens = n_all_tokens - n_reuse;
 
     // -----------------------------------------------------------------------
     // 3. PREFILL PHASE (Process the Prompt)
@@ -863,6 +1110,7 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
     int32_t n_batch = ConfigReader::g_Settings.n_batch;
 
     for (int32_t i = 0; i < n_new_tokens; i += n_batch) {
+        if (g_llm_cancel.load()) return "";
         int32_t n_eval = n_new_tokens - i;
         if (n_eval > n_batch) n_eval = n_batch;
 
@@ -870,10 +1118,10 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
         batch.n_tokens = n_eval;
 
         for (int32_t j = 0; j < n_eval; j++) {
-            batch.token[j] = all_tokens[i + j];
+            batch.token[j] = all_tokens[n_reuse + i + j];
             batch.pos[j] = n_past + j;
             batch.n_seq_id[j] = 1;
-            batch.seq_id[j][0] = 0; // Sequence 0
+            batch.seq_id[j][0] = SEQ_WORK; // Sequence 0
             batch.logits[j] = false;
         }
 
@@ -882,6 +1130,7 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
             batch.logits[n_eval - 1] = true;
         }
 
+        ApplyCpuBudgetLocked();
         if (llama_decode(g_ctx, batch) != 0) {
             llama_batch_free(batch);
             return "LLM_EVAL_ERROR_PREFILL";
@@ -927,6 +1176,10 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
 
     while (n_decode < max_out) {
         if (slowMode) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (g_llm_cancel.load()) {
+            LogLLM("GenerateLLMResponse: Cancelled.");
+            break;
+        }
 
         // Get Logits
         auto* logits = llama_get_logits_ith(g_ctx, -1); // -1 = Last token in batch
@@ -981,9 +1234,10 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
         batch_gen.token[0] = id;
         batch_gen.pos[0] = n_past; // Continue position
         batch_gen.n_seq_id[0] = 1;
-        batch_gen.seq_id[0][0] = 0;
+        batch_gen.seq_id[0][0] = SEQ_WORK;
         batch_gen.logits[0] = true;
 
+        ApplyCpuBudgetLocked();
         if (llama_decode(g_ctx, batch_gen) != 0) {
             // Context full or error
             break;
@@ -999,6 +1253,13 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
     llama_batch_free(batch_gen);
     if (sampler_chain) llama_sampler_free(sampler_chain);
 
+    // Keep this prompt as prefix for the next turn (history only grows at the end).
+    // Summaries use a different prompt and would just evict the conversation prefix.
+    if (!slowMode) {
+        llama_memory_seq_cp(memory, SEQ_WORK, SEQ_PREFIX, n_reuse, n_all_tokens);
+        s_prefixTokens = all_tokens;
+    }
+
     std::string response_text = TokensToString(generated_tokens, g_ctx);
 
     double duration = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
@@ -1011,27 +1272,69 @@ std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode) {
 
 void audio_capture_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
 {
-    if (g_is_recording && pInput != NULL) {
+    // Real-time thread: wait-free, no allocation (full ring -> samples dropped + counted)
+    if (g_is_recording.load(std::memory_order_acquire) && pInput != NULL) {
         const float* pInputF32 = (const float*)pInput;
-        
-        g_audio_buffer.insert(g_audio_buffer.end(), pInputF32, pInputF32 + frameCount);
+        g_capture_ring.Write(pInputF32, frameCount);
     }
 }
+
+// Recorded samples from absolute index 'from' to now, zero-copy unless the range wraps
+const float* GetRecordedAudio(size_t from, size_t& count, std::vector<float>& scratch) {
+    return g_capture_ring.Span(from, count, scratch);
+}
+
+// Everything before 'upTo' is transcribed, the capture callback may reuse it
+void ReleaseRecordedAudio(size_t upTo) {
+    g_capture_ring.Release(upTo);
+}
+
+// Readers still working on the last recording; the ring is only reset while this is zero
+static std::mutex g_capture_gate_mutex;
+static int g_capture_readers = 0;
+
+CaptureReadLease::CaptureReadLease() : m_held(true) {
+    std::lock_guard<std::mutex> lock(g_capture_gate_mutex);
+    ++g_capture_readers;
+}
+
+CaptureReadLease::~CaptureReadLease() {
+    if (!m_held) return;
+    std::lock_guard<std::mutex> lock(g_capture_gate_mutex);
+    --g_capture_readers;
+}
+
+bool IsCaptureInUse() {
+    std::lock_guard<std::mutex> lock(g_capture_gate_mutex);
+    return g_capture_readers > 0;
+}
 bool InitializeWhisper(const char* model_path) {
     LogA("InitializeWhisper: Attempting to load model at: " + std::string(model_path));
     struct whisper_context_params cparams = whisper_context_default_params();
-    g_whisper_ctx = whisper_init_from_file_with_params(model_path, cparams);
+    // No default state: every transcription leases one from WhisperPool
+    g_whisper_ctx = whisper_init_from_file_with_params_no_state(model_path, cparams);
 
     if (g_whisper_ctx == nullptr) {
         LogA("InitializeWhisper: FAILED to initialize whisper context.");
         return false;
     }
+    if (!WhisperPool::Init(g_whisper_ctx, ConfigReader::g_Settings.STT_STATE_POOL)) {
+        LogA("InitializeWhisper: FAILED to allocate whisper states.");
+        whisper_free(g_whisper_ctx);
+        g_whisper_ctx = nullptr;
+        return false;
+    }
     LogA("InitializeWhisper: Model loaded successfully.");
     return true;
 }
 
 // 2. Initialize Microphone
 bool InitializeAudioCaptureDevice() {
+    // Capture ring is allocated once, the callback never allocates
+    int maxSeconds = std::max(5, ConfigReader::g_Settings.STT_MAX_RECORD_SECONDS);
+    g_capture_ring.Allocate((size_t)maxSeconds * WHISPER_SAMPLE_RATE);
+    LogA("InitializeAudioCaptureDevice: Capture ring " + std::to_string(g_capture_ring.Capacity()) + " samples.");
+
     ma_device_config deviceConfig;
     deviceConfig = ma_device_config_init(ma_device_type_capture);
     deviceConfig.capture.format = ma_format_f32; 
@@ -1051,8 +1354,16 @@ bool InitializeAudioCaptureDevice() {
 // 3. Start Recording
 void StartAudioRecording() {
     LogA("StartAudioRecording: Starting audio stream...");
-    g_audio_buffer.clear();
-    g_is_recording = true;
+    {
+        std::lock_guard<std::mutex> lock(g_capture_gate_mutex);
+        if (g_capture_readers > 0) {
+            // A transcription still reads the last recording straight from the ring
+            LogA("StartAudioRecording: Capture ring still in use, press ignored.");
+            return;
+        }
+        g_capture_ring.Reset(); // device is stopped here, no producer running
+        g_is_recording = true;
+    }
     if (ma_device_start(&g_capture_device) != MA_SUCCESS) {
         LogA("StartAudioRecording: FAILED to start audio device.");
         g_is_recording = false;
@@ -1064,38 +1375,57 @@ void StopAudioRecording() {
     LogA("StopAudioRecording: Stopping audio stream.");
     g_is_recording = false;
     ma_device_stop(&g_capture_device);
-    LogA("StopAudioRecording: Audio buffer size: " + std::to_string(g_audio_buffer.size()));
+    LogA("StopAudioRecording: Audio buffer size: " + std::to_string(g_capture_ring.WritePos() - g_capture_ring.ReadPos()) +
+        " (dropped: " + std::to_string(g_capture_ring.Overflows()) + ")");
 }
 
 // 5. Transcribe (This runs in the async thread)
-std::string TranscribeAudio(std::vector<float> pcm_data) {
-    LogA("TranscribeAudio: Thread started. Processing " + std::to_string(pcm_data.size()) + " audio samples.");
+std::string TranscribeAudio(const float* pcm_data, size_t n_samples) {
+    LogA("TranscribeAudio: Thread started. Processing " + std::to_string(n_samples) + " audio samples.");
     if (g_whisper_ctx == nullptr) {
         LogA("TranscribeAudio: FAILED - Whisper context is null.");
         return "";
     }
-    if (pcm_data.empty()) {
+    // Silence costs Whisper as much as speech -> cut it first
+    std::vector<float> trimmed;
+    if (ConfigReader::g_Settings.STT_VAD && pcm_data != nullptr && n_samples > 0) {
+        VadStats vad;
+        if (!VoiceActivity::Trim(pcm_data, n_samples, trimmed, vad)) {
+            LogA("TranscribeAudio: VAD found no speech, skipped.");
+            return "";
+        }
+        LogA("TranscribeAudio: VAD " + VoiceActivity::Describe(vad));
+        pcm_data = trimmed.data();
+        n_samples = trimmed.size();
+    }
+    if (pcm_data == nullptr || n_samples == 0) {
         LogA("TranscribeAudio: FAILED - Audio buffer is empty.");
         return "";
     }
 
-    whisper_full_params wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
-    wparams.print_progress = false;
-    wparams.print_realtime = false;
-    wparams.print_special = false;
-    wparams.print_timestamps = false;
-    wparams.language = "auto"; // Use "auto" or "de" if you use the multilingual model
-    wparams.n_threads = 4;   // Keep it low to not lag the game
+    // Threads / strategy / language from the settings (STT_THREADS, STT_STRATEGY, STT_LANGUAGE)
+    // Entering the stage first, so FillParams sees the STT share that applies while it runs
+    CoreBudget::Scope cpu(CpuStage::STT);
+    whisper_full_params wparams;
+    std::string language;
+    WhisperPool::FillParams(wparams, language);
 
-    if (whisper_full(g_whisper_ctx, wparams, pcm_data.data(), pcm_data.size()) != 0) {
+    WhisperStateLease state;
+    if (!state) {
+        LogA("TranscribeAudio: FAILED - no whisper state available.");
+        return "";
+    }
+
+    if (whisper_full_with_state(g_whisper_ctx, state.Get(), wparams, pcm_data, (int)n_samples) != 0) {
         LogA("TranscribeAudio: FAILED - whisper_full failed to process audio.");
         return "";
     }
+    if (language == "auto") WhisperPool::RememberLanguage(state.Get());
 
-    int n_segments = whisper_full_n_segments(g_whisper_ctx);
+    int n_segments = whisper_full_n_segments_from_state(state.Get());
     std::string transcribed_text = "";
     for (int i = 0; i < n_segments; ++i) {
-        const char* text = whisper_full_get_segment_text(g_whisper_ctx, i);
+        const char* text = whisper_full_get_segment_text_from_state(state.Get(), i);
         transcribed_text += text;
     }
 
@@ -1104,8 +1434,20 @@ std::string TranscribeAudio(std::vector<float> pcm_data) {
 
 }
 
+// 5b. Transcribe the last recording straight from the capture ring
+std::string TranscribeRecording() {
+    CaptureReadLease lease;
+    std::vector<float> scratch;
+    size_t count = 0;
+    const float* pcm = GetRecordedAudio(0, count, scratch);
+    return TranscribeAudio(pcm, count);
+}
+
 // 6. Shutdown STT
 void ShutdownWhisper() {
+    SttStream::Shutdown();
+    SttTwoPass::Shutdown();
+    WhisperPool::Shutdown();
     if (g_whisper_ctx) {
         whisper_free(g_whisper_ctx);
         g_whisper_ctx = nullptr;
@@ -6,9 +6,11 @@
 #include <vector>
 #include <future>
 #include <chrono>
+#include <atomic>
 #include "AbstractTypes.h"
 #include "ConfigReader.h"
 #include "FileEnums.h"
+#include "AudioRingBuffer.h"
 
 extern std::string LOG_FILE_NAME3;
 
@@ -18,8 +20,13 @@ extern std::future<std::string> g_llm_future;
 extern std::string g_llm_response;
 extern std::chrono::high_resolution_clock::time_point g_response_start_time;
 extern std::chrono::high_resolution_clock::time_point g_llm_start_time;
+extern std::atomic<bool> g_llm_cancel;
+extern const std::vector<std::string> MALE_FIRST_NAMES;
+extern const std::vector<std::string> FEMALE_FIRST_NAMES;
+extern const std::vector<std::string> LAST_NAMES;
 
 struct llama_adapter_lora;
+struct ConversationCache;
 
 
 extern struct llama_adapter_lora* g_lora_adapter;
@@ -29,6 +36,10 @@ bool InitializeLLM(const char* model_path);
 void ShutdownLLM();
 std::string GenerateLLMResponse(std::string fullPrompt, bool slowMode);
 std::string AssemblePrompt(AHandle targetPed, AHandle playerPed, const std::vector<std::string>& chatHistory);
+std::string AssembleSystemPrompt(const ConversationCache& cache, AHandle targetPed, AHandle playerPed);
+std::string AssemblePrefixPrompt(AHandle targetPed, AHandle playerPed, const std::vector<std::string>& chatHistory);
+bool PrefillPrefix(std::string text);
+void ResetPrefixCache();
 std::string CleanupResponse(std::string text);
 std::string PerformChatSummarization(const std::string& npcName, const std::vector<std::string>& history);
 std::string GenerateNpcName(const NpcPersona& persona);
@@ -41,13 +52,29 @@ bool InitializeWhisper(const char* model_path);
 bool InitializeAudioCaptureDevice();
 void StartAudioRecording();
 void StopAudioRecording();
-std::string TranscribeAudio(std::vector<float> pcm_data);
+std::string TranscribeAudio(const float* pcm_data, size_t n_samples);
+std::string TranscribeRecording();
+const float* GetRecordedAudio(size_t from, size_t& count, std::vector<float>& scratch);
+void ReleaseRecordedAudio(size_t upTo);
+// Held by everything reading the capture ring; StartAudioRecording refuses to reset it meanwhile
+class CaptureReadLease {
+public:
+    CaptureReadLease();
+    ~CaptureReadLease();
+    CaptureReadLease(CaptureReadLease&& other) noexcept : m_held(other.m_held) { other.m_held = false; }
+    CaptureReadLease(const CaptureReadLease&) = delete;
+    CaptureReadLease& operator=(const CaptureReadLease&) = delete;
+    CaptureReadLease& operator=(CaptureReadLease&&) = delete;
+private:
+    bool m_held;
+};
+bool IsCaptureInUse();
 void ShutdownWhisper();
 void ShutdownAudioDevice();
 void ShutdownBadassLogging();
-extern bool g_is_recording;
+extern std::atomic<bool> g_is_recording;
 extern std::future<std::string> g_stt_future;
-extern std::vector<float> g_audio_buffer;
+extern AudioRingBuffer<float> g_capture_ring;
 void UpdateTPS(int tokensGenerated, double elapsedSeconds);
 void GetBadassLogging();
 //EOF
\ No newline at end of file
@@ -0,0 +1,445 @@
+#include "MemoryStore.h"
+#include "SemanticIndex.h"
+#include "ConfigReader.h"
+#include "PlatformSystem.h"
+#include "helperfunctions.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// ------------------------------------------------------------
+// STATIC MEMBERS
+// ------------------------------------------------------------
+std::unordered_map<PersistID, MemoryStore::NpcMemory> MemoryStore::s_stores;
+std::shared_mutex MemoryStore::s_storeMutex;
+
+std::thread MemoryStore::s_worker;
+std::mutex MemoryStore::s_queueMutex;
+std::condition_variable MemoryStore::s_queueCv;
+std::deque<PersistID> MemoryStore::s_queue;
+std::atomic<bool> MemoryStore::s_running{ false };
+
+// Below this many embedded facts a linear scan is exact and faster than the graph
+static const size_t BRUTE_FORCE_LIMIT = 128;
+static const int EF_SEARCH = 48;
+static const int ANN_CANDIDATES = 32;
+// Re-ranking weights
+static const float W_SIMILARITY = 0.6f;
+static const float W_RECENCY = 0.2f;
+static const float W_IMPORTANCE = 0.2f;
+static const double RECENCY_HALF_LIFE_MS = 30.0 * 60.0 * 1000.0;
+
+// ------------------------------------------------------------
+// 1. HNSW GRAPH
+// ------------------------------------------------------------
+
+void HnswGraph::Clear() {
+    m_levels.clear();
+    m_links.clear();
+    m_entry = -1;
+    m_maxLevel = -1;
+}
+
+int HnswGraph::RandomLevel() {
+    // xorshift64*, level ~ floor(-ln(U) / ln(M))
+    m_rng ^= m_rng >> 12;
+    m_rng ^= m_rng << 25;
+    m_rng ^= m_rng >> 27;
+    double u = ((m_rng * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+    if (u <= 0.0) u = 1e-12;
+    return (int)std::floor(-std::log(u) / std::log((double)M));
+}
+
+template <class Sim>
+void HnswGraph::SearchLayer(Sim sim, uint32_t entry, int ef, int level, std::vector<std::pair<float, uint32_t>>& out) const {
+    // Epoch tags per thread instead of a set per search. Searches stay const, so several
+    // prompt assemblies can search under the shared store lock at once.
+    thread_local std::vector<uint32_t> visited;
+    thread_local uint32_t epoch = 0;
+    if (visited.size() < m_levels.size()) visited.resize(m_levels.size(), 0);
+    if (++epoch == 0) {
+        std::fill(visited.begin(), visited.end(), 0);
+        epoch = 1;
+    }
+
+    auto byBest = [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first < b.first; };
+    auto byWorst = [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; };
+
+    std::vector<std::pair<float, uint32_t>> candidates;   // max-heap (best on top)
+    out.clear();                                          // min-heap (worst on top)
+
+    float s = sim(entry);
+    candidates.push_back({ s, entry });
+    out.push_back({ s, entry });
+    visited[entry] = epoch;
+
+    while (!candidates.empty()) {
+        std::pop_heap(candidates.begin(), candidates.end(), byBest);
+        auto cur = candidates.back();
+        candidates.pop_back();
+        if ((int)out.size() >= ef && cur.first < out.front().first) break;
+
+        if (level >= (int)m_links[cur.second].size()) continue;
+        for (uint32_t n : m_links[cur.second][level]) {
+            if (visited[n] == epoch) continue;
+            visited[n] = epoch;
+
+            float sn = sim(n);
+            if ((int)out.size() < ef || sn > out.front().first) {
+                candidates.push_back({ sn, n });
+                std::push_heap(candidates.begin(), candidates.end(), byBest);
+                out.push_back({ sn, n });
+                std::push_heap(out.begin(), out.end(), byWorst);
+                if ((int)out.size() > ef) {
+                    std::pop_heap(out.begin(), out.end(), byWorst);
+                    out.pop_back();
+                }
+            }
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+}
+
+template <class NodeSim>
+void HnswGraph::Insert(uint32_t node, NodeSim simNode) {
+    if (node >= m_levels.size()) {
+        m_levels.resize(node + 1, -1);
+        m_links.resize(node + 1);
+    }
+    int level = RandomLevel();
+    m_levels[node] = level;
+    m_links[node].assign(level + 1, std::vector<uint32_t>());
+
+    if (m_entry < 0) {
+        m_entry = (int)node;
+        m_maxLevel = level;
+        return;
+    }
+
+    auto toNode = [&](uint32_t n) { return simNode(node, n); };
+
+    // Greedy descent through the layers above the new node
+    uint32_t cur = (uint32_t)m_entry;
+    float curSim = toNode(cur);
+    for (int l = m_maxLevel; l > level; --l) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            if (l >= (int)m_links[cur].size()) break;
+            for (uint32_t n : m_links[cur][l]) {
+                float s = toNode(n);
+                if (s > curSim) { curSim = s; cur = n; changed = true; }
+            }
+        }
+    }
+
+    std::vector<std::pair<float, uint32_t>> found;
+    for (int l = std::min(level, m_maxLevel); l >= 0; --l) {
+        SearchLayer(toNode, cur, EF_CONSTRUCTION, l, found);
+
+        std::vector<uint32_t>& mine = m_links[node][l];
+        for (size_t i = 0; i < found.size() && (int)mine.size() < M; ++i) {
+            if (found[i].second != node) mine.push_back(found[i].second);
+        }
+
+        // Back links, shrink to the best neighbours when a node overflows
+        const size_t maxLinks = (l == 0) ? (size_t)(2 * M) : (size_t)M;
+        for (uint32_t n : mine) {
+            std::vector<uint32_t>& theirs = m_links[n][l];
+            theirs.push_back(node);
+            if (theirs.size() > maxLinks) {
+                std::vector<std::pair<float, uint32_t>> scored;
+                scored.reserve(theirs.size());
+                for (uint32_t t : theirs) scored.push_back({ simNode(n, t), t });
+                std::partial_sort(scored.begin(), scored.begin() + maxLinks, scored.end(),
+                    [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+                theirs.clear();
+                for (size_t i = 0; i < maxLinks; ++i) theirs.push_back(scored[i].second);
+            }
+        }
+        if (!found.empty()) cur = found[0].second;
+    }
+
+    if (level > m_maxLevel) {
+        m_maxLevel = level;
+        m_entry = (int)node;
+    }
+}
+
+template <class QuerySim>
+std::vector<std::pair<float, uint32_t>> HnswGraph::Search(QuerySim simQuery, int k, int ef) const {
+    std::vector<std::pair<float, uint32_t>> result;
+    if (m_entry < 0) return result;
+
+    uint32_t cur = (uint32_t)m_entry;
+    float curSim = simQuery(cur);
+    for (int l = m_maxLevel; l > 0; --l) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            if (l >= (int)m_links[cur].size()) break;
+            for (uint32_t n : m_links[cur][l]) {
+                float s = simQuery(n);
+                if (s > curSim) { curSim = s; cur = n; changed = true; }
+            }
+        }
+    }
+    SearchLayer(simQuery, cur, std::max(ef, k), 0, result);
+    if ((int)result.size() > k) result.resize(k);
+    return result;
+}
+
+// ------------------------------------------------------------
+// 2. EMBEDDING WORKER
+// ------------------------------------------------------------
+// Facts are stored immediately and embedded off the game thread.
+
+void MemoryStore::EnsureWorker() {
+    bool expected = false;
+    if (s_running.compare_exchange_strong(expected, true)) {
+        if (s_worker.joinable()) s_worker.join();
+        s_worker = std::thread(WorkerLoop);
+    }
+}
+
+void MemoryStore::Enqueue(PersistID id) {
+    EnsureWorker();
+    {
+        std::lock_guard<std::mutex> lock(s_queueMutex);
+        if (std::find(s_queue.begin(), s_queue.end(), id) == s_queue.end()) s_queue.push_back(id);
+    }
+    s_queueCv.notify_one();
+}
+
+void MemoryStore::WorkerLoop() {
+    while (s_running) {
+        PersistID id = 0;
+        {
+            std::unique_lock<std::mutex> lock(s_queueMutex);
+            s_queueCv.wait(lock, [] { return !s_queue.empty() || !s_running; });
+            if (!s_running) break;
+            id = s_queue.front();
+            s_queue.pop_front();
+        }
+        if (!SemanticIndex::HasEmbedder()) continue; // facts stay text-only, ranked by recency/importance
+
+        // Snapshot pending texts, embed without holding the store lock
+        std::vector<std::pair<uint32_t, std::string>> pending;
+        uint32_t generation = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(s_storeMutex);
+            auto it = s_stores.find(id);
+            if (it == s_stores.end()) continue;
+            generation = it->second.generation;
+            for (size_t i = 0; i < it->second.facts.size(); ++i) {
+                if (!it->second.facts[i].embedded) pending.push_back({ (uint32_t)i, it->second.facts[i].text });
+            }
+        }
+
+        const int dim = SemanticIndex::Dim();
+        std::vector<std::pair<uint32_t, std::vector<float>>> done;
+        for (auto& p : pending) {
+            std::vector<float> vec;
+            if (SemanticIndex::Embed(p.second, vec)) done.push_back({ p.first, std::move(vec) });
+        }
+
+        std::unique_lock<std::shared_mutex> lock(s_storeMutex);
+        auto it = s_stores.find(id);
+        if (it == s_stores.end() || it->second.generation != generation) continue;
+        NpcMemory& mem = it->second;
+        mem.vectors.resize(mem.facts.size() * (size_t)dim, 0);
+        mem.scales.resize(mem.facts.size(), 0.0f);
+
+        for (auto& d : done) {
+            uint32_t row = d.first;
+            mem.scales[row] = SemanticIndex::QuantizeI8(d.second.data(), &mem.vectors[(size_t)row * dim], dim);
+            mem.facts[row].embedded = true;
+            mem.index.Insert(row, [&mem, dim](uint32_t a, uint32_t b) {
+                return SemanticIndex::DotI8(&mem.vectors[(size_t)a * dim], &mem.vectors[(size_t)b * dim], dim) * mem.scales[a] * mem.scales[b];
+                });
+        }
+    }
+}
+
+void MemoryStore::Shutdown() {
+    s_running = false;
+    s_queueCv.notify_all();
+    if (s_worker.joinable()) s_worker.join();
+    std::lock_guard<std::mutex> lock(s_queueMutex);
+    s_queue.clear();
+}
+
+// ------------------------------------------------------------
+// 3. STORE API
+// ------------------------------------------------------------
+
+void MemoryStore::RebuildIndexLocked(NpcMemory& mem) {
+    mem.index.Clear();
+    const int dim = SemanticIndex::Dim();
+    for (uint32_t row = 0; row < mem.facts.size(); ++row) {
+        if (!mem.facts[row].embedded) continue;
+        mem.index.Insert(row, [&mem, dim](uint32_t a, uint32_t b) {
+            return SemanticIndex::DotI8(&mem.vectors[(size_t)a * dim], &mem.vectors[(size_t)b * dim], dim) * mem.scales[a] * mem.scales[b];
+            });
+    }
+}
+
+// Drops the least valuable 10% once MEMORY_MAX_FACTS is exceeded
+void MemoryStore::PruneLocked(NpcMemory& mem) {
+    const size_t maxFacts = (size_t)std::max(16, ConfigReader::g_Settings.MEMORY_MAX_FACTS);
+    if (mem.facts.size() <= maxFacts) return;
+
+    const uint64_t now = AOS::GetTimeMs();
+    const int dim = SemanticIndex::Dim();
+    std::vector<std::pair<float, uint32_t>> value;
+    for (uint32_t i = 0; i < mem.facts.size(); ++i) {
+        double age = (double)(now - mem.facts[i].timestampMs);
+        float recency = (float)std::exp(-age / RECENCY_HALF_LIFE_MS);
+        value.push_back({ mem.facts[i].importance + 0.5f * recency, i });
+    }
+    std::sort(value.begin(), value.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+    value.resize(maxFacts - maxFacts / 10);
+    std::sort(value.begin(), value.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.second < b.second; });
+
+    NpcMemory kept;
+    kept.generation = mem.generation + 1;
+    for (auto& v : value) {
+        kept.facts.push_back(mem.facts[v.second]);
+        if (dim > 0 && v.second < mem.scales.size()) {
+            kept.scales.push_back(mem.scales[v.second]);
+            kept.vectors.insert(kept.vectors.end(), mem.vectors.begin() + (size_t)v.second * dim, mem.vectors.begin() + (size_t)(v.second + 1) * dim);
+        }
+    }
+    mem = std::move(kept);
+    mem.vectors.resize(mem.facts.size() * (size_t)dim, 0);
+    mem.scales.resize(mem.facts.size(), 0.0f);
+    for (size_t i = 0; i < mem.facts.size(); ++i) {
+        if (mem.scales[i] <= 0.0f) mem.facts[i].embedded = false;
+    }
+    RebuildIndexLocked(mem);
+}
+
+void MemoryStore::AddFact(PersistID id, const std::string& text, float importance) {
+    if (id == 0 || text.empty()) return;
+    {
+        std::unique_lock<std::shared_mutex> lock(s_storeMutex);
+        NpcMemory& mem = s_stores[id];
+        MemoryFact fact;
+        fact.text = text;
+        fact.timestampMs = AOS::GetTimeMs();
+        fact.importance = std::max(0.0f, std::min(1.0f, importance));
+        mem.facts.push_back(fact);
+        PruneLocked(mem);
+    }
+    Enqueue(id);
+}
+
+void MemoryStore::ReplaceFacts(PersistID id, const std::string& knowledge, float importance) {
+    if (id == 0) return;
+    {
+        std::unique_lock<std::shared_mutex> lock(s_storeMutex);
+        NpcMemory& mem = s_stores[id];
+        uint32_t generation = mem.generation + 1;
+        mem = NpcMemory();
+        mem.generation = generation;
+
+        std::istringstream ss(knowledge);
+        std::string line;
+        const uint64_t now = AOS::GetTimeMs();
+        while (std::getline(ss, line)) {
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            size_t end = line.find_last_not_of(" \t\r");
+            if (end == std::string::npos) continue;
+            line.erase(end + 1);
+            MemoryFact fact;
+            fact.text = line;
+            fact.timestampMs = now;
+            fact.importance = importance;
+            mem.facts.push_back(fact);
+        }
+        PruneLocked(mem);
+    }
+    Enqueue(id);
+}
+
+void MemoryStore::Erase(PersistID id) {
+    std::unique_lock<std::shared_mutex> lock(s_storeMutex);
+    s_stores.erase(id);
+}
+
+size_t MemoryStore::FactCount(PersistID id) {
+    std::shared_lock<std::shared_mutex> lock(s_storeMutex);
+    auto it = s_stores.find(id);
+    return (it != s_stores.end()) ? it->second.facts.size() : 0;
+}
+
+// ------------------------------------------------------------
+// 4. RETRIEVAL
+// ------------------------------------------------------------
+
+std::vector<std::string> MemoryStore::Retrieve(PersistID id, const std::vector<float>& queryVec, int tokenBudget) {
+    std::vector<std::string> result;
+    std::shared_lock<std::shared_mutex> lock(s_storeMutex);
+    auto it = s_stores.find(id);
+    if (it == s_stores.end() || it->second.facts.empty()) return result;
+    const NpcMemory& mem = it->second;
+
+    const int dim = SemanticIndex::Dim();
+    const bool haveQuery = dim > 0 && (int)queryVec.size() == dim;
+    const uint64_t now = AOS::GetTimeMs();
+
+    // 1. Similarity per candidate (ANN for large stores, exact scan for small ones)
+    // Cosine can be negative, so candidates are flagged separately
+    std::vector<float> sim(mem.facts.size(), 0.0f);
+    std::vector<uint8_t> isCandidate(mem.facts.size(), 0);
+    if (haveQuery) {
+        std::vector<int8_t> q(dim);
+        float qScale = SemanticIndex::QuantizeI8(queryVec.data(), q.data(), dim);
+        auto simQuery = [&](uint32_t n) {
+            return SemanticIndex::DotI8(q.data(), &mem.vectors[(size_t)n * dim], dim) * qScale * mem.scales[n];
+        };
+
+        if (mem.index.Size() > BRUTE_FORCE_LIMIT) {
+            for (auto& hit : mem.index.Search(simQuery, ANN_CANDIDATES, EF_SEARCH)) {
+                sim[hit.second] = hit.first;
+                isCandidate[hit.second] = 1;
+            }
+        }
+        else {
+            for (uint32_t i = 0; i < mem.facts.size(); ++i) {
+                if (!mem.facts[i].embedded) continue;
+                sim[i] = simQuery(i);
+                isCandidate[i] = 1;
+            }
+        }
+    }
+
+    // 2. Re-rank: similarity + recency + importance
+    std::vector<std::pair<float, uint32_t>> ranked;
+    for (uint32_t i = 0; i < mem.facts.size(); ++i) {
+        const MemoryFact& f = mem.facts[i];
+        float s = 0.0f;
+        if (haveQuery) {
+            if (f.embedded && !isCandidate[i]) continue;   // not among the ANN candidates
+            s = f.embedded ? sim[i] : 0.3f;                 // still waiting for its embedding
+        }
+        double age = (double)(now - f.timestampMs);
+        float recency = (float)std::exp(-age / RECENCY_HALF_LIFE_MS);
+        float score = (haveQuery ? W_SIMILARITY * s : 0.0f) + W_RECENCY * recency + W_IMPORTANCE * f.importance;
+        ranked.push_back({ score, i });
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+
+    // 3. Fill the token budget (~4 chars per token)
+    int used = 0;
+    for (auto& r : ranked) {
+        const std::string& text = mem.facts[r.second].text;
+        int cost = (int)(text.size() + 3) / 4 + 2;
+        if (used + cost > tokenBudget) continue;
+        result.push_back(text);
+        used += cost;
+    }
+    return result;
+}
+
+//EOF
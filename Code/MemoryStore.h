@@ -0,0 +1,94 @@
+#pragma once
+#include "AbstractTypes.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <cstdint>
+
+// MemoryStore.h
+// Long-term memory per PersistID. Every fact is its own record (text, int8 embedding,
+// timestamp, importance) and embedded facts are linked into a small HNSW graph per NPC,
+// so retrieval stays cheap no matter how long the NPC has been talked to.
+// AssemblePrompt only receives the best facts that fit MEMORY_TOKEN_BUDGET.
+
+struct MemoryFact {
+    std::string text;
+    uint64_t timestampMs = 0;
+    float importance = 0.5f;
+    bool embedded = false;
+};
+
+// Hierarchical navigable small world graph over the fact rows of one NPC
+class HnswGraph {
+public:
+    static const int M = 16;
+    static const int EF_CONSTRUCTION = 64;
+
+    void Clear();
+    size_t Size() const { return m_levels.size(); }
+
+    // simNode(a, b) -> similarity between two stored nodes
+    template <class NodeSim>
+    void Insert(uint32_t node, NodeSim simNode);
+
+    // simQuery(n) -> similarity between query and node n
+    template <class QuerySim>
+    std::vector<std::pair<float, uint32_t>> Search(QuerySim simQuery, int k, int ef) const;
+
+private:
+    template <class Sim>
+    void SearchLayer(Sim sim, uint32_t entry, int ef, int level, std::vector<std::pair<float, uint32_t>>& out) const;
+    int RandomLevel();
+
+    std::vector<int> m_levels;                                 // top level per node
+    std::vector<std::vector<std::vector<uint32_t>>> m_links;   // [node][level] -> neighbours
+    int m_entry = -1;
+    int m_maxLevel = -1;
+    uint64_t m_rng = 0x2545F4914F6CDD1DULL;
+};
+
+class MemoryStore {
+public:
+    static void AddFact(PersistID id, const std::string& text, float importance = 0.5f);
+    // Replaces all facts of this NPC (SetCustomKnowledge). One fact per line.
+    static void ReplaceFacts(PersistID id, const std::string& knowledge, float importance = 0.7f);
+    static void Erase(PersistID id);
+    static size_t FactCount(PersistID id);
+
+    // queryVec may be empty (no embedder / no player line) -> recency + importance only
+    static std::vector<std::string> Retrieve(PersistID id, const std::vector<float>& queryVec, int tokenBudget);
+
+    static void Shutdown();
+
+private:
+    struct NpcMemory {
+        std::vector<MemoryFact> facts;
+        std::vector<int8_t> vectors;   // facts.size() * dim
+        std::vector<float> scales;     // 0 = not embedded yet
+        HnswGraph index;
+        uint32_t generation = 0;
+    };
+
+    static void EnsureWorker();
+    static void WorkerLoop();
+    static void Enqueue(PersistID id);
+    static void PruneLocked(NpcMemory& mem);
+    static void RebuildIndexLocked(NpcMemory& mem);
+
+    static std::unordered_map<PersistID, NpcMemory> s_stores;
+    static std::shared_mutex s_storeMutex;
+
+    static std::thread s_worker;
+    static std::mutex s_queueMutex;
+    static std::condition_variable s_queueCv;
+    static std::deque<PersistID> s_queue;
+    static std::atomic<bool> s_running;
+};
+
+//EOF
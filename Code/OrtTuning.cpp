@@ -0,0 +1,30 @@
+#include "OrtTuning.h"
+#include "main.h"
+#include <onnxruntime_cxx_api.h>
+
+std::unique_ptr<Ort::Env> OrtTuning::s_env;
+std::once_flag OrtTuning::s_initOnce;
+
+// Defined in AudioSystem.cpp
+void ORT_API_CALL OnnxLogCallback(void* param, OrtLoggingLevel severity, const char* category,
+    const char* logid, const char* code_location, const char* message);
+
+// ------------------------------------------------------------
+// 1. ENVIRONMENT
+// ------------------------------------------------------------
+// ORT keeps one OrtEnv per process, the first one created wins. Creating it here before
+// babylon builds its sessions gives them our logger.
+void OrtTuning::Init() {
+    std::call_once(s_initOnce, [] {
+        try {
+            s_env = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "EC", OnnxLogCallback, nullptr);
+            Log("OrtTuning: ORT " + std::string(Ort::GetVersionString()));
+        }
+        catch (const std::exception& e) {
+            Log("OrtTuning: [ERROR] Env: " + std::string(e.what()));
+            s_env.reset();
+        }
+    });
+}
+
+//EOF
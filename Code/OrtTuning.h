@@ -0,0 +1,22 @@
+#pragma once
+#include <memory>
+#include <mutex>
+
+// OrtTuning.h
+// ONNX Runtime setup for the VITS voices and the DeepPhonemizer G2P. Init creates the process
+// wide Ort::Env before any babylon session exists, so ORT logging goes into our log.
+// babylon builds its sessions from a path with its own SessionOptions, so thread counts,
+// execution mode and graph optimization cannot be set from this tree.
+
+namespace Ort { struct Env; }
+
+class OrtTuning {
+public:
+    static void Init();
+
+private:
+    static std::unique_ptr<Ort::Env> s_env;
+    static std::once_flag s_initOnce;
+};
+
+//EOF
@@ -0,0 +1,350 @@
+#include "PcmCache.h"
+#include "main.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+std::unordered_map<uint64_t, PcmCache::Entry> PcmCache::s_entries;
+std::list<uint64_t> PcmCache::s_lru;
+std::mutex PcmCache::s_mutex;
+size_t PcmCache::s_budget = 0;
+size_t PcmCache::s_used = 0;
+size_t PcmCache::s_maxChars = 160;
+PcmCodec PcmCache::s_codec = PcmCodec::DELTA;
+bool PcmCache::s_useDisk = false;
+std::string PcmCache::s_folder;
+std::mutex PcmCache::s_diskMutex;
+size_t PcmCache::s_diskUsed = 0;
+std::atomic<uint64_t> PcmCache::s_hits(0);
+std::atomic<uint64_t> PcmCache::s_diskHits(0);
+std::atomic<uint64_t> PcmCache::s_misses(0);
+
+static const char DISK_MAGIC[6] = { 'E', 'C', 'P', 'C', 'M', '1' };
+// Disk tier is capped at 4x the RAM budget, eviction trims down to 3x so it does not
+// rescan the folder on every write once the cap is reached
+static const size_t DISK_BUDGET_FACTOR = 4;
+static const size_t DISK_TRIM_FACTOR = 3;
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE
+// ------------------------------------------------------------
+void PcmCache::Init(const std::string& diskFolder, size_t ramBudgetBytes, PcmCodec codec, bool useDisk, size_t maxChars) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_entries.clear();
+    s_lru.clear();
+    s_used = 0;
+    s_budget = ramBudgetBytes;
+    s_codec = codec;
+    s_maxChars = maxChars;
+    s_folder = diskFolder;
+    s_useDisk = useDisk && ramBudgetBytes > 0 && !diskFolder.empty();
+
+    if (s_budget == 0) {
+        Log("PcmCache: disabled (TTS_AUDIO_CACHE_MB = 0)");
+        return;
+    }
+
+    if (s_useDisk) {
+        std::error_code ec;
+        fs::create_directories(s_folder, ec);
+
+        std::lock_guard<std::mutex> diskLock(s_diskMutex);
+        TrimDiskLocked(s_budget * DISK_BUDGET_FACTOR);
+    }
+
+    Log("PcmCache: " + std::to_string(s_budget / (1024 * 1024)) + " MB, codec " + std::to_string((int)s_codec) +
+        (s_useDisk ? ", disk tier " + s_folder : ", RAM only"));
+}
+
+void PcmCache::Shutdown() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_budget > 0) {
+        Log("PcmCache: " + std::to_string(s_hits.load()) + " hits (" + std::to_string(s_diskHits.load()) + " from disk), " +
+            std::to_string(s_misses.load()) + " misses, " + std::to_string(s_used / 1024) + " KB in RAM");
+    }
+    s_entries.clear();
+    s_lru.clear();
+    s_used = 0;
+    s_budget = 0;
+}
+
+// ------------------------------------------------------------
+// 2. LOOKUP / STORE
+// ------------------------------------------------------------
+bool PcmCache::Find(const PcmKey& key, std::vector<int16_t>& out, bool countMiss) {
+    if (!IsEnabled()) return false;
+    std::string id = MakeId(key);
+    if (id.empty()) return false;
+    uint64_t hash = Hash(id);
+
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        auto it = s_entries.find(hash);
+        if (it != s_entries.end() && it->second.id == id) {
+            s_lru.splice(s_lru.begin(), s_lru, it->second.lru);
+            if (Decode(it->second, out)) { s_hits++; return true; }
+        }
+    }
+
+    // File I/O without the lock, other voices keep hitting the RAM tier meanwhile
+    Entry e;
+    if (s_useDisk && ReadDisk(hash, id, e) && Decode(e, out)) {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        InsertLocked(hash, std::move(e));
+        s_hits++;
+        s_diskHits++;
+        return true;
+    }
+    if (countMiss) s_misses++;
+    return false;
+}
+
+void PcmCache::Store(const PcmKey& key, const std::vector<int16_t>& pcm) {
+    if (!IsEnabled() || pcm.empty()) return;
+    std::string id = MakeId(key);
+    if (id.empty()) return;
+    uint64_t hash = Hash(id);
+
+    Entry e;
+    e.id = id;
+    e.codec = s_codec;
+    e.samples = (uint32_t)pcm.size();
+    Encode(pcm, s_codec, e.data);
+    if (e.data.size() > s_budget / 4) return;   // one line must not flush the whole cache
+
+    if (s_useDisk) WriteDisk(hash, e);
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    InsertLocked(hash, std::move(e));
+}
+
+void PcmCache::InsertLocked(uint64_t hash, Entry&& e) {
+    auto it = s_entries.find(hash);
+    if (it != s_entries.end()) {
+        s_used -= it->second.data.size();
+        s_lru.erase(it->second.lru);
+        s_entries.erase(it);
+    }
+    s_used += e.data.size();
+    s_lru.push_front(hash);
+    e.lru = s_lru.begin();
+    s_entries.emplace(hash, std::move(e));
+
+    while (s_used > s_budget && !s_lru.empty()) {
+        auto victim = s_entries.find(s_lru.back());
+        s_used -= victim->second.data.size();
+        s_entries.erase(victim);
+        s_lru.pop_back();
+    }
+}
+
+// ------------------------------------------------------------
+// 3. KEYS
+// ------------------------------------------------------------
+std::string PcmCache::NormalizeText(const std::string& text) {
+    std::string out;
+    bool space = false;
+    for (unsigned char c : text) {
+        if (std::isspace(c)) { space = !out.empty(); continue; }
+        if (space) out += ' ';
+        space = false;
+        out += (char)std::tolower(c);
+    }
+    return out;
+}
+
+// Empty id = line is not cacheable (too long for a repeated line)
+std::string PcmCache::MakeId(const PcmKey& key) {
+    std::string text = NormalizeText(key.text);
+    if (text.empty() || key.model.empty() || text.size() > s_maxChars) return "";
+
+    char params[96];
+    snprintf(params, sizeof(params), "%d|%.3f|%.3f|%.3f|", key.speaker, key.speed, key.noise, key.noise_w);
+    return key.model + "|" + params + text;
+}
+
+uint64_t PcmCache::Hash(const std::string& id) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : id) { h ^= c; h *= 1099511628211ULL; }
+    return h;
+}
+
+// ------------------------------------------------------------
+// 4. CODECS
+// ------------------------------------------------------------
+static const int ADPCM_STEPS[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const int ADPCM_INDEX[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// Shared by encoder and decoder so both track the same predictor
+static int16_t AdpcmStep(uint8_t nibble, int& predictor, int& index) {
+    int step = ADPCM_STEPS[index];
+    int diff = step >> 3;
+    if (nibble & 4) diff += step;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 1) diff += step >> 2;
+    predictor += (nibble & 8) ? -diff : diff;
+    predictor = std::clamp(predictor, -32768, 32767);
+    index = std::clamp(index + ADPCM_INDEX[nibble], 0, 88);
+    return (int16_t)predictor;
+}
+
+void PcmCache::Encode(const std::vector<int16_t>& pcm, PcmCodec codec, std::vector<uint8_t>& out) {
+    out.clear();
+    if (codec == PcmCodec::RAW) {
+        out.resize(pcm.size() * sizeof(int16_t));
+        memcpy(out.data(), pcm.data(), out.size());
+    }
+    else if (codec == PcmCodec::DELTA) {
+        // zigzag delta + LEB128, speech mostly needs 1-2 bytes per sample
+        out.reserve(pcm.size() * 2);
+        int prev = 0;
+        for (int16_t s : pcm) {
+            int d = (int)s - prev;
+            prev = s;
+            uint32_t z = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+            while (z >= 0x80) { out.push_back((uint8_t)(z | 0x80)); z >>= 7; }
+            out.push_back((uint8_t)z);
+        }
+    }
+    else {
+        out.reserve(pcm.size() / 2 + 1);
+        int predictor = 0, index = 0;
+        for (size_t i = 0; i < pcm.size(); ++i) {
+            int diff = pcm[i] - predictor;
+            uint8_t nibble = 0;
+            if (diff < 0) { nibble = 8; diff = -diff; }
+            int step = ADPCM_STEPS[index];
+            if (diff >= step) { nibble |= 4; diff -= step; }
+            step >>= 1;
+            if (diff >= step) { nibble |= 2; diff -= step; }
+            step >>= 1;
+            if (diff >= step) nibble |= 1;
+            AdpcmStep(nibble, predictor, index);
+
+            if (i & 1) out.back() |= (uint8_t)(nibble << 4);
+            else out.push_back(nibble);
+        }
+    }
+}
+
+bool PcmCache::Decode(const Entry& e, std::vector<int16_t>& out) {
+    out.resize(e.samples);
+    if (e.codec == PcmCodec::RAW) {
+        if (e.data.size() != (size_t)e.samples * sizeof(int16_t)) return false;
+        memcpy(out.data(), e.data.data(), e.data.size());
+        return true;
+    }
+    if (e.codec == PcmCodec::DELTA) {
+        size_t pos = 0;
+        int prev = 0;
+        for (uint32_t i = 0; i < e.samples; ++i) {
+            uint32_t z = 0;
+            int shift = 0;
+            while (true) {
+                if (pos >= e.data.size() || shift > 28) return false;
+                uint8_t b = e.data[pos++];
+                z |= (uint32_t)(b & 0x7F) << shift;
+                if (!(b & 0x80)) break;
+                shift += 7;
+            }
+            int d = (int)(z >> 1) ^ -(int)(z & 1);
+            prev += d;
+            out[i] = (int16_t)prev;
+        }
+        return true;
+    }
+    if (e.data.size() < ((size_t)e.samples + 1) / 2) return false;
+    int predictor = 0, index = 0;
+    for (uint32_t i = 0; i < e.samples; ++i) {
+        uint8_t nibble = (i & 1) ? (e.data[i / 2] >> 4) : (e.data[i / 2] & 0x0F);
+        out[i] = AdpcmStep(nibble, predictor, index);
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// 5. DISK TIER
+// ------------------------------------------------------------
+std::string PcmCache::DiskPath(uint64_t hash) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.pcm", (unsigned long long)hash);
+    return (fs::path(s_folder) / name).string();
+}
+
+bool PcmCache::ReadDisk(uint64_t hash, const std::string& id, Entry& e) {
+    std::ifstream f(DiskPath(hash), std::ios::binary);
+    if (!f.is_open()) return false;
+
+    char magic[6];
+    uint32_t idLen = 0, dataLen = 0;
+    uint8_t codec = 0;
+    if (!f.read(magic, 6) || memcmp(magic, DISK_MAGIC, 6) != 0) return false;
+    if (!f.read((char*)&idLen, 4) || idLen != id.size()) return false;
+    e.id.resize(idLen);
+    if (!f.read(&e.id[0], idLen) || e.id != id) return false;
+    if (!f.read((char*)&codec, 1) || codec > (uint8_t)PcmCodec::ADPCM) return false;
+    if (!f.read((char*)&e.samples, 4) || !f.read((char*)&dataLen, 4)) return false;
+    if (dataLen > s_budget) return false;
+    e.codec = (PcmCodec)codec;
+    e.data.resize(dataLen);
+    return (bool)f.read((char*)e.data.data(), dataLen);
+}
+
+void PcmCache::WriteDisk(uint64_t hash, const Entry& e) {
+    std::string path = DiskPath(hash);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) return;
+        uint32_t idLen = (uint32_t)e.id.size();
+        uint32_t dataLen = (uint32_t)e.data.size();
+        uint8_t codec = (uint8_t)e.codec;
+        f.write(DISK_MAGIC, 6);
+        f.write((const char*)&idLen, 4);
+        f.write(e.id.data(), idLen);
+        f.write((const char*)&codec, 1);
+        f.write((const char*)&e.samples, 4);
+        f.write((const char*)&dataLen, 4);
+        f.write((const char*)e.data.data(), dataLen);
+    }
+    std::error_code ec;
+    size_t replaced = fs::exists(path, ec) ? (size_t)fs::file_size(path, ec) : 0;
+    fs::rename(tmp, path, ec);
+    if (ec) return;
+
+    std::lock_guard<std::mutex> lock(s_diskMutex);
+    s_diskUsed += (size_t)fs::file_size(path, ec);
+    s_diskUsed -= std::min(replaced, s_diskUsed);
+    if (s_diskUsed > s_budget * DISK_BUDGET_FACTOR) TrimDiskLocked(s_budget * DISK_TRIM_FACTOR);
+}
+
+// Oldest files go first. Recounts the folder, so s_diskUsed cannot drift for long.
+void PcmCache::TrimDiskLocked(size_t target) {
+    std::error_code ec;
+    std::vector<std::pair<fs::file_time_type, fs::path>> files;
+    size_t total = 0;
+    for (const auto& f : fs::directory_iterator(s_folder, ec)) {
+        if (f.path().extension() != ".pcm") continue;
+        total += (size_t)f.file_size(ec);
+        files.emplace_back(f.last_write_time(ec), f.path());
+    }
+    std::sort(files.begin(), files.end());
+    for (size_t i = 0; i < files.size() && total > target; ++i) {
+        size_t size = (size_t)fs::file_size(files[i].second, ec);
+        if (fs::remove(files[i].second, ec)) total -= std::min(size, total);
+    }
+    s_diskUsed = total;
+}
+
+//EOF
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// PcmCache.h
+// Cache for synthesized lines ("I can't talk right now.", greetings, system lines).
+// Keyed by voice model, speaker id, speed, noise params and the normalized text.
+// RAM tier is an LRU bounded by TTS_AUDIO_CACHE_MB, entries are optionally compressed
+// (lossless delta coding or IMA ADPCM). An optional disk tier keeps lines between sessions.
+
+struct PcmKey {
+    std::string model;
+    int speaker = 0;
+    float speed = 1.0f;
+    float noise = 0.667f;
+    float noise_w = 0.8f;
+    std::string text;
+};
+
+enum class PcmCodec : uint8_t { RAW = 0, DELTA = 1, ADPCM = 2 };
+
+class PcmCache {
+public:
+    static void Init(const std::string& diskFolder, size_t ramBudgetBytes, PcmCodec codec, bool useDisk, size_t maxChars);
+    static void Shutdown();
+    static bool IsEnabled() { return s_budget > 0; }
+
+    // countMiss = false for pre-checks that are followed by a real lookup
+    static bool Find(const PcmKey& key, std::vector<int16_t>& out, bool countMiss = true);
+    static void Store(const PcmKey& key, const std::vector<int16_t>& pcm);
+
+private:
+    struct Entry {
+        std::string id;                 // full key, guards against hash collisions
+        PcmCodec codec = PcmCodec::RAW;
+        uint32_t samples = 0;
+        std::vector<uint8_t> data;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    static std::string NormalizeText(const std::string& text);
+    static std::string MakeId(const PcmKey& key);
+    static uint64_t Hash(const std::string& id);
+
+    static void Encode(const std::vector<int16_t>& pcm, PcmCodec codec, std::vector<uint8_t>& out);
+    static bool Decode(const Entry& e, std::vector<int16_t>& out);
+
+    static void InsertLocked(uint64_t hash, Entry&& e);
+    static std::string DiskPath(uint64_t hash);
+    static bool ReadDisk(uint64_t hash, const std::string& id, Entry& e);
+    static void WriteDisk(uint64_t hash, const Entry& e);
+    static void TrimDiskLocked(size_t target);
+
+    static std::unordered_map<uint64_t, Entry> s_entries;
+    static std::list<uint64_t> s_lru;
+    static std::mutex s_mutex;
+    static size_t s_budget;
+    static size_t s_used;
+    static size_t s_maxChars;
+    static PcmCodec s_codec;
+    static bool s_useDisk;
+    static std::string s_folder;
+    static std::mutex s_diskMutex;      // disk accounting + eviction, never held with s_mutex
+    static size_t s_diskUsed;
+    static std::atomic<uint64_t> s_hits;
+    static std::atomic<uint64_t> s_diskHits;
+    static std::atomic<uint64_t> s_misses;
+};
+
+//EOF
@@ -0,0 +1,52 @@
+#include "PersonaTable.h"
+
+// Room for models that are not in the personas INI (cached on their first GetPersona)
+static const size_t UNKNOWN_MODEL_HEADROOM = 512;
+
+// ------------------------------------------------------------
+// 1. CONSTRUCTION
+// ------------------------------------------------------------
+PersonaTable::PersonaTable(size_t expected) {
+    size_t wanted = expected + UNKNOWN_MODEL_HEADROOM;
+    uint32_t slots = 16;
+    while (slots < wanted * 2) slots <<= 1;
+    m_slots.reset(new std::atomic<const Entry*>[slots]);
+    for (uint32_t i = 0; i < slots; ++i) m_slots[i].store(nullptr, std::memory_order_relaxed);
+    m_mask = slots - 1;
+    m_maxCount = slots / 4 * 3;
+}
+
+PersonaTable::~PersonaTable() {
+    for (uint32_t i = 0; i <= m_mask; ++i) delete m_slots[i].load(std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------
+// 2. LOOKUP / INSERT
+// ------------------------------------------------------------
+PersonaRef PersonaTable::Find(uint32_t modelHash) const {
+    for (uint32_t i = SlotOf(modelHash), probes = 0; probes <= m_mask; i = (i + 1) & m_mask, ++probes) {
+        const Entry* e = m_slots[i].load(std::memory_order_acquire);
+        if (!e) return nullptr;
+        if (e->modelHash == modelHash) return e->persona;
+    }
+    return nullptr;
+}
+
+PersonaRef PersonaTable::Insert(PersonaRef persona) {
+    if (!persona) return persona;
+    std::lock_guard<std::mutex> lock(m_insertMutex);
+    const uint32_t modelHash = persona->modelHash;
+    uint32_t i = SlotOf(modelHash);
+    for (uint32_t probes = 0; probes <= m_mask; i = (i + 1) & m_mask, ++probes) {
+        const Entry* e = m_slots[i].load(std::memory_order_relaxed);
+        if (!e) break;
+        if (e->modelHash == modelHash) return e->persona;
+    }
+    if (m_count.load(std::memory_order_relaxed) >= m_maxCount) return persona;
+
+    m_slots[i].store(new Entry{ modelHash, persona }, std::memory_order_release);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    return persona;
+}
+
+//EOF
@@ -0,0 +1,42 @@
+#pragma once
+#include "ConfigReader.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+// PersonaTable.h
+// Model hash -> PersonaRef, open addressing with linear probing in one flat slot array.
+// Find never locks: a slot is written once (null -> entry, release) and never changed or
+// removed until the table is destroyed, so a reader sees either nothing or a finished entry.
+// Insert is serialized. The capacity is fixed at construction (load factor <= 0.75); a full
+// table still hands out the persona, it just is not cached.
+
+class PersonaTable {
+public:
+    explicit PersonaTable(size_t expected);
+    ~PersonaTable();
+    PersonaTable(const PersonaTable&) = delete;
+    PersonaTable& operator=(const PersonaTable&) = delete;
+
+    PersonaRef Find(uint32_t modelHash) const;
+    // Returns the entry that ended up in the table (an earlier one for the same hash wins)
+    PersonaRef Insert(PersonaRef persona);
+    size_t Size() const { return m_count.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        uint32_t modelHash;
+        PersonaRef persona;
+    };
+
+    uint32_t SlotOf(uint32_t modelHash) const { return (modelHash * 0x9E3779B1u) & m_mask; }
+
+    std::unique_ptr<std::atomic<const Entry*>[]> m_slots;
+    uint32_t m_mask = 0;
+    uint32_t m_maxCount = 0;
+    std::atomic<uint32_t> m_count{ 0 };
+    std::mutex m_insertMutex;
+};
+
+//EOF
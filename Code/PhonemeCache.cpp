@@ -0,0 +1,297 @@
+#include "PhonemeCache.h"
+#include "main.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+std::unordered_map<std::string, PhonemeCache::Entry> PhonemeCache::s_entries;
+std::list<std::string> PhonemeCache::s_lru;
+std::mutex PhonemeCache::s_mutex;
+size_t PhonemeCache::s_capacity = 0;
+bool PhonemeCache::s_dirty = false;
+std::string PhonemeCache::s_modelPath;
+std::string PhonemeCache::s_cachePath;
+PhonemeCache::G2pFn PhonemeCache::s_g2p;
+std::future<void> PhonemeCache::s_warmTask;
+std::atomic<bool> PhonemeCache::s_stopWarm(false);
+std::atomic<uint64_t> PhonemeCache::s_hits(0);
+std::atomic<uint64_t> PhonemeCache::s_misses(0);
+
+static const char* CACHE_MAGIC = "ECPHON1";
+static const char PHONEME_SEP = '\x1f';
+static const size_t MISS_BATCH = 64;
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE
+// ------------------------------------------------------------
+void PhonemeCache::Init(const std::string& modelPath, size_t capacity, G2pFn g2p) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_capacity = capacity;
+    s_g2p = std::move(g2p);
+    s_modelPath = modelPath;
+    s_cachePath = fs::path(modelPath).replace_filename("phoneme_cache.txt").string();
+    s_entries.clear();
+    s_lru.clear();
+    s_dirty = false;
+    s_stopWarm = false;
+    if (s_capacity == 0) {
+        Log("PhonemeCache: disabled (TTS_PHONEME_CACHE = 0)");
+        return;
+    }
+    if (Load()) Log("PhonemeCache: loaded " + std::to_string(s_entries.size()) + " words from " + s_cachePath);
+}
+
+void PhonemeCache::Shutdown() {
+    s_stopWarm = true;
+    if (s_warmTask.valid()) s_warmTask.wait();
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_capacity > 0) {
+        Save();
+        Log("PhonemeCache: " + std::to_string(s_hits.load()) + " hits, " + std::to_string(s_misses.load()) + " misses");
+    }
+    s_entries.clear();
+    s_lru.clear();
+    s_g2p = nullptr;
+    s_capacity = 0;
+}
+
+// ------------------------------------------------------------
+// 2. LOOKUP
+// ------------------------------------------------------------
+std::vector<std::string> PhonemeCache::Phonemize(const std::string& text) {
+    if (!IsEnabled()) return s_g2p ? s_g2p(text) : std::vector<std::string>();
+
+    std::vector<std::string> tokens;
+    std::vector<bool> spaceBefore;
+    Tokenize(text, tokens, spaceBefore);
+
+    // 1. Collect misses (one ONNX run for all of them)
+    std::vector<std::string> missing;
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> scratch;
+    for (const auto& t : tokens) {
+        if (Lookup(t, scratch)) { s_hits++; continue; }
+        if (seen.insert(t).second) missing.push_back(t);
+    }
+    if (!missing.empty()) {
+        s_misses += missing.size();
+        ResolveMisses(missing);
+    }
+
+    // 2. Assemble, word boundaries become " " like in the plain g2p output
+    std::vector<std::string> out;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        std::vector<std::string> ph;
+        if (!Lookup(tokens[i], ph)) ph = Strip(s_g2p(tokens[i]));   // evicted in between
+        if (ph.empty()) continue;
+        if (spaceBefore[i] && !out.empty()) out.push_back(" ");
+        out.insert(out.end(), ph.begin(), ph.end());
+    }
+    return out;
+}
+
+void PhonemeCache::WarmAsync(std::vector<std::string> words) {
+    if (!IsEnabled() || words.empty()) return;
+
+    s_warmTask = std::async(std::launch::async, [words = std::move(words)]() {
+        std::vector<std::string> missing;
+        std::unordered_set<std::string> seen;
+        std::vector<std::string> tokens, scratch;
+        std::vector<bool> spaceBefore;
+        for (const auto& w : words) {
+            Tokenize(w, tokens, spaceBefore);
+            for (const auto& t : tokens) {
+                if (!IsWordToken(t) || Lookup(t, scratch)) continue;
+                if (seen.insert(t).second) missing.push_back(t);
+            }
+        }
+
+        for (size_t i = 0; i < missing.size() && !s_stopWarm; i += MISS_BATCH) {
+            size_t end = std::min(missing.size(), i + MISS_BATCH);
+            ResolveMisses(std::vector<std::string>(missing.begin() + i, missing.begin() + end));
+        }
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (!missing.empty()) Save();
+        Log("PhonemeCache: warmed " + std::to_string(missing.size()) + " new words (" + std::to_string(s_entries.size()) + " cached)");
+    });
+}
+
+// ------------------------------------------------------------
+// 3. HELPERS
+// ------------------------------------------------------------
+void PhonemeCache::Tokenize(const std::string& text, std::vector<std::string>& tokens, std::vector<bool>& spaceBefore) {
+    tokens.clear();
+    spaceBefore.clear();
+    bool space = false;
+    std::string word;
+
+    auto flush = [&]() {
+        if (word.empty()) return;
+        tokens.push_back(word);
+        spaceBefore.push_back(space);
+        word.clear();
+        space = false;
+    };
+
+    for (unsigned char c : text) {
+        if (std::isspace(c)) { flush(); space = true; continue; }
+        if (std::isalnum(c) || c == '\'' || c == '-' || c >= 0x80) {
+            word += (char)std::tolower(c);
+            continue;
+        }
+        flush();
+        tokens.push_back(std::string(1, (char)c));
+        spaceBefore.push_back(space);
+        space = false;
+    }
+    flush();
+}
+
+bool PhonemeCache::IsWordToken(const std::string& token) {
+    unsigned char c = (unsigned char)token[0];
+    return token.size() > 1 || std::isalnum(c) || c >= 0x80;
+}
+
+bool PhonemeCache::Lookup(const std::string& key, std::vector<std::string>& out) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_entries.find(key);
+    if (it == s_entries.end()) return false;
+    s_lru.splice(s_lru.begin(), s_lru, it->second.lru);
+    out = it->second.phonemes;
+    return true;
+}
+
+void PhonemeCache::Insert(const std::string& key, std::vector<std::string> phonemes) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_entries.find(key);
+    if (it != s_entries.end()) {
+        it->second.phonemes = std::move(phonemes);
+        s_lru.splice(s_lru.begin(), s_lru, it->second.lru);
+        return;
+    }
+    s_lru.push_front(key);
+    s_entries[key] = { std::move(phonemes), s_lru.begin() };
+    while (s_entries.size() > s_capacity) {
+        s_entries.erase(s_lru.back());
+        s_lru.pop_back();
+    }
+    s_dirty = true;
+}
+
+// Removes word separators around a single-word result
+std::vector<std::string> PhonemeCache::Strip(std::vector<std::string> phonemes) {
+    while (!phonemes.empty() && phonemes.back() == " ") phonemes.pop_back();
+    size_t lead = 0;
+    while (lead < phonemes.size() && phonemes[lead] == " ") lead++;
+    phonemes.erase(phonemes.begin(), phonemes.begin() + lead);
+    return phonemes;
+}
+
+void PhonemeCache::ResolveMisses(const std::vector<std::string>& words) {
+    std::vector<std::string> batch;
+    for (const auto& w : words) {
+        if (IsWordToken(w)) batch.push_back(w);
+        else Insert(w, Strip(s_g2p(w)));         // punctuation, a handful of entries
+    }
+    if (batch.empty()) return;
+
+    // One g2p run over all missing words, split back at the word separators
+    std::vector<std::vector<std::string>> parts;
+    if (batch.size() > 1) {
+        std::string joined;
+        for (const auto& w : batch) joined += (joined.empty() ? "" : " ") + w;
+        std::vector<std::string> ph = Strip(s_g2p(joined));
+        parts.emplace_back();
+        for (auto& p : ph) {
+            if (p == " ") { if (!parts.back().empty()) parts.emplace_back(); }
+            else parts.back().push_back(std::move(p));
+        }
+    }
+
+    if (parts.size() == batch.size()) {
+        for (size_t i = 0; i < batch.size(); ++i) Insert(batch[i], std::move(parts[i]));
+    }
+    else {
+        // the model merged or split words, fall back to one run per word
+        for (const auto& w : batch) Insert(w, Strip(s_g2p(w)));
+    }
+}
+
+// ------------------------------------------------------------
+// 4. PERSISTENCE (word \t ph1 \x1f ph2 ..., most recent first)
+// ------------------------------------------------------------
+uint64_t PhonemeCache::ModelStamp() {
+    std::error_code ec;
+    uint64_t size = fs::file_size(s_modelPath, ec);
+    if (ec) return 0;
+    uint64_t time = (uint64_t)fs::last_write_time(s_modelPath, ec).time_since_epoch().count();
+    return size ^ (time * 0x9E3779B97F4A7C15ULL);
+}
+
+bool PhonemeCache::Load() {
+    std::ifstream f(s_cachePath, std::ios::binary);
+    if (!f.is_open()) return false;
+
+    std::string line;
+    if (!std::getline(f, line)) return false;
+    if (line != std::string(CACHE_MAGIC) + " " + std::to_string(ModelStamp())) {
+        Log("PhonemeCache: G2P model changed, cache discarded");
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::vector<std::string>>> rows;
+    while (std::getline(f, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos || tab == 0) continue;
+        std::vector<std::string> ph;
+        std::stringstream ss(line.substr(tab + 1));
+        std::string p;
+        while (std::getline(ss, p, PHONEME_SEP)) if (!p.empty()) ph.push_back(p);
+        rows.emplace_back(line.substr(0, tab), std::move(ph));
+    }
+
+    for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+        if (s_entries.count(it->first)) continue;
+        s_lru.push_front(it->first);
+        s_entries[it->first] = { std::move(it->second), s_lru.begin() };
+    }
+    while (s_entries.size() > s_capacity) {
+        s_entries.erase(s_lru.back());
+        s_lru.pop_back();
+    }
+    return true;
+}
+
+// caller holds s_mutex
+void PhonemeCache::Save() {
+    if (!s_dirty || s_cachePath.empty()) return;
+
+    std::string tmp = s_cachePath + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) return;
+        f << CACHE_MAGIC << " " << ModelStamp() << "\n";
+        for (const auto& key : s_lru) {
+            f << key << '\t';
+            const auto& ph = s_entries[key].phonemes;
+            for (size_t i = 0; i < ph.size(); ++i) {
+                if (i) f << PHONEME_SEP;
+                f << ph[i];
+            }
+            f << '\n';
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, s_cachePath, ec);
+    if (ec) Log("PhonemeCache: [ERROR] could not write " + s_cachePath);
+    else s_dirty = false;
+}
+
+//EOF
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// PhonemeCache.h
+// LRU word -> phoneme cache in front of DeepPhonemizer. A reply is tokenized into words
+// and punctuation; known words come from the cache, only the misses are sent to the
+// ONNX model, joined into one g2p run. The cache is saved next to the G2P model and
+// warmed at startup with persona names and the random NPC name lists.
+
+class PhonemeCache {
+public:
+    using G2pFn = std::function<std::vector<std::string>(const std::string&)>;
+
+    // modelPath: the deep_phonemizer.onnx, the cache file lives next to it
+    static void Init(const std::string& modelPath, size_t capacity, G2pFn g2p);
+    static void Shutdown();
+    static bool IsEnabled() { return s_capacity > 0 && s_g2p != nullptr; }
+
+    static std::vector<std::string> Phonemize(const std::string& text);
+
+    // Phonemizes all words not cached yet in the background
+    static void WarmAsync(std::vector<std::string> words);
+
+private:
+    struct Entry {
+        std::vector<std::string> phonemes;
+        std::list<std::string>::iterator lru;
+    };
+
+    static void Tokenize(const std::string& text, std::vector<std::string>& tokens, std::vector<bool>& spaceBefore);
+    static bool IsWordToken(const std::string& token);
+    static bool Lookup(const std::string& key, std::vector<std::string>& out);
+    static void Insert(const std::string& key, std::vector<std::string> phonemes);
+    static void ResolveMisses(const std::vector<std::string>& words);
+    static std::vector<std::string> Strip(std::vector<std::string> phonemes);
+    static bool Load();
+    static void Save();
+    static uint64_t ModelStamp();
+
+    static std::unordered_map<std::string, Entry> s_entries;
+    static std::list<std::string> s_lru;                  // front = most recent
+    static std::mutex s_mutex;
+    static size_t s_capacity;
+    static bool s_dirty;
+    static std::string s_modelPath;
+    static std::string s_cachePath;
+    static G2pFn s_g2p;
+    static std::future<void> s_warmTask;
+    static std::atomic<bool> s_stopWarm;
+    static std::atomic<uint64_t> s_hits;
+    static std::atomic<uint64_t> s_misses;
+};
+
+//EOF
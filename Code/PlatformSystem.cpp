@@ -24,7 +24,10 @@
 // =============================================================
 #ifdef PLATFORM_LINUX
 #include <time.h>
-// Linux INI parsing usually requires a custom library or simple parser
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 namespace AOS {
@@ -65,45 +68,52 @@ namespace AOS {
         return "";
     }
 
-    // ---------------------------------------------------------
-    // 3. INI CONFIGURATION
-    // ---------------------------------------------------------
-    std::string GetIniValue(const std::string& section, const std::string& key, const std::string& defaultVal, const std::string& filePath) {
-        char buffer[4096];
+    bool MapFile(const std::string& path, MappedFile& out) {
+        out = MappedFile();
 #ifdef PLATFORM_WINDOWS
-        GetPrivateProfileStringA(section.c_str(), key.c_str(), defaultVal.c_str(), buffer, sizeof(buffer), filePath.c_str());
-        return std::string(buffer);
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) { CloseHandle(file); return false; }
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) { CloseHandle(file); return false; }
+        const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) { CloseHandle(mapping); CloseHandle(file); return false; }
+        out.data = static_cast<const uint8_t*>(view);
+        out.size = (size_t)size.QuadPart;
+        out.file = file;
+        out.mapping = mapping;
+        return true;
+#elif defined(PLATFORM_LINUX)
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return false; }
+        void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);   // the mapping stays valid
+        if (view == MAP_FAILED) return false;
+        out.data = static_cast<const uint8_t*>(view);
+        out.size = (size_t)st.st_size;
+        return true;
 #else
-        return defaultVal; // TODO: Linux INI Parser
+        (void)path;
+        return false;
 #endif
     }
 
-    std::string GetIniSection(const std::string& section, const std::string& filePath) {
-        // This is tricky. GetPrivateProfileSection returns null-terminated strings ending with double null.
-        std::vector<char> buffer(32767); // Standard max size for INI section
+    void UnmapFile(MappedFile& file) {
+        if (!file.data) return;
 #ifdef PLATFORM_WINDOWS
-        DWORD len = GetPrivateProfileSectionA(section.c_str(), buffer.data(), (DWORD)buffer.size(), filePath.c_str());
-        if (len > 0) return std::string(buffer.data(), len);
+        UnmapViewOfFile(file.data);
+        if (file.mapping) CloseHandle((HANDLE)file.mapping);
+        if (file.file) CloseHandle((HANDLE)file.file);
+#elif defined(PLATFORM_LINUX)
+        munmap(const_cast<uint8_t*>(file.data), file.size);
 #endif
-        return "";
+        file = MappedFile();
     }
 
-    std::vector<std::string> GetIniSectionNames(const std::string& filePath) {
-        std::vector<std::string> sections;
-        std::vector<char> buffer(32767);
-#ifdef PLATFORM_WINDOWS
-        DWORD len = GetPrivateProfileSectionNamesA(buffer.data(), (DWORD)buffer.size(), filePath.c_str());
-        // Parse the double-null terminated string
-        if (len > 0) {
-            char* p = buffer.data();
-            while (*p) {
-                sections.push_back(std::string(p));
-                p += strlen(p) + 1;
-            }
-        }
-#endif
-        return sections;
-    }
+    // 3. INI CONFIGURATION -> IniDocument.cpp
 
     // ---------------------------------------------------------
     // 4. SYSTEM & ENVIRONMENT
@@ -222,5 +232,28 @@ namespace AOS {
         return 0;
     }
 
+    // ---------------------------------------
+    // 8. THREADS
+    // ---------------------------------------
+
+    void LowerCurrentThreadPriority() {
+#ifdef PLATFORM_WINDOWS
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+    }
+
+    bool SetCurrentThreadAffinity(uint64_t mask) {
+#ifdef PLATFORM_WINDOWS
+        DWORD_PTR processMask = 0, systemMask = 0;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) return false;
+        DWORD_PTR wanted = mask ? ((DWORD_PTR)mask & processMask) : processMask;
+        if (wanted == 0) wanted = processMask;
+        return SetThreadAffinityMask(GetCurrentThread(), wanted) != 0;
+#else
+        (void)mask;
+        return false;
+#endif
+    }
+
 }
 //EOF
\ No newline at end of file
@@ -24,17 +24,20 @@ namespace AOS {
     // Replaces GetModuleFileNameA
     std::string GetExecutablePath();
 
+    // Read-only memory mapping of a whole file (CreateFileMapping / mmap)
+    struct MappedFile {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        void* file = nullptr;       // HANDLE on Windows
+        void* mapping = nullptr;    // HANDLE on Windows
+    };
+    bool MapFile(const std::string& path, MappedFile& out);
+    void UnmapFile(MappedFile& file);
+
     // =============================================================
-    // 3. INI CONFIGURATION (GetPrivateProfileString)
+    // 3. INI CONFIGURATION
     // =============================================================
-    // Replaces GetPrivateProfileStringA
-    std::string GetIniValue(const std::string& section, const std::string& key, const std::string& defaultVal, const std::string& filePath);
-
-    // Replaces GetPrivateProfileSectionA (Returns raw section data)
-    std::string GetIniSection(const std::string& section, const std::string& filePath);
-
-    // Replaces GetPrivateProfileSectionNamesA
-    std::vector<std::string> GetIniSectionNames(const std::string& filePath);
+    // GetPrivateProfileString* replaced by IniDocument (IniDocument.h), same on every platform
 
     // =============================================================
     // 4. SYSTEM & ENVIRONMENT
@@ -73,6 +76,14 @@ namespace AOS {
     uint64_t GetProcessRAMUsage();
     VRAMInfo GetVRAMSize();
 
+    // =============================================================
+    // 7. THREADS
+    // =============================================================
+    // Background workers (preloading etc.) should not compete with the game thread
+    void LowerCurrentThreadPriority();
+    // mask 0 = back to every core of the process. False if not supported / failed.
+    bool SetCurrentThreadAffinity(uint64_t mask);
+
 
     
 
@@ -0,0 +1,470 @@
+#include "SemanticIndex.h"
+#include "ConfigReader.h"
+#include "helperfunctions.h"
+#include "llama.h"
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <chrono>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// ------------------------------------------------------------
+// STATIC MEMBERS
+// ------------------------------------------------------------
+std::vector<SemanticEntry> SemanticIndex::s_entries;
+std::vector<int8_t> SemanticIndex::s_matrix;
+std::vector<float> SemanticIndex::s_scales;
+uint64_t SemanticIndex::s_iniHash = 0;
+int SemanticIndex::s_dim = 0;
+int SemanticIndex::s_nativeDim = 0;
+
+llama_model* SemanticIndex::s_embedModel = nullptr;
+llama_context* SemanticIndex::s_embedCtx = nullptr;
+bool SemanticIndex::s_ownsModel = false;
+std::mutex SemanticIndex::s_embedMutex;
+std::shared_mutex SemanticIndex::s_dataMutex;
+std::mutex SemanticIndex::s_buildMutex;
+std::atomic<bool> SemanticIndex::s_ready{ false };
+std::atomic<uint64_t> SemanticIndex::s_buildGen{ 0 };
+
+// Random projection: one row of sign bits per output dimension
+static std::vector<uint64_t> s_projSigns;
+static int s_projWords = 0;
+
+static const uint32_t CACHE_MAGIC = 0x49534345; // "ECSI"
+static const uint32_t CACHE_VERSION = 1;
+static const int EMBED_MAX_TOKENS = 512;
+static const size_t EMBED_MAX_CHARS = 1500;
+
+// ------------------------------------------------------------
+// 1. HELPERS
+// ------------------------------------------------------------
+
+static uint64_t Fnv1a(const void* data, size_t len, uint64_t h = 1469598103934665603ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t SplitMix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static void NormalizeL2(std::vector<float>& v) {
+    double sum = 0.0;
+    for (float f : v) sum += (double)f * f;
+    if (sum <= 0.0) return;
+    float inv = (float)(1.0 / std::sqrt(sum));
+    for (float& f : v) f *= inv;
+}
+
+float SemanticIndex::QuantizeI8(const float* v, int8_t* q, int dim) {
+    float maxAbs = 0.0f;
+    for (int i = 0; i < dim; ++i) maxAbs = std::max(maxAbs, std::fabs(v[i]));
+    if (maxAbs <= 0.0f) {
+        std::memset(q, 0, dim);
+        return 0.0f;
+    }
+    float scale = maxAbs / 127.0f;
+    float inv = 1.0f / scale;
+    for (int i = 0; i < dim; ++i) {
+        int x = (int)std::lround(v[i] * inv);
+        q[i] = (int8_t)std::max(-127, std::min(127, x));
+    }
+    return scale;
+}
+
+// dim is always a multiple of 32 (rows are zero padded)
+int32_t SemanticIndex::DotI8(const int8_t* a, const int8_t* b, int dim) {
+#if defined(__AVX2__)
+    __m256i acc = _mm256_setzero_si256();
+    for (int i = 0; i < dim; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i a_lo = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(va));
+        __m256i a_hi = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(va, 1));
+        __m256i b_lo = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(vb));
+        __m256i b_hi = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(vb, 1));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a_lo, b_lo));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a_hi, b_hi));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    s = _mm_hadd_epi32(s, s);
+    s = _mm_hadd_epi32(s, s);
+    return _mm_cvtsi128_si32(s);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < dim; ++i) sum += (int32_t)a[i] * (int32_t)b[i];
+    return sum;
+#endif
+}
+
+// ------------------------------------------------------------
+// 2. ENTRY COLLECTION (from LoadKnowledgeDatabase)
+// ------------------------------------------------------------
+
+void SemanticIndex::Prepare(const std::map<std::string, KnowledgeSection>& db, uint64_t iniHash) {
+    s_ready = false;
+    std::unique_lock<std::shared_mutex> lock(s_dataMutex);
+    s_entries.clear();
+    s_matrix.clear();
+    s_scales.clear();
+    s_iniHash = iniHash;
+
+    for (const auto& pair : db) {
+        const KnowledgeSection& section = pair.second;
+        // Always-loaded sections are injected anyway, settings blocks are not knowledge
+        if (section.isAlwaysLoaded) continue;
+        if (pair.first == "[SETTINGS]" || pair.first == "[ADDITIONAL_SETTINGS]") continue;
+
+        // Same granularity as the keyword path: whole section or single key-values
+        if (section.loadEntireSectionOnMatch) {
+            if (section.content.empty()) continue;
+            s_entries.push_back({ pair.first, "", section.content });
+        }
+        else {
+            for (const auto& kv : section.keyValues) {
+                s_entries.push_back({ pair.first, kv.first, kv.first + " = " + kv.second + "\n" });
+            }
+        }
+    }
+    LogConfig("SemanticIndex: Prepared " + std::to_string(s_entries.size()) + " knowledge entries.");
+}
+
+// ------------------------------------------------------------
+// 3. EMBEDDING CONTEXT
+// ------------------------------------------------------------
+
+bool SemanticIndex::InitEmbedder(llama_model* chatModel, const std::string& rootPath) {
+    std::lock_guard<std::mutex> lock(s_embedMutex);
+    if (s_embedCtx) return true;
+    return CreateEmbedContext(chatModel, rootPath);
+}
+
+bool SemanticIndex::CreateEmbedContext(llama_model* chatModel, const std::string& rootPath) {
+    const std::string& custom = ConfigReader::g_Settings.EMBEDDING_MODEL_PATH;
+    std::string path;
+    if (!custom.empty()) {
+        if (std::ifstream(custom).good()) path = custom;
+        else if (std::ifstream(rootPath + custom).good()) path = rootPath + custom;
+    }
+
+    if (!path.empty()) {
+        llama_model_params mparams = llama_model_default_params();
+        mparams.n_gpu_layers = ConfigReader::g_Settings.USE_GPU_LAYERS;
+        s_embedModel = llama_model_load_from_file(path.c_str(), mparams);
+        if (s_embedModel) {
+            s_ownsModel = true;
+            Log("SemanticIndex: Using embedding model " + path);
+        }
+        else {
+            Log("SemanticIndex: Failed to load embedding model " + path + ", falling back to chat model.");
+        }
+    }
+    if (!s_embedModel) {
+        s_embedModel = chatModel;
+        s_ownsModel = false;
+    }
+    if (!s_embedModel) return false;
+
+    llama_context_params cparams = llama_context_default_params();
+    cparams.n_ctx = EMBED_MAX_TOKENS;
+    cparams.n_batch = EMBED_MAX_TOKENS;
+    cparams.n_ubatch = EMBED_MAX_TOKENS;
+    cparams.n_seq_max = 1;
+    cparams.embeddings = true;
+    cparams.pooling_type = LLAMA_POOLING_TYPE_MEAN;
+
+    s_embedCtx = llama_init_from_model(s_embedModel, cparams);
+    if (!s_embedCtx) {
+        Log("SemanticIndex: llama_init_from_model (embeddings) failed.");
+        if (s_ownsModel) llama_model_free(s_embedModel);
+        s_embedModel = nullptr;
+        return false;
+    }
+
+    s_nativeDim = llama_model_n_embd(s_embedModel);
+    int target = ConfigReader::g_Settings.EMBEDDING_PROJECT_DIM;
+    int outDim = (target > 0 && target < s_nativeDim) ? target : s_nativeDim;
+    {
+        std::unique_lock<std::shared_mutex> dataLock(s_dataMutex);
+        s_dim = (outDim + 31) & ~31;
+    }
+
+    s_projSigns.clear();
+    s_projWords = 0;
+    if (outDim < s_nativeDim) {
+        s_projWords = (s_nativeDim + 63) / 64;
+        s_projSigns.resize((size_t)outDim * s_projWords);
+        for (int j = 0; j < outDim; ++j) {
+            for (int w = 0; w < s_projWords; ++w) {
+                s_projSigns[(size_t)j * s_projWords + w] = SplitMix64(((uint64_t)j << 32) ^ (uint64_t)w);
+            }
+        }
+    }
+    Log("SemanticIndex: Embedding dim " + std::to_string(s_nativeDim) + " -> " + std::to_string(s_dim));
+    return true;
+}
+
+void SemanticIndex::Project(const std::vector<float>& in, std::vector<float>& out) {
+    out.assign(s_dim, 0.0f);
+    if (s_projSigns.empty()) {
+        std::copy(in.begin(), in.begin() + std::min((int)in.size(), s_dim), out.begin());
+        return;
+    }
+    int outDim = (int)(s_projSigns.size() / s_projWords);
+    for (int j = 0; j < outDim; ++j) {
+        const uint64_t* signs = &s_projSigns[(size_t)j * s_projWords];
+        float sum = 0.0f;
+        for (int i = 0; i < s_nativeDim; ++i) {
+            bool neg = (signs[i >> 6] >> (i & 63)) & 1ULL;
+            sum += neg ? -in[i] : in[i];
+        }
+        out[j] = sum;
+    }
+}
+
+bool SemanticIndex::EmbedRaw(const std::string& text, std::vector<float>& out) {
+    if (!s_embedCtx) return false;
+    const llama_vocab* vocab = llama_model_get_vocab(s_embedModel);
+
+    std::string clipped = text.substr(0, EMBED_MAX_CHARS);
+    std::vector<llama_token> tokens(clipped.length() + 8);
+    int32_t n = llama_tokenize(vocab, clipped.c_str(), (int32_t)clipped.length(), tokens.data(), (int32_t)tokens.size(), true, false);
+    if (n <= 0) return false;
+    n = std::min(n, (int32_t)EMBED_MAX_TOKENS);
+
+    llama_memory_t mem = llama_get_memory(s_embedCtx);
+    if (mem) llama_memory_clear(mem, true);
+
+    llama_batch batch = llama_batch_init(n, 0, 1);
+    batch.n_tokens = n;
+    for (int32_t i = 0; i < n; ++i) {
+        batch.token[i] = tokens[i];
+        batch.pos[i] = i;
+        batch.n_seq_id[i] = 1;
+        batch.seq_id[i][0] = 0;
+        batch.logits[i] = true;
+    }
+    int rc = llama_decode(s_embedCtx, batch);
+    llama_batch_free(batch);
+    if (rc != 0) return false;
+
+    const float* emb = llama_get_embeddings_seq(s_embedCtx, 0);
+    if (!emb) emb = llama_get_embeddings_ith(s_embedCtx, -1);
+    if (!emb) return false;
+
+    out.assign(emb, emb + s_nativeDim);
+    return true;
+}
+
+bool SemanticIndex::Embed(const std::string& text, std::vector<float>& out) {
+    std::vector<float> raw;
+    {
+        // Projection under the lock too, a new embed context replaces the sign table and s_dim
+        std::lock_guard<std::mutex> lock(s_embedMutex);
+        if (!EmbedRaw(text, raw)) return false;
+        NormalizeL2(raw);
+        Project(raw, out);
+    }
+    NormalizeL2(out);
+    return true;
+}
+
+// ------------------------------------------------------------
+// 4. PERSISTED CACHE
+// ------------------------------------------------------------
+
+bool SemanticIndex::LoadCache(const std::string& path, uint64_t key) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+
+    uint32_t magic = 0, version = 0, count = 0, dim = 0;
+    uint64_t fileKey = 0;
+    f.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    f.read(reinterpret_cast<char*>(&version), sizeof(version));
+    f.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+    f.read(reinterpret_cast<char*>(&count), sizeof(count));
+    f.read(reinterpret_cast<char*>(&dim), sizeof(dim));
+    if (!f || magic != CACHE_MAGIC || version != CACHE_VERSION || fileKey != key) return false;
+
+    std::vector<float> scales(count);
+    std::vector<int8_t> matrix((size_t)count * dim);
+    f.read(reinterpret_cast<char*>(scales.data()), count * sizeof(float));
+    f.read(reinterpret_cast<char*>(matrix.data()), matrix.size());
+    if (!f) return false;
+
+    std::unique_lock<std::shared_mutex> lock(s_dataMutex);
+    if (count != s_entries.size() || (int)dim != s_dim) return false;
+    s_scales.swap(scales);
+    s_matrix.swap(matrix);
+    return true;
+}
+
+void SemanticIndex::SaveCache(const std::string& path, uint64_t key) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+        Log("SemanticIndex: Could not write cache " + path);
+        return;
+    }
+    std::shared_lock<std::shared_mutex> lock(s_dataMutex);
+    uint32_t count = (uint32_t)s_entries.size();
+    uint32_t dim = (uint32_t)s_dim;
+    f.write(reinterpret_cast<const char*>(&CACHE_MAGIC), sizeof(CACHE_MAGIC));
+    f.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+    f.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    f.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
+    f.write(reinterpret_cast<const char*>(s_scales.data()), s_scales.size() * sizeof(float));
+    f.write(reinterpret_cast<const char*>(s_matrix.data()), s_matrix.size());
+}
+
+// ------------------------------------------------------------
+// 5. BUILD / SHUTDOWN
+// ------------------------------------------------------------
+
+bool SemanticIndex::Build(llama_model* chatModel, const std::string& rootPath) {
+    if (!ConfigReader::g_Settings.SEMANTIC_KNOWLEDGE) return false;
+    // A running build (e.g. from before an API reload) sees the new generation and stops,
+    // the lock waits until it has left the loop. A newer Build or Shutdown meanwhile wins.
+    const uint64_t gen = ++s_buildGen;
+    std::lock_guard<std::mutex> buildLock(s_buildMutex);
+    auto cancelled = [gen] { return s_buildGen.load() != gen; };
+    if (cancelled()) return false;
+    s_ready = false;
+    if (!InitEmbedder(chatModel, rootPath)) return false;
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    // Cache key: INI content + embedding model identity + output layout
+    char desc[256] = { 0 };
+    llama_model_desc(s_embedModel, desc, sizeof(desc));
+    uint64_t modelSize = llama_model_size(s_embedModel);
+    uint64_t key = Fnv1a(&s_iniHash, sizeof(s_iniHash));
+    key = Fnv1a(desc, std::strlen(desc), key);
+    key = Fnv1a(&modelSize, sizeof(modelSize), key);
+    key = Fnv1a(&s_nativeDim, sizeof(s_nativeDim), key);
+    key = Fnv1a(&s_dim, sizeof(s_dim), key);
+
+    std::string cachePath = rootPath + "ECMod\\EC_DataFiles\\EC_KnowledgeEmbeddings.bin";
+    if (LoadCache(cachePath, key)) {
+        s_ready = true;
+        Log("SemanticIndex: Loaded " + std::to_string(s_entries.size()) + " embeddings from cache.");
+        return true;
+    }
+
+    size_t count = 0;
+    int dim = 0;
+    {
+        std::unique_lock<std::shared_mutex> lock(s_dataMutex);
+        count = s_entries.size();
+        dim = s_dim;
+        s_matrix.assign(count * (size_t)dim, 0);
+        s_scales.assign(count, 0.0f);
+    }
+
+    std::vector<float> vec;
+    std::vector<int8_t> row(dim);
+    size_t embedded = 0;
+    bool stale = false;   // Prepare replaced the table or a new embed context changed the dim
+    for (size_t i = 0; i < count && !cancelled(); ++i) {
+        std::string text;
+        {
+            std::shared_lock<std::shared_mutex> lock(s_dataMutex);
+            if (s_entries.size() != count || s_dim != dim) { stale = true; break; }
+            const SemanticEntry& e = s_entries[i];
+            // Section name gives the embedding a topic anchor ("KEY_ORGANIZATIONS: LSPD = ...")
+            std::string topic = e.sectionName.size() > 2 ? e.sectionName.substr(1, e.sectionName.size() - 2) : e.sectionName;
+            text = topic + ": " + e.text;
+        }
+        if (!Embed(text, vec) || (int)vec.size() != dim) continue;
+        float scale = QuantizeI8(vec.data(), row.data(), dim);
+
+        std::unique_lock<std::shared_mutex> lock(s_dataMutex);
+        if (s_entries.size() != count || s_dim != dim) { stale = true; break; }
+        std::memcpy(&s_matrix[i * (size_t)dim], row.data(), dim);
+        s_scales[i] = scale;
+        embedded++;
+    }
+
+    if (cancelled() || stale) {
+        Log("SemanticIndex: Build cancelled after " + std::to_string(embedded) + "/" + std::to_string(count) + " entries.");
+        return false;
+    }
+    // A partial matrix would be loaded as valid on every launch, so only a complete one is kept
+    if (embedded == count) SaveCache(cachePath, key);
+    s_ready = true;
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t0).count();
+    Log("SemanticIndex: Embedded " + std::to_string(embedded) + "/" + std::to_string(count) +
+        " entries in " + std::to_string(ms) + " ms.");
+    return true;
+}
+
+void SemanticIndex::Shutdown() {
+    ++s_buildGen;
+    std::lock_guard<std::mutex> lock(s_embedMutex);
+    s_ready = false;
+    if (s_embedCtx) {
+        llama_free(s_embedCtx);
+        s_embedCtx = nullptr;
+    }
+    if (s_ownsModel && s_embedModel) {
+        llama_model_free(s_embedModel);
+    }
+    s_embedModel = nullptr;
+    s_ownsModel = false;
+}
+
+// ------------------------------------------------------------
+// 6. QUERY
+// ------------------------------------------------------------
+
+std::vector<SemanticHit> SemanticIndex::Query(const std::vector<float>& queryVec, int topK, float minSimilarity) {
+    std::vector<SemanticHit> hits;
+    if (!s_ready || topK <= 0) return hits;
+    std::shared_lock<std::shared_mutex> lock(s_dataMutex);
+    if (!s_ready || (int)queryVec.size() != s_dim || s_entries.empty() || s_scales.size() != s_entries.size()) return hits;
+
+    std::vector<int8_t> q(s_dim);
+    float qScale = QuantizeI8(queryVec.data(), q.data(), s_dim);
+    if (qScale <= 0.0f) return hits;
+
+    // Linear scan; knowledge tables are a few hundred rows at most
+    const size_t rows = s_entries.size();
+    for (size_t i = 0; i < rows; ++i) {
+        if (s_scales[i] <= 0.0f) continue;
+        float score = DotI8(q.data(), &s_matrix[i * (size_t)s_dim], s_dim) * qScale * s_scales[i];
+        if (score < minSimilarity) continue;
+
+        if ((int)hits.size() < topK) {
+            hits.push_back({ (int)i, score });
+            std::push_heap(hits.begin(), hits.end(), [](const SemanticHit& a, const SemanticHit& b) { return a.score > b.score; });
+        }
+        else if (score > hits.front().score) {
+            std::pop_heap(hits.begin(), hits.end(), [](const SemanticHit& a, const SemanticHit& b) { return a.score > b.score; });
+            hits.back() = { (int)i, score };
+            std::push_heap(hits.begin(), hits.end(), [](const SemanticHit& a, const SemanticHit& b) { return a.score > b.score; });
+        }
+    }
+    std::sort(hits.begin(), hits.end(), [](const SemanticHit& a, const SemanticHit& b) { return a.score > b.score; });
+    return hits;
+}
+
+SemanticEntry SemanticIndex::GetEntry(int index) {
+    std::shared_lock<std::shared_mutex> lock(s_dataMutex);
+    if (index < 0 || index >= (int)s_entries.size()) return SemanticEntry();
+    return s_entries[index];
+}
+
+//EOF
@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
+
+// SemanticIndex.h
+// Embedding based retrieval for the knowledge sections of GTAV_EC_Settings.ini.
+// Every retrievable entry is embedded once (LLM in embedding mode or a dedicated
+// embedding GGUF), L2-normalized and stored as an int8 row with a per-row scale.
+// The matrix is persisted next to the INI and reused as long as INI + model match.
+
+struct llama_model;
+struct llama_context;
+struct KnowledgeSection;
+
+struct SemanticEntry {
+    std::string sectionName;   // "[KEY_ORGANIZATIONS]" (same key as ConfigData::knowledge)
+    std::string key;           // empty = whole section
+    std::string text;          // text injected into the prompt
+};
+
+struct SemanticHit {
+    int entry = -1;
+    float score = 0.0f;
+};
+
+class SemanticIndex {
+public:
+    // Called from ConfigReader::LoadKnowledgeDatabase (no model needed yet)
+    static void Prepare(const std::map<std::string, KnowledgeSection>& db, uint64_t iniHash);
+    // Called once the LLM is loaded. Creates the embedding context (shared with MemoryStore).
+    static bool InitEmbedder(llama_model* chatModel, const std::string& rootPath);
+    // Loads the cache or embeds all entries and writes it.
+    static bool Build(llama_model* chatModel, const std::string& rootPath);
+    static void Shutdown();
+
+    static bool IsReady() { return s_ready.load(); }
+    static std::vector<SemanticHit> Query(const std::vector<float>& queryVec, int topK, float minSimilarity);
+    // Copy, the table can be rebuilt after the Query (empty entry if the index is gone)
+    static SemanticEntry GetEntry(int index);
+
+    // --- Shared embedding helpers (also used by MemoryStore) ---
+    static int Dim() { return s_dim; }
+    static bool HasEmbedder() { return s_embedCtx != nullptr; }
+    static bool Embed(const std::string& text, std::vector<float>& out);
+    static float QuantizeI8(const float* v, int8_t* q, int dim);
+    static int32_t DotI8(const int8_t* a, const int8_t* b, int dim);
+
+private:
+    static bool CreateEmbedContext(llama_model* chatModel, const std::string& rootPath);
+    static bool EmbedRaw(const std::string& text, std::vector<float>& out);
+    static void Project(const std::vector<float>& in, std::vector<float>& out);
+    static bool LoadCache(const std::string& path, uint64_t key);
+    static void SaveCache(const std::string& path, uint64_t key);
+
+    static std::vector<SemanticEntry> s_entries;
+    static std::vector<int8_t> s_matrix;     // s_entries.size() * s_dim
+    static std::vector<float> s_scales;      // one per row
+    static uint64_t s_iniHash;
+    static int s_dim;
+    static int s_nativeDim;
+
+    static llama_model* s_embedModel;
+    static llama_context* s_embedCtx;
+    static bool s_ownsModel;
+    static std::mutex s_embedMutex;
+    static std::shared_mutex s_dataMutex;      // s_entries, s_matrix, s_scales vs. Query / GetEntry
+    static std::mutex s_buildMutex;            // one Build at a time
+    static std::atomic<bool> s_ready;
+    static std::atomic<uint64_t> s_buildGen;   // bumped by every Build and Shutdown, older builds stop
+};
+
+//EOF
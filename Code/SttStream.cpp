@@ -0,0 +1,275 @@
+#include "SttStream.h"
+#include "LLM_Inference.h"
+#include "ConfigReader.h"
+#include "helperfunctions.h"
+#include "VoiceActivity.h"
+#include "WhisperPool.h"
+#include "CoreBudget.h"
+#include "whisper.h"
+#include <algorithm>
+#include <chrono>
+
+// ------------------------------------------------------------
+// STATIC MEMBERS
+// ------------------------------------------------------------
+whisper_state* SttStream::s_state = nullptr;
+std::thread SttStream::s_worker;
+std::mutex SttStream::s_workerMutex;
+std::mutex SttStream::s_stateMutex;
+std::atomic<bool> SttStream::s_active{ false };
+std::atomic<bool> SttStream::s_stop{ false };
+std::atomic<bool> SttStream::s_retiring{ false };
+
+size_t SttStream::s_commitSample = 0;
+std::string SttStream::s_committedText;
+std::vector<SttSegment> SttStream::s_lastPass;
+
+extern struct whisper_context* g_whisper_ctx;
+
+static const size_t SAMPLES_PER_TICK = WHISPER_SAMPLE_RATE / 100; // whisper timestamps are 10 ms
+static const size_t MIN_WINDOW_SAMPLES = WHISPER_SAMPLE_RATE;     // < 1 s is not worth a pass
+static const size_t CONTEXT_PROMPT_CHARS = 200;
+
+static size_t MsToSamples(int ms) {
+    return (size_t)std::max(0, ms) * WHISPER_SAMPLE_RATE / 1000;
+}
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE
+// ------------------------------------------------------------
+bool SttStream::Begin() {
+    if (!g_whisper_ctx) return false;
+    Cancel();
+    if (s_retiring.load()) {
+        // Its pass still holds the state lock; waiting here would stall the frame
+        LogA("SttStream: Previous stream still finishing, falling back to batch STT.");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_stateMutex);
+        // The state is leased for the whole utterance
+        s_state = WhisperPool::Acquire(100);
+        if (!s_state) {
+            LogA("SttStream: No free whisper state, falling back to batch STT.");
+            return false;
+        }
+        s_commitSample = 0;
+        s_committedText.clear();
+        s_lastPass.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(s_workerMutex);
+    s_stop = false;
+    s_active = true;
+    // The worker reads the ring until it exits, even when it is abandoned by Cancel
+    s_worker = std::thread([lease = CaptureReadLease()]() { WorkerLoop(); });
+    LogA("SttStream: Streaming transcription started.");
+    return true;
+}
+
+void SttStream::StopWorker() {
+    std::lock_guard<std::mutex> lock(s_workerMutex);
+    s_stop = true;
+    if (s_worker.joinable()) s_worker.join();
+}
+
+std::string SttStream::Finish() {
+    if (!s_active.load()) return "";
+    StopWorker();
+
+    CaptureReadLease lease;
+    std::lock_guard<std::mutex> lock(s_stateMutex);
+    if (!s_state) return "";   // cancelled meanwhile
+    std::vector<float> scratch;
+    size_t count = 0;
+    const float* pcm = GetRecordedAudio(s_commitSample, count, scratch);
+
+    std::vector<float> trimmed;
+    if (ConfigReader::g_Settings.STT_VAD && count > 0) {
+        VadStats vad;
+        if (VoiceActivity::Trim(pcm, count, trimmed, vad)) {
+            LogA("SttStream: VAD " + VoiceActivity::Describe(vad));
+        }
+        pcm = trimmed.data();
+        count = trimmed.size();
+    }
+
+    std::string text = s_committedText;
+    if (count > 0) {
+        std::vector<SttSegment> segments;
+        if (RunWindow(pcm, count, text, segments)) {
+            for (const SttSegment& seg : segments) text += seg.text;
+        }
+    }
+    WhisperPool::Release(s_state);
+    s_state = nullptr;
+    s_active = false;
+
+    LogA("SttStream: Final window " + std::to_string(count) + " samples, committed before release: " +
+        std::to_string(s_commitSample) + ". Text: " + text);
+    return text;
+}
+
+void SttStream::Cancel() {
+    std::lock_guard<std::mutex> lock(s_workerMutex);
+    s_active = false;
+    if (!s_worker.joinable()) {
+        std::lock_guard<std::mutex> stateLock(s_stateMutex);
+        if (s_state) {
+            WhisperPool::Release(s_state);
+            s_state = nullptr;
+        }
+        return;
+    }
+    s_stop = true;
+    s_retiring = true;
+    std::thread([worker = std::move(s_worker)]() mutable {
+        worker.join();
+        std::lock_guard<std::mutex> stateLock(s_stateMutex);
+        if (s_state) {
+            WhisperPool::Release(s_state);
+            s_state = nullptr;
+        }
+        s_retiring = false;
+    }).detach();
+}
+
+bool SttStream::CommittedSnapshot(std::string& text, size_t& sample) {
+    std::lock_guard<std::mutex> lock(s_stateMutex);
+    if (!s_state) return false;
+    text = s_committedText;
+    sample = s_commitSample;
+    return true;
+}
+
+void SttStream::Shutdown() {
+    StopWorker();
+    while (s_retiring.load()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::lock_guard<std::mutex> lock(s_stateMutex);
+    if (s_state) {
+        WhisperPool::Release(s_state);
+        s_state = nullptr;
+    }
+    s_active = false;
+}
+
+// ------------------------------------------------------------
+// 2. WORKER
+// ------------------------------------------------------------
+void SttStream::WorkerLoop() {
+    const auto step = std::chrono::milliseconds(std::max(100, ConfigReader::g_Settings.STT_STREAM_STEP_MS));
+    const size_t maxWindow = std::max(MsToSamples(ConfigReader::g_Settings.STT_STREAM_MAX_WINDOW_MS), 2 * MIN_WINDOW_SAMPLES);
+    const size_t holdback = MsToSamples(ConfigReader::g_Settings.STT_STREAM_HOLDBACK_MS);
+    auto next = std::chrono::steady_clock::now() + step;
+    std::vector<float> scratch; // only used when the window wraps around the ring
+
+    while (!s_stop.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (std::chrono::steady_clock::now() < next) continue;
+        next = std::chrono::steady_clock::now() + step;
+
+        std::lock_guard<std::mutex> lock(s_stateMutex);
+        size_t count = 0;
+        const float* pcm = GetRecordedAudio(s_commitSample, count, scratch);
+        if (count < MIN_WINDOW_SAMPLES) continue;
+
+        // Pure silence (player has not started talking yet): skip it instead of transcribing it
+        if (ConfigReader::g_Settings.STT_VAD && !VoiceActivity::HasSpeech(pcm, count)) {
+            size_t skip = count - std::min(count, holdback);
+            if (skip > 0) {
+                s_commitSample += skip;
+                s_lastPass.clear();
+                ReleaseRecordedAudio(s_commitSample);
+            }
+            continue;
+        }
+
+        // Without commits for too long the window is cut hard (all but the last segment)
+        bool force = count >= maxWindow;
+        if (count > maxWindow) count = maxWindow;
+
+        std::vector<SttSegment> segments;
+        if (!RunWindow(pcm, count, s_committedText, segments)) continue;
+        // Cancelled during the pass: the commit position belongs to the old recording and
+        // must not release anything in the ring the next PTT press starts filling
+        if (s_stop.load()) break;
+        CommitStable(segments, count, force);
+        // Committed audio is done, the capture ring may overwrite it
+        ReleaseRecordedAudio(s_commitSample);
+    }
+}
+
+bool SttStream::RunWindow(const float* pcm, size_t count, const std::string& context, std::vector<SttSegment>& out) {
+    CoreBudget::Scope cpu(CpuStage::STT);
+    whisper_full_params wparams;
+    std::string language;
+    WhisperPool::FillParams(wparams, language);
+    wparams.no_context = true;
+    wparams.single_segment = false;
+
+    // Tail of the committed text keeps spelling/casing consistent across windows
+    std::string prompt = context.size() > CONTEXT_PROMPT_CHARS ? context.substr(context.size() - CONTEXT_PROMPT_CHARS) : context;
+    if (!prompt.empty()) wparams.initial_prompt = prompt.c_str();
+
+    if (whisper_full_with_state(g_whisper_ctx, s_state, wparams, pcm, (int)count) != 0) {
+        LogA("SttStream: whisper_full_with_state failed.");
+        return false;
+    }
+    if (language == "auto") WhisperPool::RememberLanguage(s_state);
+
+    out.clear();
+    int n = whisper_full_n_segments_from_state(s_state);
+    for (int i = 0; i < n; ++i) {
+        SttSegment seg;
+        seg.text = whisper_full_get_segment_text_from_state(s_state, i);
+        seg.t0 = whisper_full_get_segment_t0_from_state(s_state, i);
+        seg.t1 = whisper_full_get_segment_t1_from_state(s_state, i);
+        out.push_back(seg);
+    }
+    return true;
+}
+
+// A segment is stable when it is not the last one, ends at least STT_STREAM_HOLDBACK_MS
+// before the live edge and the previous pass produced the same text at the same start.
+void SttStream::CommitStable(const std::vector<SttSegment>& segments, size_t windowSamples, bool force) {
+    const size_t holdback = MsToSamples(ConfigReader::g_Settings.STT_STREAM_HOLDBACK_MS);
+    size_t commitEnd = 0;
+    size_t committed = 0;
+
+    for (size_t i = 0; i + 1 < segments.size(); ++i) {
+        const SttSegment& seg = segments[i];
+        size_t segEnd = (size_t)std::max<int64_t>(0, seg.t1) * SAMPLES_PER_TICK;
+        if (segEnd == 0 || segEnd > windowSamples) break;
+
+        if (!force) {
+            if (segEnd + holdback > windowSamples) break;
+            if (i >= s_lastPass.size() || s_lastPass[i].text != seg.text || s_lastPass[i].t0 != seg.t0) break;
+        }
+        s_committedText += seg.text;
+        commitEnd = segEnd;
+        committed++;
+    }
+
+    // A forced cut has to make progress even when whisper returned one segment (or none):
+    // the lone segment is committed, without one the window is dropped
+    if (force && committed == 0 && segments.size() <= 1) {
+        size_t segEnd = segments.empty() ? 0 : (size_t)std::max<int64_t>(0, segments[0].t1) * SAMPLES_PER_TICK;
+        if (!segments.empty()) {
+            s_committedText += segments[0].text;
+            committed = 1;
+        }
+        commitEnd = (segEnd == 0 || segEnd > windowSamples) ? windowSamples : segEnd;
+    }
+
+    if (commitEnd > 0) {
+        s_commitSample += commitEnd;
+        s_lastPass.clear(); // timestamps of the next pass are relative to the new window start
+        LogA("SttStream: Committed " + std::to_string(committed) + " segment(s), window now starts at sample " + std::to_string(s_commitSample));
+    }
+    else {
+        s_lastPass = segments;
+    }
+}
+
+//EOF
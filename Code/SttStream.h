@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// SttStream.h
+// Streaming speech-to-text while push-to-talk is held. A worker transcribes the audio
+// after the last committed point in overlapping windows (whisper_full_with_state on one
+// persistent state). Segments that two passes agree on and that lie far enough from the
+// live edge are committed and cut off the window. On release only the last window is
+// left to transcribe, so the latency after release no longer grows with utterance length.
+
+struct whisper_state;
+
+struct SttSegment {
+    std::string text;
+    int64_t t0 = 0;   // 10 ms units, relative to the window start
+    int64_t t1 = 0;
+};
+
+class SttStream {
+public:
+    // PTT pressed (after StartAudioRecording)
+    static bool Begin();
+    // PTT released (after StopAudioRecording, runs in g_stt_future): last window + full text
+    static std::string Finish();
+    // Does not wait for a running pass: the worker is joined and its state released on a
+    // short-lived thread, so the script thread never stalls on whisper
+    static void Cancel();
+    // Stops the background passes (idempotent, any thread). After this the committed
+    // data below does not change until the next Begin().
+    static void StopWorker();
+    // Committed text and its end sample as one snapshot under the state lock.
+    // false (outputs untouched) when the stream was finished or cancelled meanwhile.
+    static bool CommittedSnapshot(std::string& text, size_t& sample);
+    static bool IsActive() { return s_active.load(); }
+    // A cancelled worker is still finishing its pass on the capture ring
+    static bool IsRetiring() { return s_retiring.load(); }
+    static void Shutdown();
+
+private:
+    static void WorkerLoop();
+    static bool RunWindow(const float* pcm, size_t count, const std::string& context, std::vector<SttSegment>& out);
+    static void CommitStable(const std::vector<SttSegment>& segments, size_t windowSamples, bool force);
+
+    static whisper_state* s_state;        // leased from WhisperPool while active
+    static std::thread s_worker;
+    static std::mutex s_workerMutex;      // Finish and the draft pass may both stop the worker
+    static std::mutex s_stateMutex;       // guards s_state + commit data
+    static std::atomic<bool> s_active;
+    static std::atomic<bool> s_stop;
+    static std::atomic<bool> s_retiring;  // a cancelled worker is still finishing its pass
+
+    static size_t s_commitSample;         // absolute sample index of the window start
+    static std::string s_committedText;
+    static std::vector<SttSegment> s_lastPass;
+};
+
+//EOF
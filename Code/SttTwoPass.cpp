@@ -0,0 +1,142 @@
+#include "SttTwoPass.h"
+#include "SttStream.h"
+#include "WhisperPool.h"
+#include "CoreBudget.h"
+#include "VoiceActivity.h"
+#include "LLM_Inference.h"
+#include "ConfigReader.h"
+#include "helperfunctions.h"
+#include "whisper.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <chrono>
+
+// ------------------------------------------------------------
+// STATIC MEMBERS
+// ------------------------------------------------------------
+whisper_context* SttTwoPass::s_ctx = nullptr;
+std::mutex SttTwoPass::s_mutex;
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE
+// ------------------------------------------------------------
+bool SttTwoPass::Init(const std::string& draftModelPath) {
+    Shutdown();
+    if (draftModelPath.empty()) return false;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    whisper_context_params cparams = whisper_context_default_params();
+    s_ctx = whisper_init_from_file_with_params(draftModelPath.c_str(), cparams);
+    if (!s_ctx) {
+        LogA("SttTwoPass: FAILED to load draft model " + draftModelPath + ", two-pass STT disabled.");
+        return false;
+    }
+    LogA("SttTwoPass: Draft model loaded: " + draftModelPath);
+    return true;
+}
+
+void SttTwoPass::Shutdown() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_ctx) {
+        whisper_free(s_ctx);
+        s_ctx = nullptr;
+    }
+}
+
+// ------------------------------------------------------------
+// 2. DRAFT
+// ------------------------------------------------------------
+std::string SttTwoPass::TranscribeDraft() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Streaming: the committed part is already transcribed by the main model,
+    // the draft model only has to cover the tail
+    CaptureReadLease lease;
+    std::string prefix;
+    size_t from = 0;
+    if (SttStream::IsActive()) {
+        SttStream::StopWorker();
+        SttStream::CommittedSnapshot(prefix, from);
+    }
+
+    std::vector<float> scratch;
+    size_t count = 0;
+    const float* pcm = GetRecordedAudio(from, count, scratch);
+
+    std::vector<float> trimmed;
+    if (ConfigReader::g_Settings.STT_VAD && count > 0) {
+        VadStats vad;
+        VoiceActivity::Trim(pcm, count, trimmed, vad);
+        pcm = trimmed.data();
+        count = trimmed.size();
+    }
+    if (count == 0) return prefix;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (!s_ctx) return "";
+
+    CoreBudget::Scope cpu(CpuStage::STT);
+    whisper_full_params wparams;
+    std::string language;
+    WhisperPool::FillParams(wparams, language);
+    wparams.strategy = WHISPER_SAMPLING_GREEDY; // the draft is about speed
+    if (!whisper_is_multilingual(s_ctx)) {
+        language = "en";
+        wparams.language = language.c_str();
+    }
+
+    if (whisper_full(s_ctx, wparams, pcm, (int)count) != 0) {
+        LogA("SttTwoPass: Draft whisper_full failed.");
+        return "";
+    }
+
+    std::string text = prefix;
+    int n = whisper_full_n_segments(s_ctx);
+    for (int i = 0; i < n; ++i) {
+        text += whisper_full_get_segment_text(s_ctx, i);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    LogA("SttTwoPass: Draft in " + std::to_string((int)ms) + " ms: " + text);
+    return text;
+}
+
+// ------------------------------------------------------------
+// 3. COMPARISON
+// ------------------------------------------------------------
+static std::vector<std::string> NormalizedWords(const std::string& text) {
+    std::string clean;
+    clean.reserve(text.size());
+    for (char c : text) {
+        unsigned char u = (unsigned char)c;
+        if (std::isalnum(u) || u >= 0x80) clean += (char)std::tolower(u);
+        else clean += ' ';
+    }
+    std::vector<std::string> words;
+    std::stringstream ss(clean);
+    std::string w;
+    while (ss >> w) words.push_back(w);
+    return words;
+}
+
+float SttTwoPass::WordDistance(const std::string& a, const std::string& b) {
+    std::vector<std::string> wa = NormalizedWords(a);
+    std::vector<std::string> wb = NormalizedWords(b);
+    if (wa.empty() && wb.empty()) return 0.0f;
+    if (wa.empty() || wb.empty()) return 1.0f;
+
+    std::vector<size_t> prev(wb.size() + 1), cur(wb.size() + 1);
+    for (size_t j = 0; j <= wb.size(); ++j) prev[j] = j;
+    for (size_t i = 1; i <= wa.size(); ++i) {
+        cur[0] = i;
+        for (size_t j = 1; j <= wb.size(); ++j) {
+            size_t sub = prev[j - 1] + (wa[i - 1] == wb[j - 1] ? 0 : 1);
+            cur[j] = std::min({ prev[j] + 1, cur[j - 1] + 1, sub });
+        }
+        prev.swap(cur);
+    }
+    return (float)prev[wb.size()] / (float)std::max(wa.size(), wb.size());
+}
+
+//EOF
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <mutex>
+
+// SttTwoPass.h
+// Optional draft pass for speech-to-text. A tiny Whisper model (STT_DRAFT_MODEL) transcribes
+// the utterance right after PTT release so AssemblePrompt + prefill can start on the draft,
+// while the main model refines the text in parallel. The main loop restarts generation only
+// if the refined text differs by more than STT_REFINE_THRESHOLD (word edit distance).
+
+struct whisper_context;
+
+class SttTwoPass {
+public:
+    static bool Init(const std::string& draftModelPath);
+    static void Shutdown();
+    static bool IsEnabled() { return s_ctx != nullptr; }
+
+    // Runs in g_stt_future. Uses the committed streaming text if SttStream is active.
+    static std::string TranscribeDraft();
+
+    // Word-level Levenshtein distance / longer length (case and punctuation ignored). 0 = same.
+    static float WordDistance(const std::string& a, const std::string& b);
+
+private:
+    static whisper_context* s_ctx;   // own default state, guarded by s_mutex
+    static std::mutex s_mutex;
+};
+
+//EOF
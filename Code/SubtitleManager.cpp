@@ -80,7 +80,7 @@ uint32_t SubtitleManager::CalculateDuration(const std::string& text) {
 // Adds text to the UI stack and queues audio for synchronization
 
 void SubtitleManager::ShowMessage(const std::string& name, const std::string& chunk,
-    const std::vector<int16_t>& pcm, int rate) {
+    PcmRef pcm, int rate, std::shared_ptr<VoiceStream> stream) {
     if (chunk.empty()) return;
 
     std::lock_guard<std::mutex> lock(m_Mutex);
@@ -106,8 +106,9 @@ void SubtitleManager::ShowMessage(const std::string& name, const std::string& ch
 
             // --- FIX 2: Audio nachtrglich injizieren ---
             // Wenn der Eintrag noch kein Audio hat, aber wir jetzt welches bekommen:
-            if (last.pcmData.empty() && !pcm.empty()) {
-                last.pcmData = pcm;
+            if (PcmEmpty(last.pcmData) && !last.stream && (!PcmEmpty(pcm) || stream)) {
+                last.pcmData = std::move(pcm);
+                last.stream = stream;
                 last.sampleRate = rate;
                 last.playedAudio = false; // WICHTIG: Zurcksetzen, damit AudioSystem es abspielt!
                 last.creationTime = now;  // Zeit resetten, damit der Sync-Check (1100ms) durchgeht
@@ -132,7 +133,8 @@ void SubtitleManager::ShowMessage(const std::string& name, const std::string& ch
         entry.fullText = chunk;
 
         // Store Audio Data for Sync
-        entry.pcmData = pcm;
+        entry.pcmData = std::move(pcm);
+        entry.stream = stream;
         entry.sampleRate = rate;
         entry.playedAudio = false;
         entry.creationTime = now;
@@ -144,7 +146,7 @@ void SubtitleManager::ShowMessage(const std::string& name, const std::string& ch
         entry.displayUntil = now + CalculateDuration(chunk);
         entry.alpha = 255.0f;
 
-        m_Queue.push_back(entry);
+        m_Queue.push_back(std::move(entry));
     }
 
     // 3. Cleanup queue size
@@ -166,11 +168,16 @@ void SubtitleManager::UpdateAndRender() {
     for (auto it = m_Queue.begin(); it != m_Queue.end(); ) {
 
         // --- AUDIO SYNC TRIGGER ---
-        if (!it->playedAudio && !it->pcmData.empty()) {
+        if (!it->playedAudio && (!PcmEmpty(it->pcmData) || it->stream)) {
             // SYNC CHECK: Only play if we are within 1100ms of the text appearing.
             // This prevents old audio from playing if the game lagged/paused.
+            uint32_t voiceKey = (uint32_t)std::hash<std::string>{}(it->speaker);
             if (now <= it->creationTime + 1100) {
-                AudioSystem::PlayBuffer(it->pcmData, it->sampleRate);
+                if (it->stream) AudioSystem::PlayStream(it->stream, voiceKey);
+                else AudioSystem::PlayBuffer(it->pcmData, it->sampleRate, voiceKey);
+            }
+            else if (it->stream) {
+                it->stream->Cancel();   // nobody will play it, let the synthesizer stop writing
             }
             it->playedAudio = true; // Mark handled to prevent re-triggering
         }
@@ -3,6 +3,10 @@
 #include <vector>
 #include <cstdint>
 #include <mutex>
+#include <memory>
+#include "AudioBuffer.h"
+
+class VoiceStream;
 
 struct SubEntry {
     std::string speaker;
@@ -15,16 +19,18 @@ struct SubEntry {
     int lineCount;
 
     // Audio Integration (RAM based for performance)
-    std::vector<int16_t> pcmData;
+    PcmRef pcmData;                        // shared with the mixer, never copied
     int sampleRate = 22050;
     bool playedAudio = false;
+    std::shared_ptr<VoiceStream> stream;   // streaming line, filled while it plays
 };
 
 class SubtitleManager {
 public:
     // Updated signature: takes PCM vector instead of a string path
     void ShowMessage(const std::string& name, const std::string& chunk,
-        const std::vector<int16_t>& pcm = {}, int rate = 22050);
+        PcmRef pcm = nullptr, int rate = 22050,
+        std::shared_ptr<VoiceStream> stream = nullptr);
 
     void UpdateAndRender();
 
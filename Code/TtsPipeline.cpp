@@ -0,0 +1,302 @@
+#include "TtsPipeline.h"
+#include "AudioSystem.h"
+#include "CoreBudget.h"
+#include "babylon/babylon.h"
+#include "main.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+std::thread TtsPipeline::s_g2pThread;
+std::vector<std::thread> TtsPipeline::s_workers;
+std::atomic<bool> TtsPipeline::s_running(false);
+
+std::mutex TtsPipeline::s_textMutex;
+std::condition_variable TtsPipeline::s_textCv;
+std::deque<TtsPipeline::Chunk> TtsPipeline::s_textQueue;
+
+std::mutex TtsPipeline::s_phonemeMutex;
+std::condition_variable TtsPipeline::s_phonemeCv;
+std::condition_variable TtsPipeline::s_phonemeSpaceCv;
+std::deque<TtsPipeline::Chunk> TtsPipeline::s_phonemeQueue;
+size_t TtsPipeline::s_queueDepth = 8;
+
+std::mutex TtsPipeline::s_sessionLockMutex;
+std::unordered_map<Vits::Session*, std::shared_ptr<std::mutex>> TtsPipeline::s_sessionLocks;
+
+// Pieces shorter than this are merged with the next one ("Yeah." "Ok!")
+static const size_t MIN_SENTENCE_CHARS = 24;
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE
+// ------------------------------------------------------------
+void TtsPipeline::Init(int workers, int queueDepth) {
+    if (s_running) return;
+    if (workers <= 0) {
+        Log("TtsPipeline: disabled (TTS_WORKERS = 0), synthesizing synchronously");
+        return;
+    }
+    workers = std::min(workers, 8);
+    s_queueDepth = (size_t)std::max(1, queueDepth);
+    s_running = true;
+
+    s_g2pThread = std::thread(G2pLoop);
+    for (int i = 0; i < workers; ++i) s_workers.emplace_back(VitsLoop);
+
+    Log("TtsPipeline: started (" + std::to_string(workers) + " VITS workers, queue depth " + std::to_string(s_queueDepth) + ")");
+}
+
+void TtsPipeline::Shutdown() {
+    if (!s_running.exchange(false)) return;
+
+    { std::lock_guard<std::mutex> lock(s_textMutex); }
+    { std::lock_guard<std::mutex> lock(s_phonemeMutex); }
+    s_textCv.notify_all();
+    s_phonemeCv.notify_all();
+    s_phonemeSpaceCv.notify_all();
+
+    if (s_g2pThread.joinable()) s_g2pThread.join();
+    for (auto& t : s_workers) if (t.joinable()) t.join();
+    s_workers.clear();
+
+    std::lock_guard<std::mutex> lock(s_sessionLockMutex);
+    s_sessionLocks.clear();
+}
+
+// ------------------------------------------------------------
+// 2. REQUESTS
+// ------------------------------------------------------------
+std::vector<std::string> TtsPipeline::SplitSentences(const std::string& text) {
+    std::vector<std::string> raw;
+    std::string current;
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '\n' || c == '\r') {
+            if (!current.empty()) raw.push_back(current);
+            current.clear();
+            continue;
+        }
+        current += c;
+        if (c == '.' || c == '!' || c == '?') {
+            // keep "..." / "?!" together, split only before whitespace
+            while (i + 1 < text.size() && (text[i + 1] == '.' || text[i + 1] == '!' || text[i + 1] == '?' || text[i + 1] == '"')) {
+                current += text[++i];
+            }
+            if (i + 1 >= text.size() || std::isspace((unsigned char)text[i + 1])) {
+                raw.push_back(current);
+                current.clear();
+            }
+        }
+    }
+    if (!current.empty()) raw.push_back(current);
+
+    std::vector<std::string> out;
+    std::string pending;
+    for (auto& s : raw) {
+        size_t b = s.find_first_not_of(" \t");
+        if (b == std::string::npos) continue;
+        size_t e = s.find_last_not_of(" \t");
+        std::string piece = s.substr(b, e - b + 1);
+
+        pending = pending.empty() ? piece : pending + " " + piece;
+        if (pending.size() >= MIN_SENTENCE_CHARS) {
+            out.push_back(pending);
+            pending.clear();
+        }
+    }
+    if (!pending.empty()) {
+        if (!out.empty() && pending.size() < MIN_SENTENCE_CHARS) out.back() += " " + pending;
+        else out.push_back(pending);
+    }
+    return out;
+}
+
+std::vector<int16_t> TtsPipeline::Synthesize(const std::string& text, const TtsRequest& req, double* inferenceSeconds) {
+    if (!req.session || text.empty()) return {};
+    // TTS is active until the reply is done. The calling thread only runs inference itself
+    // without workers; the workers re-pin to the TTS cores per chunk.
+    CoreBudget::Scope cpu(CpuStage::TTS, !s_running);
+
+    if (!s_running) {
+        Chunk chunk;
+        chunk.text = text;
+        chunk.phonemes = AudioSystem::Phonemize(text);
+        std::vector<int16_t> pcm;
+        {
+            auto sessionLock = SessionLock(req.session);
+            std::lock_guard<std::mutex> lock(*sessionLock);
+            try {
+                auto t0 = std::chrono::steady_clock::now();
+                pcm = req.session->tts_to_memory(chunk.phonemes, req.speakerID, req.speed, req.noise, req.noise_w);
+                if (inferenceSeconds) *inferenceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            }
+            catch (const std::exception& e) {
+                Log("TtsPipeline: [ERROR] " + std::string(e.what()));
+                return {};
+            }
+        }
+        // Outside the session lock, a blocking stream must not hold up other NPCs on this voice
+        if (req.onChunk) req.onChunk(pcm);
+        return pcm;
+    }
+
+    std::vector<std::string> sentences = SplitSentences(text);
+    if (sentences.empty()) return {};
+
+    auto job = std::make_shared<Job>();
+    job->req = req;
+    job->parts.resize(sentences.size());
+    job->done.assign(sentences.size(), false);
+    job->remaining = sentences.size();
+
+    {
+        std::lock_guard<std::mutex> lock(s_textMutex);
+        for (size_t i = 0; i < sentences.size(); ++i) {
+            Chunk chunk;
+            chunk.job = job;
+            chunk.index = i;
+            chunk.text = std::move(sentences[i]);
+            s_textQueue.push_back(std::move(chunk));
+        }
+    }
+    s_textCv.notify_one();
+
+    // Streaming consumers get the sentences strictly in order, on this thread and without
+    // the job lock: the callback may block (full stream ring) and must not stall a worker.
+    // A finished part is never touched again by the workers, so it is read unlocked.
+    std::unique_lock<std::mutex> lock(job->mutex);
+    auto emittable = [&] { return job->nextEmit < job->parts.size() && job->done[job->nextEmit]; };
+    while (true) {
+        job->cv.wait(lock, [&] { return job->remaining == 0 || (req.onChunk && emittable()); });
+        while (req.onChunk && emittable()) {
+            const std::vector<int16_t>& part = job->parts[job->nextEmit++];
+            if (part.empty()) continue;
+            lock.unlock();
+            req.onChunk(part);
+            lock.lock();
+        }
+        if (job->remaining == 0) break;
+    }
+
+    size_t total = 0;
+    for (auto& p : job->parts) total += p.size();
+    std::vector<int16_t> pcm;
+    pcm.reserve(total);
+    for (auto& p : job->parts) pcm.insert(pcm.end(), p.begin(), p.end());
+    if (inferenceSeconds) *inferenceSeconds = job->inferenceSeconds;
+    return pcm;
+}
+
+// ------------------------------------------------------------
+// 3. STAGES
+// ------------------------------------------------------------
+void TtsPipeline::G2pLoop() {
+    while (true) {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(s_textMutex);
+            s_textCv.wait(lock, [] { return !s_textQueue.empty() || !s_running; });
+            if (!s_running) break;
+            chunk = std::move(s_textQueue.front());
+            s_textQueue.pop_front();
+        }
+
+        CoreBudget::ApplyToThisThread(CpuStage::TTS);
+        chunk.phonemes = AudioSystem::Phonemize(chunk.text);
+
+        std::unique_lock<std::mutex> lock(s_phonemeMutex);
+        s_phonemeSpaceCv.wait(lock, [] { return s_phonemeQueue.size() < s_queueDepth || !s_running; });
+        if (!s_running) {
+            lock.unlock();
+            FinishChunk(chunk, {});
+            break;
+        }
+        s_phonemeQueue.push_back(std::move(chunk));
+        lock.unlock();
+        s_phonemeCv.notify_one();
+    }
+
+    // wake up everyone still waiting on a reply
+    std::deque<Chunk> left;
+    {
+        std::lock_guard<std::mutex> lock(s_textMutex);
+        left.swap(s_textQueue);
+    }
+    for (auto& c : left) FinishChunk(c, {});
+}
+
+void TtsPipeline::VitsLoop() {
+    while (true) {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(s_phonemeMutex);
+            s_phonemeCv.wait(lock, [] { return !s_phonemeQueue.empty() || !s_running; });
+            if (s_phonemeQueue.empty()) break;
+            if (!s_running) {
+                chunk = std::move(s_phonemeQueue.front());
+                s_phonemeQueue.pop_front();
+                lock.unlock();
+                FinishChunk(chunk, {});
+                continue;
+            }
+            chunk = std::move(s_phonemeQueue.front());
+            s_phonemeQueue.pop_front();
+        }
+        s_phonemeSpaceCv.notify_one();
+        CoreBudget::ApplyToThisThread(CpuStage::TTS);
+        SynthesizeChunk(chunk);
+    }
+}
+
+void TtsPipeline::SynthesizeChunk(Chunk& chunk) {
+    const TtsRequest& req = chunk.job->req;
+    std::vector<int16_t> pcm;
+
+    if (!chunk.phonemes.empty()) {
+        auto sessionLock = SessionLock(req.session);
+        std::lock_guard<std::mutex> lock(*sessionLock);
+        try {
+            auto t0 = std::chrono::steady_clock::now();
+            pcm = req.session->tts_to_memory(chunk.phonemes, req.speakerID, req.speed, req.noise, req.noise_w);
+            chunk.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        }
+        catch (const std::exception& e) {
+            Log("TtsPipeline: [ERROR] Sentence " + std::to_string(chunk.index) + ": " + std::string(e.what()));
+        }
+        catch (...) {
+            Log("TtsPipeline: [ERROR] Unknown error in sentence " + std::to_string(chunk.index));
+        }
+    }
+    FinishChunk(chunk, std::move(pcm));
+}
+
+void TtsPipeline::FinishChunk(Chunk& chunk, std::vector<int16_t>&& pcm) {
+    if (!chunk.job) return;
+    Job& job = *chunk.job;
+    {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        job.parts[chunk.index] = std::move(pcm);
+        job.done[chunk.index] = true;
+        job.inferenceSeconds += chunk.seconds;
+        --job.remaining;
+    }
+    // Synthesize emits the ready parts itself
+    job.cv.notify_all();
+}
+
+void TtsPipeline::ForgetSession(Vits::Session* session) {
+    std::lock_guard<std::mutex> lock(s_sessionLockMutex);
+    s_sessionLocks.erase(session);
+}
+
+// One lock per voice model: the same ONNX session never runs twice at once,
+// different sessions run in parallel.
+std::shared_ptr<std::mutex> TtsPipeline::SessionLock(Vits::Session* session) {
+    std::lock_guard<std::mutex> lock(s_sessionLockMutex);
+    auto& m = s_sessionLocks[session];
+    if (!m) m = std::make_shared<std::mutex>();
+    return m;
+}
+
+//EOF
@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// TtsPipeline.h
+// Two stage TTS engine behind AudioSystem::Generate. A reply is split into sentences,
+// one G2P thread phonemizes them and hands them to a small pool of VITS workers through
+// a bounded queue (TTS_QUEUE_DEPTH), so G2P of the next sentence overlaps synthesis of the
+// current one. Every Vits::Session has its own lock, so two NPCs are synthesized at once.
+
+namespace Vits { class Session; }
+
+struct TtsRequest {
+    Vits::Session* session = nullptr;
+    int speakerID = 0;
+    float speed = 1.0f;
+    float noise = 0.667f;
+    float noise_w = 0.8f;
+    // Optional, gets every sentence's PCM in order as soon as it and all before it are done.
+    // Called on the thread that runs Synthesize with no pipeline lock held, so it may block.
+    std::function<void(const std::vector<int16_t>&)> onChunk;
+};
+
+class TtsPipeline {
+public:
+    static void Init(int workers, int queueDepth);
+    static void Shutdown();
+    static bool IsRunning() { return s_running.load(); }
+
+    // Blocks until all sentences are synthesized, returns them concatenated in order.
+    // Falls back to a synchronous run if the pipeline is not started.
+    // inferenceSeconds: summed VITS time of all sentences (without queue / lock waits)
+    static std::vector<int16_t> Synthesize(const std::string& text, const TtsRequest& req, double* inferenceSeconds = nullptr);
+
+    // Drops the per-session lock once AudioManager unloads a voice
+    static void ForgetSession(Vits::Session* session);
+
+    // Splits on . ! ? and line breaks, glues very short pieces to their neighbour
+    static std::vector<std::string> SplitSentences(const std::string& text);
+
+private:
+    struct Job {
+        TtsRequest req;
+        std::vector<std::vector<int16_t>> parts;
+        std::vector<bool> done;
+        size_t nextEmit = 0;
+        size_t remaining = 0;
+        double inferenceSeconds = 0.0;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    struct Chunk {
+        std::shared_ptr<Job> job;
+        size_t index = 0;
+        std::string text;
+        std::vector<std::string> phonemes;
+        double seconds = 0.0;
+    };
+
+    static void G2pLoop();
+    static void VitsLoop();
+    static void SynthesizeChunk(Chunk& chunk);
+    static void FinishChunk(Chunk& chunk, std::vector<int16_t>&& pcm);
+    static std::shared_ptr<std::mutex> SessionLock(Vits::Session* session);
+
+    static std::thread s_g2pThread;
+    static std::vector<std::thread> s_workers;
+    static std::atomic<bool> s_running;
+
+    static std::mutex s_textMutex;                 // G2P input
+    static std::condition_variable s_textCv;
+    static std::deque<Chunk> s_textQueue;
+
+    static std::mutex s_phonemeMutex;              // bounded G2P -> VITS queue
+    static std::condition_variable s_phonemeCv;
+    static std::condition_variable s_phonemeSpaceCv;
+    static std::deque<Chunk> s_phonemeQueue;
+    static size_t s_queueDepth;
+
+    static std::mutex s_sessionLockMutex;
+    static std::unordered_map<Vits::Session*, std::shared_ptr<std::mutex>> s_sessionLocks;
+};
+
+//EOF
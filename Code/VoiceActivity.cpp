@@ -0,0 +1,176 @@
+#include "VoiceActivity.h"
+#include "ConfigReader.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// ------------------------------------------------------------
+// STATIC MEMBERS
+// ------------------------------------------------------------
+std::atomic<uint64_t> VoiceActivity::s_totalIn{ 0 };
+std::atomic<uint64_t> VoiceActivity::s_totalRemoved{ 0 };
+
+// Noise floor is the 10th percentile of the frame energies, but never above this
+// (a recording that is speech from start to end would otherwise raise its own threshold)
+static const float NOISE_FLOOR_CAP = 1e-3f;
+static const float ABSOLUTE_FLOOR = 1e-6f;
+// Unvoiced sounds (s, f, sh) are quiet but cross zero often
+static const float FRICATIVE_ZCR = 0.25f;
+
+static size_t MsToFrames(int ms) {
+    return (size_t)std::max(0, ms) * VoiceActivity::SAMPLE_RATE / 1000 / VoiceActivity::FRAME_SAMPLES;
+}
+
+// ------------------------------------------------------------
+// 1. FEATURES
+// ------------------------------------------------------------
+void VoiceActivity::FrameFeatures(const float* x, int n, float& energy, int& zeroCrossings) {
+    float sum = 0.0f;
+    int zc = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 9 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(x + i);
+        __m256 b = _mm256_loadu_ps(x + i + 1);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(a, a));
+        // sign bit differs between neighbours -> one crossing
+        zc += _mm_popcnt_u32((unsigned)_mm256_movemask_ps(_mm256_xor_ps(a, b)));
+    }
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    s = _mm_hadd_ps(s, s);
+    s = _mm_hadd_ps(s, s);
+    sum = _mm_cvtss_f32(s);
+#endif
+    for (; i < n; ++i) {
+        sum += x[i] * x[i];
+        if (i + 1 < n && ((x[i] < 0.0f) != (x[i + 1] < 0.0f))) zc++;
+    }
+    energy = n > 0 ? sum / (float)n : 0.0f;
+    zeroCrossings = zc;
+}
+
+// ------------------------------------------------------------
+// 2. CLASSIFICATION
+// ------------------------------------------------------------
+void VoiceActivity::Classify(const float* pcm, size_t count, std::vector<uint8_t>& speech) {
+    const size_t frames = count / FRAME_SAMPLES + (count % FRAME_SAMPLES ? 1 : 0);
+    std::vector<float> energy(frames);
+    std::vector<float> zcr(frames);
+
+    for (size_t f = 0; f < frames; ++f) {
+        size_t start = f * FRAME_SAMPLES;
+        int n = (int)std::min<size_t>(FRAME_SAMPLES, count - start);
+        int zc = 0;
+        FrameFeatures(pcm + start, n, energy[f], zc);
+        zcr[f] = n > 1 ? (float)zc / (float)(n - 1) : 0.0f;
+    }
+
+    std::vector<float> sorted = energy;
+    size_t p10 = sorted.size() / 10;
+    std::nth_element(sorted.begin(), sorted.begin() + p10, sorted.end());
+    float noiseFloor = std::max(ABSOLUTE_FLOOR, std::min(sorted[p10], NOISE_FLOOR_CAP));
+
+    const float ratio = std::max(1.0f, ConfigReader::g_Settings.STT_VAD_THRESHOLD_RATIO);
+    const float threshold = noiseFloor * ratio;
+    const float fricativeThreshold = noiseFloor * std::max(1.0f, ratio * 0.5f);
+
+    speech.assign(frames, 0);
+    for (size_t f = 0; f < frames; ++f) {
+        if (energy[f] > threshold || (energy[f] > fricativeThreshold && zcr[f] > FRICATIVE_ZCR)) {
+            speech[f] = 1;
+        }
+    }
+
+    // Hangover: word onsets and endings are quieter than the vowel in between
+    const size_t pad = MsToFrames(ConfigReader::g_Settings.STT_VAD_PAD_MS);
+    if (pad > 0) {
+        std::vector<uint8_t> dilated(frames, 0);
+        for (size_t f = 0; f < frames; ++f) {
+            if (!speech[f]) continue;
+            size_t lo = f > pad ? f - pad : 0;
+            size_t hi = std::min(frames - 1, f + pad);
+            std::memset(&dilated[lo], 1, hi - lo + 1);
+        }
+        speech.swap(dilated);
+    }
+}
+
+// ------------------------------------------------------------
+// 3. TRIMMING
+// ------------------------------------------------------------
+bool VoiceActivity::Trim(const float* pcm, size_t count, std::vector<float>& out, VadStats& stats) {
+    stats = VadStats();
+    stats.inputSamples = count;
+    out.clear();
+    if (!pcm || count == 0) return false;
+
+    std::vector<uint8_t> speech;
+    Classify(pcm, count, speech);
+    const size_t frames = speech.size();
+
+    size_t first = 0;
+    while (first < frames && !speech[first]) ++first;
+    if (first == frames) {
+        s_totalIn += count;
+        s_totalRemoved += count;
+        return false;
+    }
+    size_t last = frames - 1;
+    while (last > first && !speech[last]) --last;
+
+    const size_t maxGap = std::max<size_t>(1, MsToFrames(ConfigReader::g_Settings.STT_VAD_MAX_GAP_MS));
+    out.reserve(count);
+
+    size_t f = first;
+    while (f <= last) {
+        size_t runEnd = f;
+        while (runEnd <= last && speech[runEnd] == speech[f]) ++runEnd;
+        size_t runFrames = runEnd - f;
+
+        size_t startSample = f * FRAME_SAMPLES;
+        size_t endSample = std::min(count, runEnd * FRAME_SAMPLES);
+
+        if (speech[f] || runFrames <= maxGap) {
+            out.insert(out.end(), pcm + startSample, pcm + endSample);
+        }
+        else {
+            // Keep half of the allowed pause on each side, drop the middle
+            size_t keep = (maxGap * FRAME_SAMPLES) / 2;
+            out.insert(out.end(), pcm + startSample, pcm + startSample + keep);
+            out.insert(out.end(), pcm + endSample - keep, pcm + endSample);
+            stats.gapsCollapsed++;
+        }
+        f = runEnd;
+    }
+
+    stats.leadingTrimmed = first * FRAME_SAMPLES;
+    stats.trailingTrimmed = count - std::min(count, (last + 1) * FRAME_SAMPLES);
+    stats.outputSamples = out.size();
+
+    s_totalIn += count;
+    s_totalRemoved += count - out.size();
+    return true;
+}
+
+std::string VoiceActivity::Describe(const VadStats& stats) {
+    char buf[192];
+    snprintf(buf, sizeof(buf), "removed %.0f%% (lead %.2f s, tail %.2f s, %zu pauses), total saved %.1f s",
+        stats.RemovedRatio() * 100.0f,
+        (double)stats.leadingTrimmed / SAMPLE_RATE, (double)stats.trailingTrimmed / SAMPLE_RATE,
+        stats.gapsCollapsed, (double)s_totalRemoved.load() / SAMPLE_RATE);
+    return buf;
+}
+
+bool VoiceActivity::HasSpeech(const float* pcm, size_t count) {
+    if (!pcm || count == 0) return false;
+    std::vector<uint8_t> speech;
+    Classify(pcm, count, speech);
+    return std::find(speech.begin(), speech.end(), (uint8_t)1) != speech.end();
+}
+
+//EOF
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// VoiceActivity.h
+// Energy + zero-crossing voice activity detection on 16 kHz mono float PCM.
+// Used before Whisper: leading/trailing silence is cut and long pauses are shortened,
+// because Whisper compute grows with the input length, not with the amount of speech.
+
+struct VadStats {
+    size_t inputSamples = 0;
+    size_t outputSamples = 0;
+    size_t leadingTrimmed = 0;
+    size_t trailingTrimmed = 0;
+    size_t gapsCollapsed = 0;   // number of pauses that were shortened
+
+    float RemovedRatio() const {
+        return inputSamples ? 1.0f - (float)outputSamples / (float)inputSamples : 0.0f;
+    }
+};
+
+class VoiceActivity {
+public:
+    static const int SAMPLE_RATE = 16000;
+    static const int FRAME_SAMPLES = 320;   // 20 ms
+
+    // Writes the trimmed audio to 'out'. Returns false if no speech was found (out is empty).
+    static bool Trim(const float* pcm, size_t count, std::vector<float>& out, VadStats& stats);
+    // Cheap check, e.g. to skip a streaming pass over pure silence
+    static bool HasSpeech(const float* pcm, size_t count);
+    // "removed 38% (lead 0.42 s, tail 0.61 s, 2 pauses), total saved 41.3 s" for the log
+    static std::string Describe(const VadStats& stats);
+
+    // Mean square energy and zero crossings of one frame (AVX2 if available)
+    static void FrameFeatures(const float* x, int n, float& energy, int& zeroCrossings);
+
+    // Totals since start, for the log
+    static uint64_t TotalInputSamples() { return s_totalIn.load(); }
+    static uint64_t TotalRemovedSamples() { return s_totalRemoved.load(); }
+
+private:
+    static void Classify(const float* pcm, size_t count, std::vector<uint8_t>& speech);
+
+    static std::atomic<uint64_t> s_totalIn;
+    static std::atomic<uint64_t> s_totalRemoved;
+};
+
+//EOF
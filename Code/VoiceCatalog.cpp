@@ -0,0 +1,348 @@
+#include "VoiceCatalog.h"
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+
+namespace fs = std::filesystem;
+
+std::vector<CatalogVoice> VoiceCatalog::s_voices;
+std::vector<int> VoiceCatalog::s_users;
+std::unordered_map<std::string, int> VoiceCatalog::s_byKey;
+std::unordered_map<std::string, std::string> VoiceCatalog::s_paths;
+std::unordered_map<std::string, std::vector<uint32_t>> VoiceCatalog::s_byModel;
+std::unordered_map<std::string, uint16_t> VoiceCatalog::s_types;
+std::vector<std::vector<uint32_t>> VoiceCatalog::s_buckets;
+uint64_t VoiceCatalog::s_rng = 0x9E3779B97F4A7C15ULL;
+std::mutex VoiceCatalog::s_mutex;
+
+static const int GENDER_COUNT = (int)VoiceGender::COUNT;
+static const int AGE_COUNT = (int)VoiceAge::COUNT;
+
+static std::string Trim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t");
+    if (a == std::string::npos) return "";
+    size_t b = s.find_last_not_of(" \t");
+    return s.substr(a, b - a + 1);
+}
+
+static std::string Lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return s;
+}
+
+static std::string VoiceId(const std::string& modelKey, int speakerId) {
+    return modelKey + "#" + std::to_string(speakerId);
+}
+
+// ---------------------------------------------------------------------
+// 1. INTERNING
+// ---------------------------------------------------------------------
+
+// Only the first letter counts ("m", "male", "Male"), "n" = voice fits everyone
+VoiceGender VoiceCatalog::InternGender(const std::string& s) {
+    if (s.empty()) return VoiceGender::ANY;
+    switch (std::tolower((unsigned char)s[0])) {
+    case 'm': return VoiceGender::MALE;
+    case 'f': case 'w': return VoiceGender::FEMALE;
+    case 'n': return VoiceGender::ANY;
+    default: return VoiceGender::OTHER;
+    }
+}
+
+VoiceAge VoiceCatalog::InternAge(const std::string& s) {
+    if (s.empty()) return VoiceAge::ANY;
+    switch (std::tolower((unsigned char)s[0])) {
+    case 'y': return VoiceAge::YOUNG;
+    case 'm': case 'a': return VoiceAge::MIDDLE;
+    case 'o': return VoiceAge::OLD;
+    default: return VoiceAge::OTHER;
+    }
+}
+
+// add = false: unknown NPC voicetype -> last column (only wildcard voices answer it)
+uint16_t VoiceCatalog::InternType(const std::string& s, bool add) {
+    if (s.empty()) return 0;
+    std::string key = Lower(s);
+    auto it = s_types.find(key);
+    if (it != s_types.end()) return it->second;
+    if (!add) return (uint16_t)(s_types.size() + 1);
+    uint16_t id = (uint16_t)(s_types.size() + 1);
+    s_types.emplace(key, id);
+    return id;
+}
+
+// ---------------------------------------------------------------------
+// 2. PARSING
+// ---------------------------------------------------------------------
+
+void VoiceCatalog::Build(const std::string& gameRoot) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_voices.clear();
+    s_byKey.clear();
+    s_paths.clear();
+    s_byModel.clear();
+    s_types.clear();
+
+    std::string configFolder = gameRoot + "/ECmod/AudioDataFiles";
+    if (!fs::exists(configFolder)) {
+        Log("VoiceCatalog: Config folder missing: " + configFolder);
+        s_users.clear();
+        s_buckets.clear();
+        return;
+    }
+
+    std::vector<std::string> files;
+    for (const auto& entry : fs::directory_iterator(configFolder)) {
+        if (entry.path().extension() == ".ini" &&
+            entry.path().filename().string().find("EC_Voices_list_") == 0) {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto& f : files) ParseFile(f, gameRoot);
+
+    Index();
+    Log("VoiceCatalog: " + std::to_string(s_voices.size()) + " voices from " + std::to_string(files.size()) +
+        " lists, " + std::to_string(s_types.size()) + " voice types, " + std::to_string(s_buckets.size()) + " buckets");
+}
+
+void VoiceCatalog::ParseFile(const std::string& file, const std::string& gameRoot) {
+    std::ifstream in(file);
+    std::string line;
+    std::string basePath;
+    CatalogVoice cur;
+    std::string pathRaw;
+    bool open = false;
+
+    auto commit = [&]() {
+        if (!open) return;
+        open = false;
+        if (cur.modelKey.empty()) cur.modelKey = std::to_string(cur.listId);
+        // Only voices with their own file are usable (multi speaker onnx without path= are skipped, as before)
+        if (pathRaw.empty()) return;
+
+        std::string finalPath = basePath + pathRaw;
+        if (finalPath.find(".onnx") == std::string::npos) finalPath += ".onnx";
+        std::replace(finalPath.begin(), finalPath.end(), '/', '\\');
+        if (!fs::exists(finalPath)) {
+            Log("VoiceCatalog: WARNING - File missing for Voice " + cur.modelKey + ": " + finalPath);
+            return;
+        }
+        std::string id = VoiceId(cur.modelKey, cur.speakerId);
+        if (s_byKey.count(id)) {
+            Log("VoiceCatalog: Duplicate voice " + id + " in " + file + ", first one wins");
+            return;
+        }
+        std::error_code ec;
+        cur.path = finalPath;
+        cur.fileBytes = (uint64_t)fs::file_size(finalPath, ec);
+        if (ec) cur.fileBytes = 0;
+        s_paths.emplace(cur.modelKey, finalPath);
+        s_byModel[cur.modelKey].push_back((uint32_t)s_voices.size());
+        s_byKey.emplace(id, (int)s_voices.size());
+        s_voices.push_back(cur);
+    };
+
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        line = Trim(line);
+        if (line.empty() || line[0] == ';') continue;
+
+        if (line[0] == '[' && line.find(']') != std::string::npos) {
+            commit();
+            cur = CatalogVoice();
+            pathRaw.clear();
+            open = true;
+
+            // "[1]" oder "[ID 1]"
+            std::string digits;
+            for (char c : line.substr(1, line.find(']') - 1)) if (isdigit((unsigned char)c)) digits += c;
+            try { cur.listId = std::stoi(digits); }
+            catch (...) { cur.listId = 0; }
+            continue;
+        }
+
+        size_t sep = line.find_first_of("=:");   // "key=value" und "key: value"
+        if (sep == std::string::npos) continue;
+        std::string key = Trim(line.substr(0, sep));
+        std::string val = Trim(line.substr(sep + 1));
+
+        if (key == "model_path") {
+            if (val.find("root/") == 0) val = gameRoot + "/" + val.substr(5);
+            std::replace(val.begin(), val.end(), '\\', '/');
+            if (!val.empty() && val.back() != '/') val += '/';
+            basePath = val;
+            continue;
+        }
+        if (!open) continue;
+
+        if (key == "rep_internal_id" || key == "int_id") {
+            try { cur.speakerId = std::stoi(val); }
+            catch (...) { cur.speakerId = 0; }
+        }
+        else if (key == "name")    cur.modelKey = val;
+        else if (key == "path")    pathRaw = val;
+        else if (key == "gender")  cur.gender = InternGender(val);
+        else if (key == "age")     cur.age = InternAge(val);
+        else if (key == "voice")   cur.type = InternType(val, true);
+        else if (key == "special") cur.special = val;
+        else if (key == "enable" && val == "0") open = false;
+    }
+    commit();
+}
+
+// ---------------------------------------------------------------------
+// 3. INDEX
+// ---------------------------------------------------------------------
+
+// A voice answers its own value and the wildcard query; a wildcard voice answers every query.
+// Type column layout: 0 = any, 1..n = interned types, n + 1 = type unknown to the catalog.
+void VoiceCatalog::Index() {
+    const int typeCount = (int)s_types.size() + 2;
+    s_buckets.assign((size_t)GENDER_COUNT * AGE_COUNT * typeCount, {});
+    s_users.assign(s_voices.size(), 0);
+
+    std::vector<int> gs, as, ts;
+    for (uint32_t v = 0; v < (uint32_t)s_voices.size(); ++v) {
+        const CatalogVoice& cv = s_voices[v];
+        gs.clear(); as.clear(); ts.clear();
+
+        if (cv.gender == VoiceGender::ANY) for (int g = 0; g < GENDER_COUNT; ++g) gs.push_back(g);
+        else { gs.push_back(0); gs.push_back((int)cv.gender); }
+        if (cv.age == VoiceAge::ANY) for (int a = 0; a < AGE_COUNT; ++a) as.push_back(a);
+        else { as.push_back(0); as.push_back((int)cv.age); }
+        if (cv.type == 0) for (int t = 0; t < typeCount; ++t) ts.push_back(t);
+        else { ts.push_back(0); ts.push_back(cv.type); }
+
+        for (int g : gs)
+            for (int a : as)
+                for (int t : ts)
+                    s_buckets[((size_t)g * AGE_COUNT + a) * typeCount + t].push_back(v);
+    }
+}
+
+const std::vector<uint32_t>* VoiceCatalog::BucketLocked(const NpcPersona& persona) {
+    if (s_buckets.empty()) return nullptr;
+    const int typeCount = (int)s_types.size() + 2;
+    int g = (int)InternGender(persona.n_gender);
+    int a = (int)InternAge(persona.n_age);
+    int t = InternType(persona.n_voicetype, false);
+    return &s_buckets[((size_t)g * AGE_COUNT + a) * typeCount + t];
+}
+
+// Same rule the buckets are built with, for voices reached through s_byModel
+bool VoiceCatalog::MatchesLocked(const CatalogVoice& voice, const NpcPersona& persona) {
+    VoiceGender g = InternGender(persona.n_gender);
+    VoiceAge a = InternAge(persona.n_age);
+    uint16_t t = InternType(persona.n_voicetype, false);
+    return (voice.gender == VoiceGender::ANY || g == VoiceGender::ANY || voice.gender == g) &&
+           (voice.age == VoiceAge::ANY || a == VoiceAge::ANY || voice.age == a) &&
+           (voice.type == 0 || t == 0 || voice.type == t);
+}
+
+// xorshift
+uint64_t VoiceCatalog::NextRandom() {
+    s_rng ^= s_rng << 13; s_rng ^= s_rng >> 7; s_rng ^= s_rng << 17;
+    return s_rng;
+}
+
+int VoiceCatalog::FindLocked(const std::string& modelKey, int speakerId) {
+    auto it = s_byKey.find(VoiceId(modelKey, speakerId));
+    return (it != s_byKey.end()) ? it->second : -1;
+}
+
+// ---------------------------------------------------------------------
+// 4. LOOKUP / PICK
+// ---------------------------------------------------------------------
+
+size_t VoiceCatalog::Size() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_voices.size();
+}
+
+std::string VoiceCatalog::ResolvePath(const std::string& modelKey) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_paths.find(modelKey);
+    return (it != s_paths.end()) ? it->second : "";
+}
+
+// The catalog is only rebuilt at init, so pointers stay valid for the session
+const CatalogVoice* VoiceCatalog::Find(const std::string& modelKey, int speakerId) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    int idx = FindLocked(modelKey, speakerId);
+    return (idx >= 0) ? &s_voices[idx] : nullptr;
+}
+
+std::vector<const CatalogVoice*> VoiceCatalog::Candidates(const NpcPersona& persona) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    std::vector<const CatalogVoice*> out;
+    const auto* bucket = BucketLocked(persona);
+    if (!bucket) return out;
+    out.reserve(bucket->size());
+    for (uint32_t v : *bucket) out.push_back(&s_voices[v]);
+    return out;
+}
+
+bool VoiceCatalog::Pick(const NpcPersona& persona, VoiceSettings& out,
+                        const std::vector<std::string>& preferredModels, const VoiceCost& cost) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const auto* bucket = BucketLocked(persona);
+    if (!bucket || bucket->empty()) return false;
+
+    std::vector<uint32_t> probes;
+    probes.reserve(PICK_PROBES * (1 + preferredModels.size()));
+
+    // Random window inside the bucket
+    size_t n = bucket->size();
+    size_t start = (size_t)(NextRandom() % n);
+    for (size_t i = 0; i < std::min<size_t>(n, PICK_PROBES); ++i) probes.push_back((*bucket)[(start + i) % n]);
+
+    // Speakers of models that are already loaded (a multi speaker onnx has many)
+    for (const auto& model : preferredModels) {
+        auto it = s_byModel.find(model);
+        if (it == s_byModel.end()) continue;
+        const auto& speakers = it->second;
+        size_t m = speakers.size();
+        size_t first = (size_t)(NextRandom() % m);
+        int taken = 0;
+        for (size_t i = 0; i < m && taken < PICK_PROBES && i < (size_t)PICK_PROBES * 4; ++i) {
+            uint32_t v = speakers[(first + i) % m];
+            if (!MatchesLocked(s_voices[v], persona)) continue;
+            probes.push_back(v);
+            taken++;
+        }
+    }
+
+    uint32_t best = probes[0];
+    float bestCost = cost ? cost(s_voices[best], s_users[best]) : (float)s_users[best];
+    for (size_t i = 1; i < probes.size(); ++i) {
+        uint32_t v = probes[i];
+        float c = cost ? cost(s_voices[v], s_users[v]) : (float)s_users[v];
+        if (c < bestCost) { best = v; bestCost = c; }
+    }
+
+    const CatalogVoice& cv = s_voices[best];
+    out = { cv.modelKey, cv.speakerId, 1.0f };
+    return true;
+}
+
+void VoiceCatalog::Reserve(const VoiceSettings& voice) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    int idx = FindLocked(voice.model, voice.id);
+    if (idx >= 0) s_users[idx]++;
+}
+
+void VoiceCatalog::Release(const VoiceSettings& voice) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    int idx = FindLocked(voice.model, voice.id);
+    if (idx >= 0 && s_users[idx] > 0) s_users[idx]--;
+}
+
+int VoiceCatalog::Users(const CatalogVoice& voice) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    size_t idx = &voice - s_voices.data();
+    return (idx < s_users.size()) ? s_users[idx] : 0;
+}
+
+//EOF
@@ -0,0 +1,81 @@
+#pragma once
+#include "main.h"
+#include "ConfigReader.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+// VoiceCatalog.h
+// The one parser for Audio Data Files/EC_Voices_list_*.ini. Gender, age and voicetype are
+// interned into small ids while loading and every voice is filed under each
+// (gender, age, voicetype) query it can answer, wildcard queries included. Finding a voice
+// for an NPC is one bucket lookup plus a few probes for a voice nobody else is using.
+
+enum class VoiceGender : uint8_t { ANY = 0, MALE, FEMALE, OTHER, COUNT };
+enum class VoiceAge : uint8_t { ANY = 0, YOUNG, MIDDLE, OLD, OTHER, COUNT };
+
+struct CatalogVoice {
+    std::string modelKey;      // name= or the list id ("1"), key for AudioManager
+    int listId = 0;
+    int speakerId = 0;         // rep_internal_id, speaker inside a multi speaker onnx
+    std::string path;          // resolved .onnx
+    uint64_t fileBytes = 0;
+    VoiceGender gender = VoiceGender::ANY;
+    VoiceAge age = VoiceAge::ANY;
+    uint16_t type = 0;         // interned voicetype, 0 = any
+    std::string special;
+};
+
+class VoiceCatalog {
+public:
+    // Parses <gameRoot>/ECmod/AudioDataFiles once and builds the index
+    static void Build(const std::string& gameRoot);
+    static size_t Size();
+
+    static std::string ResolvePath(const std::string& modelKey);
+    static const CatalogVoice* Find(const std::string& modelKey, int speakerId);
+
+    // All voices matching the persona (same rules as Pick), for callers that rank themselves
+    static std::vector<const CatalogVoice*> Candidates(const NpcPersona& persona);
+    // cost(voice, users), lower wins. Without one the least used voice wins.
+    using VoiceCost = std::function<float(const CatalogVoice& voice, int users)>;
+
+    // Constant time: a few random probes of the bucket plus a few matching speakers of every
+    // preferred (already loaded) model are scored. False if nothing matches.
+    static bool Pick(const NpcPersona& persona, VoiceSettings& out,
+                     const std::vector<std::string>& preferredModels = {}, const VoiceCost& cost = nullptr);
+
+    // Reservation tracking, driven by EntityRegistry::SetVoiceSettings / OnEntityRemoved
+    static void Reserve(const VoiceSettings& voice);
+    static void Release(const VoiceSettings& voice);
+    static int Users(const CatalogVoice& voice);
+
+private:
+    static const int PICK_PROBES = 8;
+
+    static void ParseFile(const std::string& file, const std::string& gameRoot);
+    static void Index();
+    static const std::vector<uint32_t>* BucketLocked(const NpcPersona& persona);
+    static bool MatchesLocked(const CatalogVoice& voice, const NpcPersona& persona);
+    static uint64_t NextRandom();
+    static int FindLocked(const std::string& modelKey, int speakerId);
+
+    static VoiceGender InternGender(const std::string& s);
+    static VoiceAge InternAge(const std::string& s);
+    static uint16_t InternType(const std::string& s, bool add);
+
+    static std::vector<CatalogVoice> s_voices;
+    static std::vector<int> s_users;                                   // per voice
+    static std::unordered_map<std::string, int> s_byKey;               // "key#speaker" -> voice
+    static std::unordered_map<std::string, std::string> s_paths;       // modelKey -> onnx
+    static std::unordered_map<std::string, std::vector<uint32_t>> s_byModel;   // modelKey -> its speakers
+    static std::unordered_map<std::string, uint16_t> s_types;          // lowercase voicetype -> id
+    static std::vector<std::vector<uint32_t>> s_buckets;               // [gender][age][type]
+    static uint64_t s_rng;
+    static std::mutex s_mutex;
+};
+
+//EOF
@@ -0,0 +1,167 @@
+#include "main.h"
+#include "VoicePreloader.h"
+#include "AudioManager.h"
+#include "EntityRegistry.h"
+#include "PlatformSystem.h"
+#include <algorithm>
+
+using namespace AbstractGame;
+
+// ------------------------------------------------------------
+// STATIC MEMBERS
+// ------------------------------------------------------------
+std::unordered_map<AHandle, VoiceSettings> VoicePreloader::s_predicted;
+uint64_t VoicePreloader::s_lastUpdateMs = 0;
+std::thread VoicePreloader::s_worker;
+std::mutex VoicePreloader::s_queueMutex;
+std::condition_variable VoicePreloader::s_queueCv;
+std::deque<std::string> VoicePreloader::s_queue;
+std::set<std::string> VoicePreloader::s_queued;
+std::atomic<bool> VoicePreloader::s_running(false);
+std::atomic<uint64_t> VoicePreloader::s_hits(0);
+std::atomic<uint64_t> VoicePreloader::s_misses(0);
+std::atomic<uint64_t> VoicePreloader::s_loads(0);
+
+static bool HasVoice(const VoiceSettings& vs) {
+    return !vs.model.empty() && vs.model != "NONE";
+}
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE
+// ------------------------------------------------------------
+void VoicePreloader::Init() {
+    if (s_running) return;
+    s_running = true;
+    s_worker = std::thread(WorkerLoop);
+}
+
+void VoicePreloader::Shutdown() {
+    if (!s_running.exchange(false)) return;
+    { std::lock_guard<std::mutex> lock(s_queueMutex); }
+    s_queueCv.notify_all();
+    if (s_worker.joinable()) s_worker.join();
+
+    uint64_t total = s_hits + s_misses;
+    if (total > 0) {
+        Log("VoicePreloader: " + std::to_string(s_hits.load()) + "/" + std::to_string(total) +
+            " conversations found their voice loaded, " + std::to_string(s_loads.load()) + " background loads");
+    }
+    std::lock_guard<std::mutex> lock(s_queueMutex);
+    s_queue.clear();
+    s_queued.clear();
+    s_predicted.clear();
+}
+
+// ------------------------------------------------------------
+// 2. PROXIMITY WATCHER
+// ------------------------------------------------------------
+void VoicePreloader::Update(AHandle playerPed) {
+    if (!s_running || !ConfigReader::g_Settings.TtS_Enabled || !ConfigReader::g_Settings.TTS_VOICE_PRELOAD) return;
+
+    uint64_t now = AOS::GetTimeMs();
+    if (now < s_lastUpdateMs + (uint64_t)std::max(0, ConfigReader::g_Settings.TTS_VOICE_PRELOAD_INTERVAL_MS)) return;
+    s_lastUpdateMs = now;
+
+    float radius = ConfigReader::g_Settings.MaxConversationRadius * ConfigReader::g_Settings.PREFETCH_RADIUS_SCALE;
+    std::vector<std::pair<float, AHandle>> near;
+    for (AHandle ped : GetNearbyPeds(playerPed, SCAN_PEDS)) {
+        if (ped == playerPed || !IsEntityValid(ped) || !IsEntityLivingEntity(ped) || !IsPedHuman(ped)) continue;
+        float dist = GetDistanceBetweenEntities(playerPed, ped);
+        if (dist <= radius) near.emplace_back(dist, ped);
+    }
+    std::sort(near.begin(), near.end());
+    if ((int)near.size() > ConfigReader::g_Settings.TTS_VOICE_PRELOAD_PEDS) {
+        near.resize((size_t)std::max(0, ConfigReader::g_Settings.TTS_VOICE_PRELOAD_PEDS));
+    }
+
+    // Peds that walked away drop out, their model stays until the residency LRU needs the room
+    std::unordered_map<AHandle, VoiceSettings> next;
+    for (const auto& candidate : near) {
+        AHandle ped = candidate.second;
+        VoiceSettings vs;
+
+        auto it = s_predicted.find(ped);
+        if (it != s_predicted.end()) {
+            vs = it->second;
+        }
+        else {
+            // Already talked to -> keeps the voice from the registry
+            PersistID pid = EntityRegistry::GetIDFromHandle(ped);
+            if (pid != 0) vs = EntityRegistry::GetVoiceSettings(pid);
+            if (!HasVoice(vs)) vs = AudioManager::GetVoiceForNPC(*ConfigReader::GetPersona(ped));
+        }
+        if (!HasVoice(vs)) continue;
+
+        next[ped] = vs;
+        if (!AudioManager::GetSession(vs.model) && !AudioManager::ResolveModelPath(vs.model).empty()) Request(vs.model, false);
+    }
+    s_predicted.swap(next);
+}
+
+// ------------------------------------------------------------
+// 3. CONVERSATION START
+// ------------------------------------------------------------
+bool VoicePreloader::TakePrediction(AHandle targetPed, VoiceSettings& out) {
+    auto it = s_predicted.find(targetPed);
+    if (it == s_predicted.end()) return false;
+    out = it->second;
+    s_predicted.erase(it);
+    return true;
+}
+
+void VoicePreloader::OnConversationStart(const VoiceSettings& voice) {
+    if (!HasVoice(voice)) return;
+
+    if (AudioManager::GetSession(voice.model)) {
+        s_hits++;
+    }
+    else {
+        s_misses++;
+        // The TTS task waits for this load in its own thread (AcquireSession)
+        Request(voice.model, true);
+    }
+    uint64_t total = s_hits + s_misses;
+    Log("VoicePreloader: " + voice.model + (AudioManager::GetSession(voice.model) ? " ready" : " queued") +
+        ", hit rate " + std::to_string((int)(100 * s_hits / total)) + "% (" + std::to_string(s_hits.load()) + "/" + std::to_string(total) + ")");
+}
+
+void VoicePreloader::Request(const std::string& modelKey, bool urgent) {
+    if (!s_running || modelKey.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(s_queueMutex);
+        if (s_queued.count(modelKey)) {
+            if (!urgent) return;
+            s_queue.erase(std::remove(s_queue.begin(), s_queue.end(), modelKey), s_queue.end());
+        }
+        s_queued.insert(modelKey);
+        if (urgent) s_queue.push_front(modelKey);
+        else s_queue.push_back(modelKey);
+    }
+    s_queueCv.notify_one();
+}
+
+// ------------------------------------------------------------
+// 4. WORKER
+// ------------------------------------------------------------
+void VoicePreloader::WorkerLoop() {
+    AOS::LowerCurrentThreadPriority();
+
+    while (true) {
+        std::string key;
+        {
+            std::unique_lock<std::mutex> lock(s_queueMutex);
+            s_queueCv.wait(lock, [] { return !s_running || !s_queue.empty(); });
+            if (!s_running) return;
+            key = s_queue.front();
+            s_queue.pop_front();
+        }
+
+        // LoadAudioModel waits for a load of the same model already in flight
+        if (!AudioManager::GetSession(key) && AudioManager::LoadAudioModel(key)) s_loads++;
+
+        std::lock_guard<std::mutex> lock(s_queueMutex);
+        s_queued.erase(key);
+    }
+}
+
+//EOF
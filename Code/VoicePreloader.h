@@ -0,0 +1,55 @@
+#pragma once
+#include "AbstractTypes.h"
+#include <string>
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+// VoicePreloader.h
+// Predictive voice loading. The peds closest to the player get the voice they would be
+// assigned resolved ahead of time, and a low priority worker loads those sessions. When a
+// conversation starts, FillConversationCache takes the predicted voice and never waits for
+// a model load on the script thread; a miss is queued in front of the worker instead.
+
+struct VoiceSettings;
+
+class VoicePreloader {
+public:
+    static void Init();
+    static void Shutdown();
+
+    // Main thread, throttled by TTS_VOICE_PRELOAD_INTERVAL_MS
+    static void Update(AHandle playerPed);
+    // Voice predicted for targetPed (the one that has been preloaded), false if none
+    static bool TakePrediction(AHandle targetPed, VoiceSettings& out);
+    // Conversation start: counts the hit / miss and queues the load if the voice is not resident
+    static void OnConversationStart(const VoiceSettings& voice);
+    // urgent = front of the queue (conversation already running)
+    static void Request(const std::string& modelKey, bool urgent);
+
+private:
+    static const int SCAN_PEDS = 16;
+
+    static void WorkerLoop();
+
+    static std::unordered_map<AHandle, VoiceSettings> s_predicted;   // main thread only
+    static uint64_t s_lastUpdateMs;
+
+    static std::thread s_worker;
+    static std::mutex s_queueMutex;
+    static std::condition_variable s_queueCv;
+    static std::deque<std::string> s_queue;
+    static std::set<std::string> s_queued;
+    static std::atomic<bool> s_running;
+
+    static std::atomic<uint64_t> s_hits;
+    static std::atomic<uint64_t> s_misses;
+    static std::atomic<uint64_t> s_loads;
+};
+
+//EOF
@@ -0,0 +1,155 @@
+#include "WhisperPool.h"
+#include "ConfigReader.h"
+#include "CoreBudget.h"
+#include "helperfunctions.h"
+#include "whisper.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// ------------------------------------------------------------
+// STATIC MEMBERS
+// ------------------------------------------------------------
+whisper_context* WhisperPool::s_ctx = nullptr;
+std::vector<whisper_state*> WhisperPool::s_all;
+std::vector<whisper_state*> WhisperPool::s_free;
+std::mutex WhisperPool::s_mutex;
+std::condition_variable WhisperPool::s_cv;
+std::string WhisperPool::s_sessionLanguage;
+bool WhisperPool::s_closing = false;
+
+// ------------------------------------------------------------
+// 1. LIFECYCLE
+// ------------------------------------------------------------
+bool WhisperPool::Init(whisper_context* ctx, int poolSize) {
+    Shutdown();
+    if (!ctx) return false;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_ctx = ctx;
+    poolSize = std::max(1, poolSize);
+    for (int i = 0; i < poolSize; ++i) {
+        whisper_state* state = whisper_init_state(ctx);
+        if (!state) {
+            LogA("WhisperPool: whisper_init_state failed after " + std::to_string(i) + " state(s).");
+            break;
+        }
+        s_all.push_back(state);
+        s_free.push_back(state);
+    }
+    LogA("WhisperPool: " + std::to_string(s_all.size()) + " state(s) ready.");
+    return !s_all.empty();
+}
+
+void WhisperPool::Shutdown() {
+    std::unique_lock<std::mutex> lock(s_mutex);
+    // No new leases from here on, waiting Acquire calls give up
+    s_closing = true;
+    s_cv.notify_all();
+
+    // Leased states are still inside whisper_full on the context, which is freed right
+    // after this. Freeing them early is a use-after-free, so wait for every lease.
+    auto drained = [] { return s_free.size() == s_all.size(); };
+    if (!s_cv.wait_for(lock, std::chrono::seconds(10), drained)) {
+        LogA("WhisperPool: Waiting for " + std::to_string(s_all.size() - s_free.size()) + " leased state(s)...");
+        s_cv.wait(lock, drained);
+    }
+    for (whisper_state* state : s_all) whisper_free_state(state);
+    s_all.clear();
+    s_free.clear();
+    s_ctx = nullptr;
+    s_sessionLanguage.clear();
+    s_closing = false;
+}
+
+// ------------------------------------------------------------
+// 2. LEASING
+// ------------------------------------------------------------
+whisper_state* WhisperPool::Acquire(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(s_mutex);
+    if (s_all.empty() || s_closing) return nullptr;
+
+    auto available = [] { return s_closing || !s_free.empty(); };
+    if (timeoutMs < 0) {
+        s_cv.wait(lock, available);
+    }
+    else if (!s_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), available)) {
+        return nullptr;
+    }
+    if (s_closing) return nullptr;
+    whisper_state* state = s_free.back();
+    s_free.pop_back();
+    return state;
+}
+
+void WhisperPool::Release(whisper_state* state) {
+    if (!state) return;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_free.push_back(state);
+    }
+    s_cv.notify_all();
+}
+
+// ------------------------------------------------------------
+// 3. PARAMETERS & LANGUAGE
+// ------------------------------------------------------------
+void WhisperPool::FillParams(whisper_full_params& params, std::string& language) {
+    const ModSettings& s = ConfigReader::g_Settings;
+
+    params = whisper_full_default_params(s.STT_STRATEGY == 1 ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY);
+    params.print_progress = false;
+    params.print_realtime = false;
+    params.print_special = false;
+    params.print_timestamps = false;
+
+    int threads = s.STT_THREADS;
+    if (CoreBudget::IsEnabled()) {
+        // Share of the CPU budget, STT_THREADS stays the upper limit
+        threads = CoreBudget::Threads(CpuStage::STT);
+        if (s.STT_THREADS > 0) threads = std::min(threads, s.STT_THREADS);
+    }
+    else if (threads <= 0) {
+        // Auto: half the cores, the game and the LLM need the rest
+        threads = std::max(1, std::min(8, (int)std::thread::hardware_concurrency() / 2));
+    }
+    params.n_threads = threads;
+    if (s.STT_STRATEGY == 1) {
+        params.beam_search.beam_size = std::max(1, s.STT_BEAM_SIZE);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (s_ctx && !whisper_is_multilingual(s_ctx)) {
+            language = "en";
+        }
+        else if (!s.STT_LANGUAGE.empty() && s.STT_LANGUAGE != "auto") {
+            language = s.STT_LANGUAGE;
+        }
+        else {
+            language = s_sessionLanguage.empty() ? "auto" : s_sessionLanguage;
+        }
+    }
+    params.language = language.c_str();
+}
+
+void WhisperPool::RememberLanguage(whisper_state* state) {
+    if (!state) return;
+    int id = whisper_full_lang_id_from_state(state);
+    if (id < 0) return;
+    const char* lang = whisper_lang_str(id);
+    if (!lang) return;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_sessionLanguage.empty()) {
+        s_sessionLanguage = lang;
+        LogA("WhisperPool: Detected language '" + s_sessionLanguage + "', skipping detection for this conversation.");
+    }
+}
+
+void WhisperPool::ResetSessionLanguage() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_sessionLanguage.clear();
+}
+
+//EOF
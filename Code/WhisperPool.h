@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+// WhisperPool.h
+// Preallocated whisper_state objects for the one loaded Whisper model. Every transcription
+// (batch or streaming) leases its own state, so several STT jobs can run at once without
+// racing on the context. Decoding parameters come from the settings, and the language
+// detected on the first utterance is reused for the rest of the conversation.
+
+struct whisper_context;
+struct whisper_state;
+struct whisper_full_params;
+
+class WhisperPool {
+public:
+    static bool Init(whisper_context* ctx, int poolSize);
+    static void Shutdown();
+
+    // Waits up to timeoutMs for a free state (-1 = forever). nullptr on timeout or shutdown.
+    static whisper_state* Acquire(int timeoutMs = -1);
+    static void Release(whisper_state* state);
+
+    // Threads, strategy, beam size and language from the settings. 'language' must
+    // outlive the whisper_full call (params only keep the pointer).
+    static void FillParams(whisper_full_params& params, std::string& language);
+    // After a run with language "auto": remember the detected language for this session
+    static void RememberLanguage(whisper_state* state);
+    // New conversation -> detect again
+    static void ResetSessionLanguage();
+
+private:
+    static whisper_context* s_ctx;
+    static std::vector<whisper_state*> s_all;
+    static std::vector<whisper_state*> s_free;
+    static std::mutex s_mutex;
+    static std::condition_variable s_cv;
+    static std::string s_sessionLanguage;
+    static bool s_closing;
+};
+
+// RAII lease, releases the state when it goes out of scope
+class WhisperStateLease {
+public:
+    explicit WhisperStateLease(int timeoutMs = -1) : m_state(WhisperPool::Acquire(timeoutMs)) {}
+    ~WhisperStateLease() { if (m_state) WhisperPool::Release(m_state); }
+    WhisperStateLease(const WhisperStateLease&) = delete;
+    WhisperStateLease& operator=(const WhisperStateLease&) = delete;
+
+    whisper_state* Get() const { return m_state; }
+    explicit operator bool() const { return m_state != nullptr; }
+
+private:
+    whisper_state* m_state;
+};
+
+//EOF
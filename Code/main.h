@@ -18,7 +18,9 @@
 #include <map>
 #include <set>
 #include <sstream>  
+#include <atomic>
 #include "AudioSystem.h"
+#include "AudioRingBuffer.h"
 // (Andere notwendige Standard-Libs)
 
 // ------------------------------------------------------------
@@ -54,8 +56,8 @@ struct VoiceSettings {
 };
 
 struct ConversationCache {
-    NpcPersona npcPersona;
-    NpcPersona playerPersona;
+    PersonaRef npcPersona = std::make_shared<const NpcPersona>();
+    PersonaRef playerPersona = std::make_shared<const NpcPersona>();
     std::string npcName;
     std::string playerName;
     std::string characterRelationship;
@@ -86,9 +88,9 @@ extern std::future<std::string> g_llm_future;
 
 // Audio (STT)
 extern struct whisper_context* g_whisper_ctx;
-extern std::vector<float> g_audio_buffer;
+extern AudioRingBuffer<float> g_capture_ring;
 extern ma_device g_capture_device;
-extern bool g_is_recording;
+extern std::atomic<bool> g_is_recording;
 // ... (andere Audio externs)
 
 // ------------------------------------------------------------
@@ -104,6 +106,7 @@ extern bool g_is_recording;
 #include "helperfunctions.h"
 #include "OptChatMem.h"
 #include "SubtitleManager.h"
+#include "ConversationPrefetch.h"
 
 // ------------------------------------------------------------
 // 8. FUNCTION PROTOTYPES (Exports for ModMain)
@@ -113,7 +116,8 @@ extern bool g_is_recording;
 
 // Eigene Hilfsfunktion fr den Conversation Cache
 void FillConversationCache(AHandle targetPed, AHandle playerPed);
-void LoadVoiceConfigs(const std::string& folderPath);
+// Persona, name and relationships only (no registration, no voice). Shared with ConversationPrefetch.
+void ResolveConversationCache(AHandle targetPed, AHandle playerPed, ConversationCache& cache);
 // Logging
 void Log(const std::string& msg);
 void LogM(const std::string& msg);
@@ -151,5 +155,5 @@ bool InitializeWhisper(const char* model_path);
 bool InitializeAudioCaptureDevice();
 void StartAudioRecording();
 void StopAudioRecording();
-std::string TranscribeAudio(std::vector<float> pcm_data);
+std::string TranscribeAudio(const float* pcm_data, size_t n_samples);
 